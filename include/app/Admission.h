@@ -0,0 +1,109 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Config.h"
+
+#include "utils/CustomConstructor.h"
+#include "utils/Metrics.h"
+#include "utils/Time.h"
+
+#include <unordered_map>
+#include <condition_variable>
+#include <expected>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <cmath>
+#include <set>
+
+namespace ml::app
+{
+    /** Why the request isn't admitted. */
+    enum RejectReason
+    {
+        RR_Throttled = 0, ///< The channel exceeds its own limits, the client should slow down ( 429 ).
+        RR_Overloaded = 1 ///< The decoding is saturated by the channels of the same or higher priority ( 503 ).
+    };
+
+    struct Rejection
+    {
+        RejectReason Reason;
+        time_t RetryAfter; ///< When the request is likely to be admitted.
+    };
+
+    /**
+     * @brief The admission control of the uploaded audio.
+     * @safety Fully exception and thread safe.
+     *
+     * Every upload passes two stages before its decoding starts:
+     * - The limits of the channel: the number of the requests in flight and the byte rate ( a token bucket with a second of burst ).
+     *   The channel over its limits is rejected right away.
+     * - The decode slots shared by all the channels. The waiting requests get the free slot by the channel priority and then by the arrival.
+     *   The queue and the wait are bounded, once the queue is full the arriving request pushes out the lowest one if it's below.
+     *
+     * Metrics:
+     * - admission_admitted: the requests that got the decode slot.
+     * - admission_throttled: the requests rejected by the limits of their channel.
+     * - admission_overloaded: the requests rejected since the queue is full or the wait has expired.
+     * - admission_queue: the number of the requests waiting for a decode slot.
+     * - admission_wait_ms: how long the admitted requests have waited for the slot.
+     *
+     * Warnings:
+     * - The tickets must not outlive the admission.
+     */
+    class Admission : public utils::CustomConstructor
+    {
+        struct Bucket
+        {
+            uint Requests {}; ///< The requests of the channel in flight.
+            double Tokens {}; ///< The bytes the channel may upload right now, negative while the channel is in debt.
+            time_t RefilledAt {};
+        };
+
+        std::unordered_map<std::string, ChannelLimit> Limits_;
+        std::unordered_map<std::string, Bucket> Buckets_;
+
+        uint Slots_ {};
+        uint Busy_ {};
+        size_t QueueLimit_ {};
+        time_t Wait_ {};
+
+        std::set<std::pair<int64_t, uint64_t>> Waiting_; ///< ( -priority, arrival ), so the first is the next to get a slot.
+        uint64_t Arrivals_ {};
+
+        std::mutex Lock_;
+        std::condition_variable Released_;
+
+    public:
+        /** Keeps the channel request and the decode slot, both are released on destruction. */
+        class Ticket
+        {
+            Admission* Owner_;
+            std::string Channel_;
+            bool Decoding_ = true;
+
+        public:
+            Ticket(Admission* owner, std::string channel) noexcept;
+            Ticket(Ticket&& other) noexcept;
+            ~Ticket();
+
+            /** Releases the decode slot early, the request stays counted by its channel till the ticket is destroyed. */
+            void Decoded() noexcept;
+        };
+
+        /** Creates the admission with the given decode slots ( 0 - one per core ), the queue bound, the longest wait and the channel limits. */
+        static auto Create(uint slots, size_t queue, time_t wait, const std::vector<ChannelLimit>& limits) noexcept -> std::shared_ptr<Admission>;
+
+        /** Replaces the settings, the admitted requests keep their slots. */
+        void Reconfigure(uint slots, size_t queue, time_t wait, const std::vector<ChannelLimit>& limits) noexcept;
+
+        /** Admits the upload of the given size into the channel, waits for a decode slot when all of them are busy. */
+        auto Admit(const std::string& channel, uint priority, size_t bytes) noexcept -> std::expected<Ticket, Rejection>;
+
+    private:
+        void Refill(Bucket& bucket, const ChannelLimit& limit, time_t time) noexcept;
+        void Release(const std::string& channel, bool decoding) noexcept;
+    };
+}
@@ -8,11 +8,57 @@
 
 namespace ml::app
 {
+    /** The RTP stream received on the UDP port and played into the channel. */
+    struct RtpIngest
+    {
+        /** The channel the stream is played into. */
+        std::string Channel;
+
+        /** The UDP port the packets are received on. */
+        uint16_t Port {};
+
+        /** The encoding of the payload: "pcmu", "pcma", "l16" or "opus". */
+        std::string Encoding = "pcmu";
+
+        /** The sample rate of the payload. */
+        int Rate = 8000;
+
+        /** The number of channels in the payload. */
+        uint8_t Channels = 1;
+
+        auto operator==(const RtpIngest&) const -> bool = default;
+    };
+
+    /** The admission limits of the uploads into the channel. */
+    struct ChannelLimit
+    {
+        /** The limited channel. */
+        std::string Channel;
+
+        /** How many uploads of the channel may be in flight at once ( 0 - unlimited ). */
+        uint MaxRequests {};
+
+        /** How many bytes per second may be uploaded into the channel, a second of it may come at once ( 0 - unlimited ). */
+        size_t MaxRate {};
+
+        auto operator==(const ChannelLimit&) const -> bool = default;
+    };
+
     struct Config
     {
         /** Port on which the web-server will run. */
         uint16_t Port = 8080;
 
+        /** The number of the HTTP workers that always run ( 0 - one per core ). */
+        uint HttpWorkers = 0;
+
+        /**
+         * The limit of the HTTP workers, the extra ones are added while the connections block ( e.g. long polling ).
+         * Each waiting /play, /stream or /wait holds a worker, so it's also the limit of the waiting requests:
+         * the default is 8 times below the fixed pool of 8096 threads used before, raise it for many waiting clients.
+         */
+        uint HttpWorkersMax = 1024;
+
         /** The application' API token. */
         std::string Token = "meloun";
 
@@ -22,13 +68,203 @@ namespace ml::app
         /** Time that the speaker requires to cool down, so it's unusable again. */
         time_t CoolingDuration = 0;
 
+        /** The shape of the lamps heating and cooling curves: "binary" or "exponential". */
+        std::string ThermalModel = "binary";
+
+        /** The heat level ( 0..1 ) from which the lamps are usable, matters only for the exponential model. */
+        double ThermalThreshold = 0.95;
+
+        /** The way the channels are overlaid: "exclusive" ( only the highest is audible ) or "ducking". */
+        std::string BlendMode = "exclusive";
+
+        /** How much the lower channels are attenuated while a higher channel plays, in dB. */
+        double DuckDepth = 12;
+
+        /** Time to fade out the gain fully when the ducking starts. */
+        time_t DuckAttack = 50;
+
+        /** Time to fade in the gain fully when the ducking ends. */
+        time_t DuckRelease = 500;
+
+        /** The loudness in LUFS the enqueued tracks are normalized to, none disables the normalization. */
+        std::optional<double> LoudnessTarget {};
+
+        /** The largest gain in dB the normalization may apply, so the quiet tracks don't turn into noise. */
+        double LoudnessMaxGain = 12;
+
+        /** The level in dBFS below which the leading and the trailing audio is trimmed as silence. */
+        double TrimThreshold = -60;
+
+        /** The latency the jitter buffer of the live streams keeps when the network is calm. */
+        time_t JitterTarget = 60;
+
+        /** The largest latency the jitter buffer may adapt to. */
+        time_t JitterMax = 300;
+
+        /** The lowest level of the logged records: "debug", "info", "warning" or "error". */
+        std::string LogLevel = "info";
+
+        /** The file the log is appended to ( nullopt - stdout ). */
+        std::optional<std::string> LogFile = std::nullopt;
+
+        /** The memory reserved for the log records waiting for the sink, the records over it are dropped. */
+        size_t LogMemory = 4*1024*1024;
+
+        /** Only every n-th request of the frequent routes ( polling and prolongation ) is logged, the failed ones always are. */
+        uint LogSample = 100;
+
+        /** The power-relay implementation: "serial" or "memory" ( simulated ). */
+        std::string PowerRelay = "serial";
+
         /** Path to the port which is connected to the power-relay. */
         std::string PowerPort = "/dev/ttyS0";
 
+        /** The audio output implementation: "sdl", "alsa", "null" ( discards the audio ) or "file" ( writes it into wav ). */
+        std::string AudioBackend = "sdl";
+
         /** The name of the audio output connected to the speaker. */
         std::optional<std::string> AudioDevice = std::nullopt;
 
+        /** Path to the wav file written by the "file" audio backend. */
+        std::string AudioFile = "./output.wav";
+
+        /** The canonical sample rate of the output, the tracks in this format are played without conversion. */
+        int AudioRate = 44100;
+
+        /** The canonical sample format of the output: "s16", "s32", "f32" or "u8". */
+        std::string AudioFormat = "s16";
+
+        /** The canonical number of the output channels. */
+        uint8_t AudioChannels = 2;
+
+        /** The size of a page of the queued audio in bytes. */
+        size_t AudioPageSize = 64*1024;
+
+        /** The number of pages reserved for the queued audio, more pages are allocated on the heap when required. */
+        size_t AudioPoolPages = 1024;
+
+        /** Whether the pages are backed by the huge pages ( when the system provides them ). */
+        bool AudioPoolHugepages = false;
+
+        /** Whether the memory of the process is locked and the audio pool is pre-faulted, so the playback never waits for the page faults. */
+        bool MemoryLock = false;
+
+        /** The scheduling policy of the audio output thread: "other", "fifo" or "rr" ( real-time, falls back when not permitted ). */
+        std::string AudioScheduling = "other";
+
+        /** The real-time priority of the audio output thread. */
+        int AudioPriority = 50;
+
+        /** The cores of the audio output thread, e.g. "2" or "2-3" ( empty - any ). The other threads keep off them. */
+        std::string AudioCpus = "";
+
+        /** The cores of the drivers mainloops, e.g. "1" ( empty - any ). The other threads keep off them. */
+        std::string MainloopCpus = "";
+
+        /** The number of frames rendered at once by the "alsa" audio backend. */
+        size_t AudioPeriod = 256;
+
+        /** The size of the device ring buffer in frames for the "alsa" audio backend, defines the output latency. */
+        size_t AudioBuffer = 1024;
+
+        /** The directory of the journal that keeps the queues across restarts ( nullopt - disabled ). */
+        std::optional<std::string> JournalPath = std::nullopt;
+
+        /** The directory of the prerecorded wav clips played by the name ( nullopt - disabled ). */
+        std::optional<std::string> ClipPath = std::nullopt;
+
         /** The speaker channels sorted by priority. */
         std::vector<std::string> Channels = { "default" };
+
+        /** The channels that trim the silence of the enqueued tracks by default, the request may override it. */
+        std::vector<std::string> TrimmedChannels = {};
+
+        /** The channels that pause instead of being muted while a higher channel plays, so they resume where they stopped. */
+        std::vector<std::string> PausedChannels = {};
+
+        /** The channels that play the live streams through the jitter buffer. */
+        std::vector<std::string> JitterChannels = {};
+
+        /** The RTP streams received by the channels. */
+        std::vector<RtpIngest> RtpIngests = {};
+
+        /** For how long the RTP talker may be silent before its stream ends. */
+        time_t RtpTimeout = 1000;
+
+        /** How many uploads may be decoded at once ( 0 - one per core ). */
+        uint DecodeSlots = 0;
+
+        /** How many uploads may wait for a decode slot, the rest are rejected. */
+        size_t DecodeQueue = 64;
+
+        /** For how long the upload may wait for a decode slot. */
+        time_t DecodeWait = 2000;
+
+        /** The admission limits of the channels. */
+        std::vector<ChannelLimit> ChannelLimits = {};
+
+        /** Whether the amplifier is pre-warmed ahead of the predicted demand. */
+        bool Prewarm = false;
+
+        /** The granularity of the day used to learn the demand. */
+        time_t PrewarmSlot = 15*60*1000;
+
+        /** The probability of the demand within a slot required to pre-warm the amplifier ( 0..1 ). */
+        double PrewarmThreshold = 0.5;
+
+        /** The weight of a day-old observation of the demand ( 0..1 ). */
+        double PrewarmDecay = 0.9;
+
+        /** How long the amplifier may be pre-warmed per day. */
+        time_t PrewarmLampBudget = 60*60*1000;
+
+        /** How much energy the pre-warming may consume per day, Wh ( 0 - unlimited ). */
+        double PrewarmEnergyBudget = 0;
+
+        /** The power consumption of the working amplifier, W. */
+        double AmplifierPower = 0;
+
+        auto operator==(const Config&) const -> bool = default;
+
+        /**
+         * Copies the settings applied by the hot reload, everything else requires a restart.
+         * The channels and the devices are copied as well, the reload reverts the devices it can't replace.
+         */
+        static void TakeHot(const Config& from, Config& to) noexcept;
     };
+
+    inline void Config::TakeHot(const Config& from, Config& to) noexcept
+    {
+        to.Token = from.Token;
+        to.Channels = from.Channels;
+        to.WarmingDuration = from.WarmingDuration;
+        to.CoolingDuration = from.CoolingDuration;
+        to.ThermalModel = from.ThermalModel;
+        to.ThermalThreshold = from.ThermalThreshold;
+        to.BlendMode = from.BlendMode;
+        to.DuckDepth = from.DuckDepth;
+        to.DuckAttack = from.DuckAttack;
+        to.DuckRelease = from.DuckRelease;
+        to.LoudnessTarget = from.LoudnessTarget;
+        to.LoudnessMaxGain = from.LoudnessMaxGain;
+        to.TrimThreshold = from.TrimThreshold;
+        to.TrimmedChannels = from.TrimmedChannels;
+        to.JitterTarget = from.JitterTarget;
+        to.JitterMax = from.JitterMax;
+        to.JitterChannels = from.JitterChannels;
+        to.PausedChannels = from.PausedChannels;
+        to.LogLevel = from.LogLevel;
+        to.LogSample = from.LogSample;
+        to.DecodeSlots = from.DecodeSlots;
+        to.DecodeQueue = from.DecodeQueue;
+        to.DecodeWait = from.DecodeWait;
+        to.ChannelLimits = from.ChannelLimits;
+        to.PowerRelay = from.PowerRelay;
+        to.PowerPort = from.PowerPort;
+        to.AudioBackend = from.AudioBackend;
+        to.AudioDevice = from.AudioDevice;
+        to.AudioFile = from.AudioFile;
+        to.AudioPeriod = from.AudioPeriod;
+        to.AudioBuffer = from.AudioBuffer;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,88 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "utils/CustomConstructor.h"
+#include "utils/Metrics.h"
+#include "utils/Time.h"
+
+#include <condition_variable>
+#include <functional>
+#include <optional>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <deque>
+#include <mutex>
+#include <list>
+#include <httplib.h>
+
+namespace ml::app
+{
+    /**
+     * @brief The elastic task queue of the HTTP connections.
+     * @safety Fully exception and thread safe.
+     *
+     * Workers:
+     * - One core worker per core, each owns a lane of the queue. The tasks are spread over the lanes, the worker takes the oldest
+     *   task of its own lane and steals the oldest ones of the others when it's empty.
+     * - The connections block ( long polling, keep-alive, admission ), so the watchdog adds the elastic workers up to the limit
+     *   once the queue makes no progress, at most doubling the workers per check.
+     * - The elastic workers only steal and retire after being idle for a while.
+     *
+     * Metrics:
+     * - http_queue: the connections waiting for a worker.
+     * - http_workers: the live workers, the core ones included.
+     * - http_stalls: how many times the queue made no progress and the workers were added.
+     *
+     * Warnings:
+     * - Owned by httplib, so it's created by new and destroyed by it.
+     * - A blocked connection holds its worker, so the limit of the workers is the limit of the waiting requests.
+     */
+    class Executor : public httplib::TaskQueue, public utils::CustomConstructor
+    {
+        struct Lane
+        {
+            std::deque<std::function<void()>> Tasks;
+            std::mutex Lock;
+        };
+
+        struct Worker
+        {
+            std::jthread Thread;
+            std::atomic<bool> Done {};
+        };
+
+        std::unique_ptr<Lane[]> Lanes_;
+        uint Cores_ {};
+        uint Limit_ {};
+
+        std::atomic<int64_t> Queued_ {};
+        std::atomic<uint64_t> Taken_ {};
+        std::atomic<uint> Next_ {};
+        uint64_t WatchedTaken_ {};
+
+        std::list<Worker> Workers_;
+        std::atomic<uint> Idle_ {};
+        std::atomic<bool> Stopping_ {};
+        std::mutex Lock_; ///< Guards the workers, the sleeping ones wait under it.
+        std::condition_variable Wakeup_;
+
+        utils::Routine Watchdog_;
+
+    public:
+        /** Starts the core workers ( 0 - one per core ), the elastic ones are added up to the limit of all the workers. */
+        static auto Create(uint cores, uint limit) noexcept -> Executor*;
+
+        /** Finishes the queued tasks and stops the workers. */
+        ~Executor() override;
+
+        auto enqueue(std::function<void()> task) -> bool override;
+        void shutdown() override;
+
+    private:
+        void Work(Worker& worker, std::optional<uint> lane) noexcept;
+        auto Take(std::optional<uint> lane) noexcept -> std::optional<std::function<void()>>;
+        void Spawn(std::optional<uint> lane) noexcept;
+        auto Watch() noexcept -> time_t;
+    };
+}
@@ -0,0 +1,88 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Config.h"
+
+#include "hardware/audio/RtpDecoder.h"
+#include "hardware/audio/LiveStream.h"
+#include "hardware/audio/JitterConfig.h"
+#include "hardware/speaker/Driver.h"
+
+#include "utils/CustomConstructor.h"
+#include "utils/Metrics.h"
+#include "utils/Time.h"
+
+#include <optional>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace ml::app
+{
+    /**
+     * @brief Receives the RTP audio streams ( paging microphones, SIP gateways ) and plays them into the speaker channels.
+     * @safety Fully exception and thread safe.
+     *
+     * Features:
+     * - Every configured UDP port is bound to a single channel, all the ports are served by a single receive thread.
+     * - The datagrams are received in batches by recvmmsg, so the concurrent streams cost little CPU.
+     * - The packets are fed into the live stream of the channel through the jitter buffer, bypassing the HTTP stack.
+     * - The stream starts with the first packet of a talker ( SSRC ) and ends when the talker goes silent for the timeout
+     *   or another talker takes over the port.
+     *
+     * Metrics:
+     * - rtp_packets: all the received datagrams.
+     * - rtp_invalid_packets: the datagrams that aren't RTP or can't be decoded.
+     * - rtp_rejected_packets: the packets dropped since the channel isn't active or the stream was skipped.
+     * - rtp_batch_size: the number of the datagrams received by a single call.
+     *
+     * Warnings:
+     * - The channel must be activated through the API before the talk, the packets to the inactive channel are dropped.
+     * - A skipped or cleared stream stays silent till its talker goes silent.
+     */
+    class RtpServer : public utils::CustomConstructor
+    {
+        struct Binding
+        {
+            RtpIngest Ingest;
+            int Socket = -1;
+            std::shared_ptr<audio::RtpDecoder> Decoder;
+
+            std::shared_ptr<audio::LiveStream> Stream;
+            std::optional<uint32_t> Talker; ///< The SSRC of the current stream.
+            bool Cut {}; ///< Whether the stream of the talker was skipped or cleared.
+            time_t LastPacket {};
+            time_t LastAttempt {};
+        };
+
+        std::shared_ptr<speaker::Driver> Speaker_;
+        std::vector<Binding> Bindings_;
+        time_t Timeout_ {};
+
+        audio::JitterConfig Jitter_ {};
+        std::mutex JitterLock_;
+
+        std::jthread Receiver_;
+
+    public:
+        /** Binds the ports of the ingests and starts receiving. Fails when a port can't be bound or the encoding isn't supported. */
+        static auto Create(const std::vector<RtpIngest>& ingests, time_t timeout, const std::shared_ptr<speaker::Driver>& speaker,
+            const audio::JitterConfig& jitter) noexcept -> std::shared_ptr<RtpServer>;
+
+        /** Stops receiving, ends the streams and closes the ports. */
+        ~RtpServer();
+
+        /** Replaces the jitter buffer settings of the streams started from now on. */
+        void SetJitter(const audio::JitterConfig& jitter) noexcept;
+
+    private:
+        void Receive(const std::stop_token& token) noexcept;
+        void Handle(Binding& binding, std::span<const uint8_t> datagram, time_t now) noexcept;
+        static void Finish(Binding& binding) noexcept;
+    };
+}
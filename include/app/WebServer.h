@@ -2,14 +2,37 @@
 #pragma once
 
 #include "ConfigParser.h"
+#include "RtpServer.h"
+#include "Admission.h"
+#include "Executor.h"
 
 #include "hardware/amplifier/lamp/LampDriver.h"
+#include "hardware/audio/backend/SdlBackend.h"
+#include "hardware/audio/backend/NullBackend.h"
+#include "hardware/audio/backend/FileBackend.h"
+#ifdef ML_WITH_ALSA
+#include "hardware/audio/backend/AlsaBackend.h"
+#endif
 #include "hardware/audio/TrackLoader.h"
+#include "hardware/audio/ClipLibrary.h"
+#include "hardware/audio/Loudness.h"
+#include "hardware/relay/serial/SerialDriver.h"
+#include "hardware/relay/memory/MemoryDriver.h"
 #include "hardware/speaker/Driver.h"
 
 #include "utils/CustomConstructor.h"
+#include "utils/Metrics.h"
+#include "utils/Logger.h"
+#include "utils/Realtime.h"
 
 #include <memory>
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+#include <csignal>
+#include <charconv>
+#include <limits>
+#include <cmath>
 #include <httplib.h>
 
 namespace ml::app
@@ -19,17 +42,73 @@ namespace ml::app
      * @safety Fully exception and thread safe.
      *
      * For API reference look on API.md.
+     *
+     * Hot reload:
+     * - SIGHUP or POST /reload re-reads the config and applies only what changed.
+     * - The token, the channels list, the durations, the thermal model, the blending, the preemption, the loudness, the trimming, the log level and
+     *   the sampling, the admission and the devices are applied live.
+     *   The queues, the sessions and the relay state survive, the sessions of the removed channels are terminated.
+     * - The channels created through the API are kept at their positions in the priorities list.
+     * - The admission settings apply to the uploads arriving from now on.
+     *
+     * Logging:
+     * - Every served request is logged as a JSON line with its id ( X-Request-Id of the client or a generated one ), the status and the latency.
+     * - The id is returned in X-Request-Id, so the client may match its requests to the log.
+     *
+     * Admission control:
+     * - The uploads ( /play and /play-clip ) pass the limits of their channel and wait for a decode slot by the channel priority.
+     * - The rejected ones get 429 ( the channel limits ) or 503 ( the decoding is saturated ) with Retry-After.
+     * - The port, the http workers, the prewarm section, the journal and the clip paths, the audio format, the audio pool and the rtp ingests
+     *   require a restart.
+     *
+     * Scheduling:
+     * - The audio output thread may run with the real-time policy and both it and the mainloops may be pinned to their own cores,
+     *   the HTTP workers and the rest keep off them. The memory may be locked with the audio pool pre-faulted.
+     * - It's applied at the start only, audio_realtime and audio_underruns in /metrics show the effect.
      */
     class WebServer : public utils::CustomConstructor
     {
+        /** The state of the running server, the hot reload replaces the config, the devices and the log sampling in it. */
+        struct Runtime
+        {
+            std::string ConfigPath;
+            std::optional<Config> Current;
+            std::shared_mutex Lock; ///< Guards the config and the created channels.
+            std::vector<std::string> Created; ///< The channels created through the API, they keep their positions in the priorities list.
+            std::atomic<uint> Sampling;
+            std::shared_ptr<relay::Driver> Relay;
+            std::shared_ptr<audio::Backend> Output;
+            std::shared_ptr<audio::PagePool> Pool;
+            std::shared_ptr<amplifier::LampDriver> Amplifier;
+            std::shared_ptr<speaker::Driver> Speaker;
+            std::shared_ptr<RtpServer> Rtp;
+            std::shared_ptr<Admission> Admitter;
+        };
+
     public:
         /** Creates and runs the application. Logs everything to the console. */
         static auto Run(const std::string& configPath) noexcept -> bool;
 
     private:
+        /** Re-reads the config and applies only what changed, returns the report or nullopt when the config is invalid. */
+        static auto Reload(Runtime& runtime) noexcept -> std::optional<std::string>;
+
+        /** Sets the preemption policies of the configured channels. */
+        static void SetPreemption(const Config& config, speaker::Driver& speaker) noexcept;
+
+        static auto LoadConfig(const std::string& path) noexcept -> std::optional<Config>;
+        static auto CreateBlending(const Config& config) noexcept -> audio::BlendConfig;
+        static auto CreateJitter(const Config& config) noexcept -> audio::JitterConfig;
+        static auto CreateRelay(const Config& config) noexcept -> std::shared_ptr<relay::Driver>;
+        static auto CreateOutput(const Config& config) noexcept -> std::shared_ptr<audio::Backend>;
+
+        template <typename T> static auto ParseNumber(const std::string& text, T& value) noexcept -> bool;
+        static auto ParseFlag(const std::string& text, bool& value) noexcept -> bool;
+
         static auto Response(int status, const std::string& text) noexcept -> httplib::Response;
         static auto LongPolling(const std::future<void>& f) noexcept -> httplib::Response;
         static auto BindError(speaker::ActionError error) noexcept -> httplib::Response;
+        static auto BindRejection(const Rejection& rejection) noexcept -> httplib::Response;
         static auto BindState(speaker::ChannelState state) noexcept -> httplib::Response;
     };
 }
\ No newline at end of file
@@ -5,9 +5,12 @@
 #include "Config.h"
 
 #include "hardware/audio/Track.h"
+#include "hardware/audio/LiveStream.h"
+#include "hardware/audio/BlendConfig.h"
 
 #include "utils/CustomConstructor.h"
 #include "utils/Time.h"
+#include "utils/Realtime.h"
 
 #include <future>
 #include <vector>
@@ -27,7 +30,8 @@ namespace ml::amplifier
      * Provides 3 different kinds of APIs:
      * 1. Channels Open/Close/Opened -> Equivalent of table reservation system.
      * 2. Amplifier StartUp/ShutDown/Ready -> Physically turns on/off the switch.
-     * 3. Actions Enqueue/Skip/Clear/DurationLeft -> Manages the audio playback for the channel.
+     * 3. Actions Enqueue/Stream/Skip/Clear/DurationLeft/QueueLeft -> Manages the audio playback for the channel.
+     * 4. Channel settings SetGain/Gain/SetPreemption/Preemption -> Available regardless of the device and the channel states.
      *
      * Requirements for concrete implementations:
      * 1. When the channel with index=i is opened all the channels where index < i should be muted.
@@ -47,21 +51,24 @@ namespace ml::amplifier
         time_t TickInterval_;
         size_t Channels_;
 
-        std::vector<std::atomic<bool>> OpenedChannels_;
+        std::vector<bool> OpenedChannels_;
 
         bool Working_ {};
         bool DesiredWorking_ {};
         bool UrgentStateChange_ {};
+        time_t StateChangeStart_ {};
         std::vector<std::promise<void>> ActivationListeners_;
         std::vector<std::promise<void>> DeactivationListeners_;
-        mutable std::recursive_mutex DeviceStateLock_;
 
-        std::jthread Mainloop_;
+        utils::Routine Mainloop_;
 
     public:
         /** Appends the track to the channel' queue, requires the device to be active and channel to be opened. */
         auto Enqueue(uint channel, const audio::Track& track) -> std::expected<std::future<void>, ActionError>;
 
+        /** Starts the live stream in the channel' queue ( optionally jitter-buffered ), requires the device to be active and channel to be opened. */
+        auto Stream(uint channel, const SDL_AudioSpec& format, const std::optional<audio::JitterConfig>& jitter) -> std::expected<std::shared_ptr<audio::LiveStream>, ActionError>;
+
         /** Skips the first track in the channel' queue, requires the device to be active and the channel to be opened. */
         auto Skip(uint channel) noexcept -> std::expected<void, ActionError>;
 
@@ -71,6 +78,21 @@ namespace ml::amplifier
         /** Estimates how much playback time is left for the particular channel, requires the device to be active and the channel to be opened. */
         auto DurationLeft(uint channel) const noexcept -> std::expected<time_t, ActionError>;
 
+        /** Returns the number of the entries in the channel' queue and for how long its tracks will play, the requirements are the same. */
+        auto QueueLeft(uint channel) const noexcept -> std::expected<std::pair<size_t, time_t>, ActionError>;
+
+        /** Sets the gain of the channel in dB, it's kept while the channel exists. */
+        void SetGain(uint channel, double db) noexcept;
+
+        /** Returns the gain of the channel in dB. */
+        auto Gain(uint channel) const noexcept -> double;
+
+        /** Sets what happens to the channel while a higher one plays, it's kept while the channel exists. */
+        void SetPreemption(uint channel, audio::PreemptPolicy policy) noexcept;
+
+        /** Returns the preemption policy of the channel. */
+        auto Preemption(uint channel) const noexcept -> audio::PreemptPolicy;
+
         /** Requests the activation of the amplifier, so it can play sound. */
         auto StartUp(bool urgently) noexcept -> std::future<void>;
 
@@ -89,22 +111,37 @@ namespace ml::amplifier
         /** Returns the number of amplifier' channels. */
         auto Channels() const noexcept -> size_t;
 
+        /**
+         * Rebuilds the channels list, the new channel i takes over the state of the old channel mapping[i].
+         * Old channels missing from the mapping are closed, channels mapped to nullopt are created closed.
+         */
+        void Remap(const std::vector<std::optional<uint>>& mapping) noexcept;
+
         /** Returns whether the device is ready for the playback. */
         auto Ready() const noexcept -> bool;
 
-        /** Returns how much time the device may take in order to start up in the worst case. */
+        /** Returns how much time the device is expected to take in order to start up. */
         auto StartupDuration(bool urgently) const noexcept -> time_t;
 
         /** Returns how much time the device may take in order to shut down in the worst case. */
         auto ShutdownDuration(bool urgently) const noexcept -> time_t;
 
     protected:
+        /** Guards the device state, implementations may hold it to synchronize with the mainloop. */
+        mutable std::recursive_mutex DeviceStateLock_;
+
         /** Creates the driver with some essential properties set. */
         Driver(const Config& config) noexcept;
 
+        /** Replaces the durations and the tick interval, the number of channels is left untouched. */
+        void Reconfigure(const Config& config) noexcept;
+
         /** Appends the track to the channel' queue, invoked only if the device and channel are active. */
         virtual auto DoEnqueue(uint channel, const audio::Track& track) -> std::optional<std::future<void>> = 0;
 
+        /** Starts the live stream in the channel' queue, invoked only if the device and channel are active. Returns nullptr for the unsupported format. */
+        virtual auto DoStream(uint channel, const SDL_AudioSpec& format, const std::optional<audio::JitterConfig>& jitter) -> std::shared_ptr<audio::LiveStream> = 0;
+
         /** Skips the first track in the channel' queue, invoked only of the device to be active and the channel is opened. */
         virtual void DoSkip(uint channel) noexcept = 0;
 
@@ -114,20 +151,41 @@ namespace ml::amplifier
         /** Estimates how much playback time is left for the particular channel, invoked only of the device to be active and the channel is opened. */
         virtual auto DoDurationLeft(uint channel) const noexcept -> time_t = 0;
 
+        /** Returns the number of the entries in the channel' queue and for how long its tracks will play, invoked only of the device to be active and the channel is opened. */
+        virtual auto DoQueueLeft(uint channel) const noexcept -> std::pair<size_t, time_t> = 0;
+
+        /** Sets the gain of the channel, invoked synchronously. */
+        virtual void DoSetGain(uint channel, double db) noexcept = 0;
+
+        /** Returns the gain of the channel, invoked synchronously. */
+        virtual auto DoGain(uint channel) const noexcept -> double = 0;
+
+        /** Sets the preemption policy of the channel, invoked synchronously. */
+        virtual void DoSetPreemption(uint channel, audio::PreemptPolicy policy) noexcept = 0;
+
+        /** Returns the preemption policy of the channel, invoked synchronously. */
+        virtual auto DoPreemption(uint channel) const noexcept -> audio::PreemptPolicy = 0;
+
         /** Opens the channel, invoked synchronously. */
         virtual void DoOpen(uint channel) noexcept = 0;
 
         /** Closes the channel, invoked synchronously. */
         virtual void DoClose(uint channel) noexcept = 0;
 
+        /** Rebuilds the channels list, invoked synchronously after the removed channels were closed. */
+        virtual void DoRemap(const std::vector<std::optional<uint>>& mapping) noexcept = 0;
+
         /** Activates the device, always called in the separate thread. Returns true when the device has been activated. */
         virtual bool DoActivation(time_t time, time_t elapsed, bool urgent) noexcept = 0;
 
         /** De-activates the device, always called in the separate thread. Returns true when the device is no longer active. */
         virtual bool DoDeactivation(time_t time, time_t elapsed, bool urgent) noexcept = 0;
 
+        /** Predicts the start up duration from the device' state. By default returns the worst case from the config. */
+        virtual auto DoStartupDuration(bool urgently) const noexcept -> time_t;
+
     private:
-        void Mainloop(const std::stop_token& token) noexcept;
+        auto Mainloop() noexcept -> time_t;
         auto ActionWrapper(uint channel) const noexcept -> std::expected<void, ActionError>;
         static void FulfillListeners(std::vector<std::promise<void>>& listeners) noexcept;
     };
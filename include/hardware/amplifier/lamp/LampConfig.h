@@ -1,9 +1,17 @@
 // Created by Tube Lab. Part of the meloun project.
 #pragma once
 
+#include "ThermalModel.h"
+
+#include "hardware/audio/backend/Backend.h"
+#include "hardware/audio/PagePool.h"
+#include "hardware/audio/BlendConfig.h"
+#include "hardware/relay/Driver.h"
+
 #include <string>
 #include <cstdint>
 #include <optional>
+#include <memory>
 
 namespace ml::amplifier
 {
@@ -15,13 +23,31 @@ namespace ml::amplifier
         /** Time that the speaker requires to cool down, so it's unusable again. */
         time_t CoolingDuration {};
 
-        /** Path to the port which is connected to the power-relay. */
-        std::string PowerPort {};
+        /** The shape of the lamps heating and cooling curves. */
+        ThermalCurve Thermal = TC_Binary;
+
+        /** The heat level ( 0..1 ) from which the lamps are usable, matters only for the exponential curve. */
+        double ThermalThreshold = 0.95;
+
+        /** The relay which powers the amplifier. */
+        std::shared_ptr<relay::Driver> PowerRelay {};
 
-        /** The name of the audio output connected to the speaker. */
-        std::optional<std::string> AudioDevice {};
+        /** The audio output connected to the speaker. */
+        std::shared_ptr<audio::Backend> AudioOutput {};
+
+        /** The pool of pages holding the queued audio. */
+        std::shared_ptr<audio::PagePool> AudioPool {};
+
+        /** The way the channels are overlaid. */
+        audio::BlendConfig Blending {};
+
+        /** The canonical format of the output, only freq, format and channels matter. */
+        SDL_AudioSpec AudioFormat { .freq = 44100, .format = AUDIO_S16LSB, .channels = 2 };
 
         /** The number of the amplifier channels. */
         uint Channels {};
+
+        /** The interval between the ticks of the mainloop in ms. */
+        time_t TickInterval = 20;
     };
 }
\ No newline at end of file
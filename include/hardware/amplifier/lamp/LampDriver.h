@@ -2,6 +2,7 @@
 #pragma once
 
 #include "LampConfig.h"
+#include "ThermalModel.h"
 #include "../Driver.h"
 
 #include "hardware/audio/ChannelsMixer.h"
@@ -14,29 +15,46 @@ namespace ml::amplifier
      * @safety Fully exception and thread safe.
      *
      * Due to old nature, such amplifiers always require warmup, so the driver takes care about this.
+     * The remaining warm-up is predicted by the thermal model from the actual power on/off history.
      */
     class LampDriver : public Driver
     {
-        time_t CoolingDuration_;
         std::shared_ptr<audio::ChannelsMixer> Mixer_;
         std::shared_ptr<relay::Driver> PowerRelay_;
-
-        std::atomic<time_t> DeactivatedAt_;
+        std::shared_ptr<ThermalModel> Thermal_;
 
     public:
         /** Creates a new driver instance based on the config. */
         static auto Create(const LampConfig& cfg) noexcept -> std::shared_ptr<LampDriver>;
 
+        /**
+         * Applies the durations, the thermal curve, the blending and the devices from the config, the channels count and the format are ignored.
+         * A new power relay takes over the state of the old one, a new audio output takes over the queues.
+         * Returns false when some part couldn't be applied, the rest is applied anyway.
+         */
+        auto Reconfigure(const LampConfig& cfg) noexcept -> bool;
+
+        /** Returns the format in which the audio is rendered, the tracks in this format are played without conversion. */
+        auto Spec() const noexcept -> SDL_AudioSpec;
+
     private:
         using Driver::Driver;
 
         auto DoEnqueue(uint channel, const audio::Track &track) -> std::optional<std::future<void>> final;
+        auto DoStream(uint channel, const SDL_AudioSpec& format, const std::optional<audio::JitterConfig>& jitter) -> std::shared_ptr<audio::LiveStream> final;
         void DoSkip(uint channel) noexcept final;
         void DoClear(uint channel) noexcept final;
         auto DoDurationLeft(uint channel) const noexcept -> time_t final;
+        auto DoQueueLeft(uint channel) const noexcept -> std::pair<size_t, time_t> final;
+        void DoSetGain(uint channel, double db) noexcept final;
+        auto DoGain(uint channel) const noexcept -> double final;
+        void DoSetPreemption(uint channel, audio::PreemptPolicy policy) noexcept final;
+        auto DoPreemption(uint channel) const noexcept -> audio::PreemptPolicy final;
         void DoOpen(uint channel) noexcept final;
         void DoClose(uint channel) noexcept final;
+        void DoRemap(const std::vector<std::optional<uint>>& mapping) noexcept final;
         bool DoActivation(time_t time, time_t elapsed, bool urgently) noexcept final;
         bool DoDeactivation(time_t time, time_t elapsed, bool urgently) noexcept final;
+        auto DoStartupDuration(bool urgently) const noexcept -> time_t final;
     };
 }
\ No newline at end of file
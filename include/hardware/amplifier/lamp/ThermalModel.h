@@ -0,0 +1,62 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "utils/CustomConstructor.h"
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+
+namespace ml::amplifier
+{
+    /** The shape of the lamps heating and cooling curves. */
+    enum ThermalCurve
+    {
+        TC_Binary = 0, ///< Either cold or warm. Warm lamps stay warm for the cooling duration after the power-off.
+        TC_Exponential = 1 ///< Newton's law: the heat approaches the target exponentially in both directions.
+    };
+
+    /**
+     * @brief Tracks the lamps heat from their power on/off history.
+     * @safety Fully exception and thread safe.
+     *
+     * The heat level is normalized: 0 - cold, 1 - fully warm, the lamps are usable from the threshold.
+     * The exponential time constants are derived from the durations:
+     * - Cold lamps reach the threshold exactly in the warming duration.
+     * - Fully warm lamps fall below the threshold exactly in the cooling duration.
+     */
+    class ThermalModel : public utils::CustomConstructor
+    {
+        ThermalCurve Curve_ {};
+        time_t WarmingDuration_ {};
+        time_t CoolingDuration_ {};
+        double Threshold_ {};
+
+        bool Powered_ {};
+        time_t Since_ {};
+        double Level_ {};
+        mutable std::mutex Lock_;
+
+    public:
+        /** Creates the model of the cold lamps. */
+        static auto Create(ThermalCurve curve, time_t warming, time_t cooling, double threshold) noexcept -> std::shared_ptr<ThermalModel>;
+
+        /** Registers that the lamps have been powered on at the given time. */
+        void PowerOn(time_t time) noexcept;
+
+        /** Registers that the lamps have been powered off at the given time. */
+        void PowerOff(time_t time) noexcept;
+
+        /**
+         * Replaces the curve parameters at the given time, fails on an invalid threshold.
+         * The power history is kept, so the current heat level carries over to the new curve.
+         */
+        auto Reconfigure(ThermalCurve curve, time_t warming, time_t cooling, double threshold, time_t time) noexcept -> bool;
+
+        /** Predicts how much time the lamps need to warm up if they are powered from the given time on. */
+        auto Remaining(time_t time) const noexcept -> time_t;
+
+    private:
+        auto LevelAt(time_t time) const noexcept -> double;
+    };
+}
@@ -0,0 +1,36 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include <ctime>
+
+namespace ml::audio
+{
+    /** The way the mixer overlays the channels. */
+    enum BlendMode
+    {
+        BM_Exclusive = 0, ///< Only the highest enabled channel is audible, the rest are muted.
+        BM_Ducking = 1 ///< All the enabled channels are audible, the active higher channels attenuate the lower ones.
+    };
+
+    /** What happens to the channel while a higher one takes over it in the exclusive mode. */
+    enum PreemptPolicy
+    {
+        PP_Mute = 0, ///< The channel keeps playing silently, the preempted audio is lost.
+        PP_Pause = 1 ///< The channel freezes at its position and resumes exactly there once it's audible again.
+    };
+
+    struct BlendConfig
+    {
+        /** The way the channels are overlaid. */
+        BlendMode Mode = BM_Exclusive;
+
+        /** How much the lower channels are attenuated while a higher channel plays, in dB. */
+        double DuckDepth = 12;
+
+        /** Time to fade out the gain fully ( the ducking start or the gain decrease ). */
+        time_t DuckAttack = 50;
+
+        /** Time to fade in the gain fully ( the ducking end or the gain increase ). */
+        time_t DuckRelease = 500;
+    };
+}
@@ -1,13 +1,24 @@
 // Created by Tube Lab. Part of the meloun project.
 #pragma once
 
+#include "hardware/audio/backend/Backend.h"
+#include "hardware/audio/BlendConfig.h"
 #include "hardware/audio/Player.h"
+#include "hardware/audio/LiveStream.h"
+#include "hardware/audio/PagePool.h"
 #include "hardware/audio/Track.h"
 
+#include "utils/Metrics.h"
+#include "utils/Realtime.h"
+
 #include <algorithm>
 #include <vector>
 #include <mutex>
 #include <ranges>
+#include <chrono>
+#include <utility>
+#include <cmath>
+#include <bit>
 
 namespace ml::audio
 {
@@ -16,27 +27,65 @@ namespace ml::audio
      * @safety Fully exception and thread safe.
      *
      * Features:
+     * - Renders all the channels into a single output backend.
      * - Allows to overlay multiple channels.
      * - Each particular channel has the same capabilities as a Player instance.
-     * - Overlay system based on priorities. When the channel with id=k is enabled all channels which id's < k are muted.
-     *   This works even if channel with id=k is muted, so always pay attention to this fact.
+     * - Overlay system based on priorities, the higher id wins:
+     *   - Exclusive: when the channel with id=k is enabled all channels which id's < k are muted.
+     *     This works even if channel with id=k is muted, so always pay attention to this fact.
+     *   - Ducking: all the enabled channels are mixed, while the channel with id=k plays the channels which id's < k
+     *     are attenuated by the duck depth. The attenuation fades in and out with the attack and release ramps.
      *   Note that even when the channel is disabled it continues to play.
-     * - Do not support any kind of the channel blending.
+     * - Preemption policy per channel, in the exclusive mode the channel below the audible one is either muted ( it keeps playing
+     *   silently ) or paused ( it resumes exactly where it stopped ). The pause doesn't touch the pause state of the channel.
+     * - Per-channel gain in dB, its changes are ramped as well, so they never click.
+     * - The channels are mixed in float in a single vectorized pass over the output buffer, the sum is clipped.
+     * - The enabled channels are kept in a bitset, so the highest one is found by a scan of a few words even among hundreds of channels.
+     *   A change touches only the changed channel and, in the exclusive mode, the channels between the old and the new audible one.
+     *
+     * Metrics:
+     * - audio_underruns: the output asked for the audio later than its buffer could last ( the device starved ).
      *
      * Warnings:
      * - Each channel is muted by default. This allows you to upload all the necessary tracks into it.
      */
     class ChannelsMixer : public utils::CustomConstructor
     {
+        /** The state of the channel inside the audio callback. */
+        struct Lane
+        {
+            std::vector<uint8_t> Rendered; ///< The audio of the channel for the current callback.
+            bool Active {}; ///< Whether the channel has rendered any audio in the current callback.
+            float Level = 1; ///< The linear gain currently applied, follows the target by the ramps.
+            float Step {}; ///< The change of the level per sample in the current callback.
+        };
+
+        std::shared_ptr<Backend> Output_ {};
+        std::shared_ptr<PagePool> Pool_ {};
+        SDL_AudioSpec Spec_ {};
+        std::chrono::steady_clock::time_point LastSupply_ {};
+
         std::vector<std::shared_ptr<Player>> Channels_ {};
 
-        std::vector<bool> EnabledChannels_ {};
+        std::vector<uint64_t> EnabledChannels_ {}; ///< The bitset of the enabled channels, 64 channels per word.
+        std::optional<size_t> Selected_ {}; ///< The highest enabled channel the states were applied for.
         std::vector<bool> MutedChannels_ {};
+        std::vector<double> Gains_ {};
+        std::vector<PreemptPolicy> Policies_ {};
+        std::vector<Lane> Lanes_ {};
+        BlendConfig Blending_ {};
         mutable std::recursive_mutex ChannelsStatesLock_ {};
 
     public:
-        /** Creates the channel mixer that's bound to some audio-device. */
-        static auto Create(uint channels, const std::optional<std::string>& audioDevice = std::nullopt) -> std::shared_ptr<ChannelsMixer>;
+        /**
+         * Creates the channel mixer that renders into the given output in the canonical format ( freq, format and channels ).
+         * The queues of all the channels share the pages of the pool.
+         */
+        static auto Create(uint channels, const std::shared_ptr<Backend>& output, const SDL_AudioSpec& format, const std::shared_ptr<PagePool>& pool,
+            const BlendConfig& blending) -> std::shared_ptr<ChannelsMixer>;
+
+        /** Stops the playback and closes the output. */
+        ~ChannelsMixer() override;
 
         /** Temporary pauses the playback in all channels. */
         void Pause() noexcept;
@@ -50,6 +99,9 @@ namespace ml::audio
         /** Appends the audio track to the particular channel. Doesn't clear the pause state. */
         auto Enqueue(uint channel, const Track& audio) noexcept -> std::optional<std::future<void>>;
 
+        /** Starts the live stream at the end of the channel' queue, optionally played through the jitter buffer. */
+        auto Stream(uint channel, const SDL_AudioSpec& format, const std::optional<JitterConfig>& jitter) noexcept -> std::shared_ptr<LiveStream>;
+
         /** Empties the channel. Channel' playback will be stopped immediately. Doesn't pause the channel. */
         void Clear(uint channel) noexcept;
 
@@ -74,6 +126,21 @@ namespace ml::audio
         /** Unmutes the channel. */
         void Unmute(uint channel) noexcept;
 
+        /** Sets the gain of the channel in dB, the change is ramped. */
+        void SetGain(uint channel, double db) noexcept;
+
+        /** Returns the gain of the channel in dB. */
+        auto Gain(uint channel) const noexcept -> double;
+
+        /** Sets what happens to the channel while a higher one plays. */
+        void SetPreemption(uint channel, PreemptPolicy policy) noexcept;
+
+        /** Returns the preemption policy of the channel. */
+        auto Preemption(uint channel) const noexcept -> PreemptPolicy;
+
+        /** Replaces the blending policy, the levels move to the new targets by the new ramps. */
+        void SetBlending(const BlendConfig& blending) noexcept;
+
         /** Returns whether the channel is enabled. */
         auto Enabled(uint channel) const noexcept -> bool;
 
@@ -86,6 +153,9 @@ namespace ml::audio
         /** Determines for how long the channel will continue to play. */
         auto DurationLeft(uint channel) const noexcept -> time_t;
 
+        /** Returns the number of the entries in the channel' queue and for how long its tracks will play. */
+        auto QueueLeft(uint channel) const noexcept -> std::pair<size_t, time_t>;
+
         /** Determines the duration of the longest channel. */
         auto DurationLeft() const noexcept -> time_t;
 
@@ -95,8 +165,32 @@ namespace ml::audio
         /** Returns the number of mixer' channels. */
         auto Channels() const noexcept -> size_t;
 
+        /** Returns the format in which the channels are rendered. */
+        auto Spec() const noexcept -> SDL_AudioSpec;
+
+        /**
+         * Rebuilds the channels list, the new channel i takes over the player, the gain and the policy of the old channel mapping[i].
+         * Channels mapped to nullopt start empty with 0 dB gain and the mute policy, the players of the dropped channels are cleared.
+         */
+        void Remap(const std::vector<std::optional<uint>>& mapping) noexcept;
+
+        /**
+         * Moves the playback to another output without touching the queues.
+         * Fails and keeps the current output when the new one can't render the current sample format.
+         */
+        auto Rebind(const std::shared_ptr<Backend>& output) noexcept -> bool;
+
     private:
+        auto Channel(uint channel) const noexcept -> std::shared_ptr<Player>;
+        static void AudioSupplier(void* userdata, uint8_t* stream, int len) noexcept;
+        void Blend(uint8_t* stream, size_t len) noexcept;
+        template <typename T> void MixAs(uint8_t* stream, size_t len) noexcept;
+        auto Ramp(float level, float target, size_t frames) const noexcept -> float;
         void UpdateChannel(size_t channel, std::optional<bool> enabled, std::optional<bool> muted) noexcept;
+        auto IsEnabled(size_t channel) const noexcept -> bool;
+        auto HighestEnabled() const noexcept -> std::optional<size_t>;
+        void Reselect(size_t changed) noexcept;
         void SelectChannel() noexcept;
+        void Apply(size_t channel) noexcept;
     };
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Track.h"
+#include "TrackLoader.h"
+#include "Loudness.h"
+#include "Utils.h"
+
+#include "utils/CustomConstructor.h"
+#include "utils/MappedFile.h"
+
+#include <unordered_map>
+#include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <functional>
+
+namespace ml::audio
+{
+    /**
+     * @brief The library of prerecorded clips ready for the playback.
+     * @safety Fully exception and thread safe.
+     *
+     * The wav files of the directory are decoded once, resampled to the output format and packed into the bundle
+     * ( clips.bundle in the same directory ) that is mapped read-only. The bundle is reused by the next start while
+     * it's newer than the wav files and has the same format, so the start doesn't decode anything at all.
+     * The clips are the views into the mapping, hence playing a clip never copies its samples.
+     * The loudness of each clip is measured while packing and kept in the bundle, so the normalization is free.
+     *
+     * Warnings:
+     * - The clip names are the file names without .wav, shorter than 64 characters.
+     */
+    class ClipLibrary : public utils::CustomConstructor
+    {
+        std::shared_ptr<utils::MappedFile> Bundle_;
+        std::unordered_map<std::string, Track> Clips_;
+
+    public:
+        /** Loads the clips from the directory in the given format, packs them again when the bundle is outdated. */
+        static auto Create(const std::string& directory, const SDL_AudioSpec& spec) noexcept -> std::shared_ptr<ClipLibrary>;
+
+        /** Returns the clip by its name, nullptr when there's no such clip. */
+        auto Find(const std::string& name) const noexcept -> const Track*;
+
+        /** Returns the name of the clip the samples are taken from and their offset in it, nullopt for the foreign samples. */
+        auto Locate(std::span<const uint8_t> samples) const noexcept -> std::optional<std::pair<std::string, size_t>>;
+
+        /** Returns the number of the clips. */
+        auto Size() const noexcept -> size_t;
+
+    private:
+        static auto Load(const std::filesystem::path& bundle, const SDL_AudioSpec& spec, const std::vector<std::filesystem::path>& sources) noexcept
+            -> std::shared_ptr<ClipLibrary>;
+
+        static auto Pack(const std::filesystem::path& bundle, const SDL_AudioSpec& spec, const std::vector<std::filesystem::path>& sources) noexcept
+            -> bool;
+    };
+}
@@ -0,0 +1,112 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "JitterConfig.h"
+#include "Utils.h"
+
+#include "utils/CustomConstructor.h"
+#include "utils/Metrics.h"
+#include "utils/Time.h"
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+#include <mutex>
+#include <map>
+#include <span>
+#include <cmath>
+#include <SDL2/SDL.h>
+
+namespace ml::audio
+{
+    /**
+     * @brief The adaptive jitter buffer of a live stream.
+     * @safety Fully exception and thread safe.
+     *
+     * The packets are pushed by the network as they arrive and pulled by the output at its own pace:
+     * - The packets are reordered by their sequence numbers ( 16 bit, wrapping ), the late and the duplicate ones are dropped.
+     * - The packets are kept in their source format and converted into the output format as they are played,
+     *   so the conversion never breaks the packet boundaries or the order.
+     * - The jitter is estimated as in RFC 3550, the target latency follows it between the configured latency and the maximum.
+     * - The playback starts once the target latency is buffered, the excess delay is drained by playing the packets
+     *   faster ( the tail of the packet is overlapped with its end ), so the pitch is kept.
+     * - The buffer never holds more than the maximum latency, the oldest packets are dropped when the producer outruns the output.
+     * - The lost packets and the short underruns are concealed by playing the last packet back and forth with a fade out,
+     *   the concealment is cross-faded into the next packet, so the gaps never click.
+     * - Pull never allocates: the scratch buffers are reserved by Push and the played packets are freed by the next Push.
+     *
+     * Metrics:
+     * - jitter_ms: the estimated jitter of the arriving packets.
+     * - jitter_delay_ms: the audio buffered when a packet starts playing.
+     * - jitter_late_packets: the packets that arrived after their playback time and were dropped.
+     * - jitter_lost_packets: the packets that never arrived and were concealed.
+     * - jitter_dropped_packets: the packets dropped as the buffer exceeded the maximum latency.
+     * - jitter_underruns: the times the buffer ran dry while the stream was open.
+     *
+     * Warnings:
+     * - The concealment and the draining support u8, s16, s32 and f32 in the native byte order as the source format
+     *   ( the other formats are concealed by silence and never drained ).
+     * - The converter is fed in small portions from the audio callback, it allocates only while it grows to its working size.
+     */
+    class JitterBuffer : public utils::CustomConstructor
+    {
+        SDL_AudioSpec Spec_ {}; ///< The format of the packets.
+        SDL_AudioSpec Output_ {};
+        JitterConfig Config_ {};
+        size_t Frame_ {};
+
+        SDL_AudioStream* Converter_ {};
+        std::vector<uint8_t> Scratch_; ///< The played packets on their way into the converter.
+        std::vector<uint8_t> Discard_; ///< The converted audio of the muted playback.
+        bool Flushed_ {};
+
+        std::map<uint64_t, std::vector<uint8_t>> Packets_;
+        std::vector<std::map<uint64_t, std::vector<uint8_t>>::node_type> Released_; ///< The played packets, freed by the producer.
+        size_t Buffered_ {};
+        std::optional<uint64_t> Highest_;
+        std::optional<uint64_t> Next_;
+
+        std::vector<uint8_t> Current_;
+        std::vector<uint8_t> Source_; ///< The last played packet that arrived, the concealment is made of it.
+        std::vector<uint8_t> Tail_; ///< The concealment cross-faded into the packet that ends it.
+        size_t Offset_ {};
+        size_t Concealed_ {};
+        bool Playing_ {};
+        bool Ended_ {};
+
+        double Jitter_ {};
+        std::optional<double> Transit_;
+        mutable std::recursive_mutex Lock_;
+
+    public:
+        /** Creates the buffer for the packets in the source format, they are played in the output format. */
+        static auto Create(const SDL_AudioSpec& from, const SDL_AudioSpec& to, const JitterConfig& config) noexcept
+            -> std::shared_ptr<JitterBuffer>;
+
+        /** Frees the converter. */
+        ~JitterBuffer();
+
+        /** Adds the packet of the whole frames. Returns false when the packet is late or duplicate, so it's dropped. */
+        auto Push(uint16_t sequence, std::span<const uint8_t> samples) noexcept -> bool;
+
+        /** Writes up to len bytes of the playback in the output format ( nullptr discards them ). Returns the number of the produced bytes. */
+        auto Pull(uint8_t* stream, size_t len) noexcept -> size_t;
+
+        /** Marks the end of the stream, the rest is played without waiting for the target latency. */
+        void End() noexcept;
+
+        /** Returns whether the stream has ended and everything is played. */
+        auto Drained() const noexcept -> bool;
+
+        /** Returns the duration of the buffered audio. */
+        auto Buffered() const noexcept -> time_t;
+
+        /** Returns the latency the buffer currently aims for. */
+        auto Target() const noexcept -> time_t;
+
+    private:
+        auto PullSource(uint8_t* stream, size_t len) noexcept -> size_t;
+        auto NextPacket() noexcept -> bool;
+        void Conceal() noexcept;
+    };
+}
@@ -0,0 +1,16 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include <ctime>
+
+namespace ml::audio
+{
+    struct JitterConfig
+    {
+        /** The latency the buffer keeps when the network is calm, the playback starts once this much audio is buffered. */
+        time_t TargetLatency = 60;
+
+        /** The upper bound of the latency, the buffer never adapts to the jitter beyond it and drops the audio past it. */
+        time_t MaxLatency = 300;
+    };
+}
@@ -0,0 +1,83 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Player.h"
+#include "JitterBuffer.h"
+#include "Utils.h"
+
+#include "utils/CustomConstructor.h"
+#include "utils/Metrics.h"
+#include "utils/Time.h"
+
+#include <optional>
+#include <future>
+#include <mutex>
+#include <vector>
+#include <span>
+#include <SDL2/SDL.h>
+
+namespace ml::audio
+{
+    /**
+     * @brief The live audio stream into the player ( intercom, VoIP ).
+     * @safety Fully exception and thread safe.
+     *
+     * Features:
+     * - Accepts the raw samples in arbitrary portions, the incomplete frames are carried over to the next portion.
+     * - Converts the samples into the player' format on the fly, the converter is created only when the formats differ.
+     *   The jitter buffer takes the packets in their own format and converts them after the reordering.
+     * - The samples become audible as soon as they are fed, the stream holds its place in the player' queue.
+     * - Optionally smooths the network jitter by the jitter buffer.
+     *
+     * Metrics:
+     * - stream_queue_latency_ms: how long the fed samples wait in the queue of the player.
+     * - stream_e2e_latency_ms: the time between the capture of the samples and their playback, when the capture time is known.
+     *
+     * Warnings:
+     * - The latencies don't include the buffer of the output device.
+     * - The stream is ended on the destruction, so its listener is invoked even if End wasn't called.
+     */
+    class LiveStream : public utils::CustomConstructor
+    {
+        std::shared_ptr<Player> Player_;
+        uint64_t Id_ {};
+        std::optional<std::future<void>> Listener_;
+
+        SDL_AudioSpec From_ {};
+        SDL_AudioSpec To_ {};
+        SDL_AudioStream* Converter_ {};
+        std::vector<uint8_t> Partial_;
+        std::vector<uint8_t> Converted_;
+
+        std::optional<time_t> CaptureTime_;
+        size_t Fed_ {};
+        uint16_t Sequence_ {};
+        std::mutex Lock_;
+
+    public:
+        /**
+         * Starts the stream at the end of the player' queue, the samples are expected in the given format.
+         * When the jitter config is given the stream is played through the jitter buffer.
+         */
+        static auto Create(const std::shared_ptr<Player>& player, const SDL_AudioSpec& from, const std::optional<JitterConfig>& jitter)
+            noexcept -> std::shared_ptr<LiveStream>;
+
+        /** Ends the stream. */
+        ~LiveStream();
+
+        /**
+         * Appends the samples to the stream, each portion is a packet for the jitter buffer. The packets are numbered in the order
+         * of arrival unless the sequence number is given. Fails if the stream was skipped or cleared, or the queue can't take more audio.
+         */
+        auto Feed(std::span<const uint8_t> samples, std::optional<uint16_t> sequence = std::nullopt) noexcept -> bool;
+
+        /** Sets the capture time ( ms since the epoch ) of the first fed sample, enables the end-to-end latency. */
+        void SetCaptureTime(time_t time) noexcept;
+
+        /** Ends the stream, the returned listener is invoked once the rest is played. Further feeds fail. */
+        auto End() noexcept -> std::future<void>;
+
+    private:
+        auto Push(std::span<const uint8_t> samples, std::optional<uint16_t> sequence) noexcept -> bool;
+    };
+}
@@ -0,0 +1,37 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Track.h"
+#include "Utils.h"
+
+#include <optional>
+#include <vector>
+#include <array>
+#include <cmath>
+
+namespace ml::audio
+{
+    /**
+     * @brief The loudness measurement and normalization ( ITU-R BS.1770-4, EBU R128 ).
+     * @safety Fully exception and thread safe.
+     *
+     * The integrated loudness is measured over 400ms blocks with 75% overlap of the K-weighted signal,
+     * gated at -70 LUFS and then at 10 LU below the loudness of the remaining blocks.
+     * The measurement is cached in the track, so the normalization never measures the same track twice.
+     *
+     * Warnings:
+     * - The normalization only sets the gain of the track, the samples are scaled on the playback.
+     */
+    class Loudness
+    {
+    public:
+        /** Measures the integrated loudness of the track in LUFS. Returns nullopt when the track is silent. */
+        static auto Measure(const Track& track) noexcept -> std::optional<double>;
+
+        /**
+         * Sets the gain of the track that brings it to the target loudness, but never raises it more than by max gain ( dB ).
+         * The loudness is measured only if the track doesn't have it yet. Silent tracks are left untouched.
+         */
+        static void Normalize(Track& track, double target, double maxGain) noexcept;
+    };
+}
@@ -0,0 +1,64 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "utils/CustomConstructor.h"
+#include "utils/Metrics.h"
+
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include <sys/mman.h>
+
+namespace ml::audio
+{
+    /**
+     * @brief A pool of fixed-size pages holding the queued audio.
+     * @safety Fully exception and thread safe, lock-free.
+     *
+     * The pages are carved out of a single mapping reserved up front ( optionally backed by huge pages ),
+     * so acquiring and releasing a page is O(1) and never touches the heap.
+     *
+     * Metrics:
+     * - audio_pool_pages: the number of pages in the pool.
+     * - audio_pool_pages_used: the number of pages currently holding the audio ( including the overflow ).
+     * - audio_pool_overflows: how many pages have been allocated on the heap because the pool was exhausted.
+     *
+     * Warnings:
+     * - When the pool is exhausted the pages are allocated on the heap, so the playback never fails because of it.
+     *   The released heap pages are retired and reused or freed by the next Acquire, so the playback never calls the allocator.
+     */
+    class PagePool : public utils::CustomConstructor
+    {
+        uint8_t* Memory_ {};
+        size_t Mapped_ {};
+        size_t PageSize_ {};
+        uint32_t Pages_ {};
+
+        std::unique_ptr<std::atomic<uint32_t>[]> Next_;
+        std::atomic<uint64_t> Head_ {}; // the tag in the high half ( against ABA ), the page index + 1 in the low half
+        std::atomic<uint8_t*> Retired_ {}; // the released heap pages, linked through their first bytes
+
+    public:
+        /** Reserves the pool, huge pages are used when available and requested. The locked pool is pre-faulted and kept in the memory. */
+        static auto Create(size_t pageSize, uint32_t pages, bool hugepages, bool locked = false) noexcept -> std::shared_ptr<PagePool>;
+
+        /** Releases the whole mapping, all the pages must be released before. */
+        ~PagePool() override;
+
+        /** Takes a page from the pool. Returns nullptr only if the pool is exhausted and the heap is as well. Never call from the audio thread. */
+        auto Acquire() noexcept -> uint8_t*;
+
+        /** Returns the page acquired from this pool. */
+        void Release(uint8_t* page) noexcept;
+
+        /** Returns the size of a page in bytes. */
+        auto PageSize() const noexcept -> size_t;
+
+    private:
+        auto Owns(const uint8_t* page) const noexcept -> bool;
+        static void Free(uint8_t* pages) noexcept;
+    };
+}
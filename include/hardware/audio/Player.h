@@ -3,15 +3,21 @@
 
 #include "Track.h"
 #include "Utils.h"
+#include "PagePool.h"
+#include "JitterBuffer.h"
 
 #include "utils/CustomConstructor.h"
+#include "utils/Metrics.h"
+#include "utils/Time.h"
 
 #include <optional>
+#include <cstring>
 #include <utility>
 #include <string>
 #include <future>
 #include <mutex>
 #include <deque>
+#include <ranges>
 #include <unordered_map>
 
 namespace ml::audio
@@ -21,10 +27,20 @@ namespace ml::audio
      * @safety Fully exception and thread safe.
      *
      * Features:
-     * - Built on top of SDL audio subsystem.
+     * - Doesn't own the output, the audio is pulled from the player via Supply ( usually by the mixer ).
      * - Provides pause/resume methods.
      * - Provides mute/unmute methods.
+     * - Provides preempt/restore methods, they freeze the playback apart from the pause requested by the user.
      * - Supports queue, so it is fully suitable for VoIP applications.
+     * - Supports live streams, they take their place in the queue and grow while they are played.
+     *   The stream may be played through the jitter buffer, then the packets are reordered and the gaps are concealed.
+     * - The queued audio is converted into the pages of the pool, the persistent tracks in the right format are referenced.
+     * - The gain of the track is applied on the playback, so the normalized tracks aren't copied.
+     * - Every page is returned to the pool as soon as it's played, so only the unplayed audio stays in the memory.
+     *
+     * Metrics:
+     * - audio_first_sample_delay_ms: the time between the enqueuing of a track and its first audible sample.
+     * - stream_backlog_overflows: the feeds rejected as the live stream had too much unplayed audio.
      *
      * Warnings:
      * - The player is paused by default.
@@ -33,32 +49,71 @@ namespace ml::audio
     {
         struct Entry
         {
-            std::vector<uint8_t> Data;
+            std::shared_ptr<const void> Owner; ///< Keeps the referenced samples alive.
+            std::vector<std::span<const uint8_t>> Segments;
+            bool Pooled {}; ///< Whether the segments are the pages of the pool.
+            size_t Segment {};
+            size_t Offset {};
+            size_t Size {};
+            size_t Idx {};
+            float Gain = 1;
+            uint64_t Stream {}; ///< The id of the live stream, zero for the tracks.
+            bool Open {}; ///< Whether the live stream may still grow.
+            std::shared_ptr<JitterBuffer> Jitter; ///< Plays the live stream instead of the pages when set.
             std::promise<void> Listener;
-            size_t Idx;
+            time_t EnqueuedAt {};
         };
 
         SDL_AudioSpec Spec_ {};
-        SDL_AudioDeviceID Out_ {};
+        std::shared_ptr<PagePool> Pool_;
 
         std::atomic<bool> Paused_;
         std::atomic<bool> Muted_;
+        std::atomic<bool> Preempted_ {};
 
         std::deque<Entry> Buffer_;
         size_t BufferLength_ {};
+        uint64_t NextStream_ = 1;
         mutable std::recursive_mutex BufferLock_;
 
     public:
-        /** Creates a player that utilizes the given audio output. */
-        static auto Create(const std::optional<std::string>& device = std::nullopt) -> std::shared_ptr<Player>;
+        /** Creates a player that produces the audio in the given format, the queue is kept in the pages of the pool. */
+        static auto Create(const SDL_AudioSpec& spec, const std::shared_ptr<PagePool>& pool) -> std::shared_ptr<Player>;
 
-        /** Stops playback and closes the audio device. */
+        /** Stops playback. */
         ~Player();
 
-        /** Plays the audio track. Doesn't clear the pause state. Fails if the track can't be resampled properly. */
+        /**
+         * Writes the next portion of the queue over the silent stream, the rest of the stream is left untouched.
+         * Muted player consumes the audio without writing it. Returns the number of the written bytes.
+         */
+        auto Supply(uint8_t* stream, int len) noexcept -> size_t;
+
+        /**
+         * Plays the audio track. Doesn't clear the pause state. Fails if the track can't be resampled properly.
+         * The track in the player' format is queued as is, without copying the samples.
+         */
         auto Enqueue(const Track& audio) noexcept -> std::optional<std::future<void>>;
 
-        /** Empties the queue. Playback will be stopped immediately. Doesn't clear the pause state. */
+        /**
+         * Starts the live stream at the end of the queue, the samples are appended by Feed until the stream is ended.
+         * The playback waits for the samples while the stream is open. Returns the id of the stream and its listener.
+         * When the jitter buffer is given the samples are played through it, the stream ends once it's drained.
+         */
+        auto BeginStream(const std::shared_ptr<JitterBuffer>& jitter = nullptr) noexcept -> std::pair<uint64_t, std::future<void>>;
+
+        /**
+         * Appends the whole frames to the stream, the sequence number matters only for the jitter buffer.
+         * The samples are in the player' format, or in the source format of the jitter buffer when the stream has one.
+         * Fails if the stream has been ended, skipped or cleared, or it already holds 10 seconds of the unplayed audio
+         * ( the jitter buffer drops the oldest packets past its maximum latency instead ).
+         */
+        auto Feed(uint64_t stream, std::span<const uint8_t> samples, uint16_t sequence = 0) noexcept -> bool;
+
+        /** Ends the stream, its listener is invoked once the rest is played. */
+        void EndStream(uint64_t stream) noexcept;
+
+        /** Empties the queue in O(pages). Playback will be stopped immediately. Doesn't clear the pause state. */
         void Clear() noexcept;
 
         /** Drops the first track in the queue and immediately moves to the next one. */
@@ -76,17 +131,38 @@ namespace ml::audio
         /** Unmutes the player. */
         void Unmute() noexcept;
 
+        /** Freezes the playback while a higher channel plays, independently of the pause state. */
+        void Preempt() noexcept;
+
+        /** Lets the preempted playback continue from where it stopped. */
+        void Restore() noexcept;
+
+        /** Returns the preemption state. */
+        auto Preempted() const noexcept -> bool;
+
         /** Returns the pause state. */
         auto Paused() const noexcept -> bool;
 
         /** Returns the mute state. */
         auto Muted() const noexcept -> bool;
 
+        /** Returns the format of the produced audio. */
+        auto Spec() const noexcept -> SDL_AudioSpec;
+
         /** Determines for how long the player will continue to play. */
         auto DurationLeft() const noexcept -> time_t;
 
+        /** Returns the number of the queued entries ( the tracks and the streams ) and for how long the queued tracks will play. */
+        auto QueueLeft() const noexcept -> std::pair<size_t, time_t>;
+
     private:
-        static void AudioSupplier(void* userdata, uint8_t* stream, int len) noexcept;
+        auto Fill(const Track& audio, Entry& entry) noexcept -> bool;
+        void Release(Entry& entry) noexcept;
         void DropFirstEntry() noexcept;
+        void DropFinished() noexcept;
+        static auto Finished(const Entry& entry) noexcept -> bool;
+        void NextSegment(Entry& entry) noexcept;
+        auto FindStream(uint64_t stream) noexcept -> Entry*;
+        auto PageCapacity() const noexcept -> size_t;
     };
 }
\ No newline at end of file
@@ -0,0 +1,67 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "utils/CustomConstructor.h"
+
+#include <optional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <span>
+#include <SDL2/SDL.h>
+
+#ifdef ML_WITH_OPUS
+#include <opus/opus.h>
+#endif
+
+namespace ml::audio
+{
+    /** The RTP packet ( RFC 3550 ), the payload references the received datagram. */
+    struct RtpPacket
+    {
+        uint8_t Type {};
+        bool Marker {};
+        uint16_t Sequence {};
+        uint32_t Timestamp {};
+        uint32_t Ssrc {};
+        std::span<const uint8_t> Payload;
+    };
+
+    /**
+     * @brief Decodes the payload of the RTP audio stream into the raw samples.
+     * @safety Exception safe, a single decoder must be used by one thread at a time.
+     *
+     * Supported encodings:
+     * - "pcmu", "pcma": G.711 μ-law and A-law, decoded into s16 by the tables.
+     * - "l16": the big-endian s16, passed as is ( the format of the samples tells the byte order ).
+     * - "opus": decoded into s16 by libopus, available only when built with ML_WITH_OPUS.
+     */
+    class RtpDecoder : public utils::CustomConstructor
+    {
+        std::string Encoding_;
+        SDL_AudioSpec Spec_ {};
+        std::vector<uint8_t> Decoded_;
+
+#ifdef ML_WITH_OPUS
+        OpusDecoder* Opus_ {};
+#endif
+
+    public:
+        /** Creates the decoder of the payload with the given rate and channels. Fails for the unsupported encoding or format. */
+        static auto Create(const std::string& encoding, int rate, uint8_t channels) noexcept -> std::shared_ptr<RtpDecoder>;
+
+        /** Releases the codec. */
+        ~RtpDecoder();
+
+        /** Parses the header of the RTP packet ( the version, the CSRCs, the extension and the padding ). */
+        static auto Parse(std::span<const uint8_t> datagram) noexcept -> std::optional<RtpPacket>;
+
+        /** Decodes the payload, the samples are valid till the next call. Returns an empty span when the payload is invalid. */
+        auto Decode(std::span<const uint8_t> payload) noexcept -> std::span<const uint8_t>;
+
+        /** Returns the format of the decoded samples. */
+        auto Spec() const noexcept -> SDL_AudioSpec;
+    };
+}
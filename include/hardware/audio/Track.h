@@ -4,7 +4,9 @@
 #include <SDL2/SDL.h>
 
 #include <optional>
+#include <memory>
 #include <vector>
+#include <span>
 #include <string_view>
 
 namespace ml::audio
@@ -12,16 +14,39 @@ namespace ml::audio
     /**
      * @brief A parsed audio file loaded to the memory.
      * @safety Fully exception and thread safe.
+     *
+     * The samples are immutable and shared between the copies, so copying the track never copies the audio.
      */
     class Track
     {
-        std::vector<uint8_t> Buffer_;
+        std::shared_ptr<const void> Owner_;
+        std::span<const uint8_t> Buffer_;
         SDL_AudioSpec Spec_ {};
+        bool Persistent_ {};
+        std::optional<double> Loudness_ {};
+        float Gain_ = 1;
 
     public:
+        /** Creates the track that owns the samples. */
         Track(std::vector<uint8_t> buffer, SDL_AudioSpec spec) noexcept;
 
-        auto Buffer() const noexcept -> const std::vector<uint8_t>&; ///< Returns the audio buffer.
+        /**
+         * Creates the track that references the samples kept alive by the owner ( e.g. a mapped file ).
+         * The samples of the persistent track outlive its playback, so the players may reference them instead of copying.
+         */
+        Track(std::shared_ptr<const void> owner, std::span<const uint8_t> buffer, SDL_AudioSpec spec, bool persistent = false) noexcept;
+
+        auto Buffer() const noexcept -> std::span<const uint8_t>; ///< Returns the audio buffer.
+        auto Owner() const noexcept -> const std::shared_ptr<const void>&; ///< Returns the holder of the audio buffer.
         auto Spec() const noexcept -> const SDL_AudioSpec&; ///< Returns the audio format info.
+        auto Persistent() const noexcept -> bool; ///< Returns whether the samples may be referenced by the queues.
+        auto Loudness() const noexcept -> std::optional<double>; ///< Returns the integrated loudness in LUFS if it has been measured.
+        auto Gain() const noexcept -> float; ///< Returns the linear gain applied on the playback.
+
+        /** Returns the track that references a part of the samples, everything else is kept. */
+        auto Slice(size_t offset, size_t size) const noexcept -> Track;
+
+        void SetLoudness(std::optional<double> loudness) noexcept; ///< Caches the measured loudness, so it's never measured again.
+        void SetGain(float gain) noexcept; ///< Sets the gain applied on the playback, the samples are left untouched.
     };
 }
\ No newline at end of file
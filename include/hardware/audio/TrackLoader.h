@@ -3,6 +3,9 @@
 
 #include "Track.h"
 
+#include <span>
+#include <string>
+
 namespace ml::audio
 {
     /**
@@ -12,7 +15,13 @@ namespace ml::audio
     class TrackLoader
     {
     public:
-        /** Tries to parse audio encoded as wav. */
-        static auto FromWav(const std::vector<char> &wav) noexcept -> std::optional<Track>;
+        /** Tries to parse audio encoded as wav. The track references the decoder' buffer, so nothing is copied. */
+        static auto FromWav(std::span<const char> wav) noexcept -> std::optional<Track>;
+
+        /**
+         * Wraps the raw interleaved samples of the given format, fails when the data isn't made of whole frames.
+         * The track takes over the samples as persistent, so in the player' format it's played right from them without any copies.
+         */
+        static auto FromPcm(std::string pcm, const SDL_AudioSpec& spec) noexcept -> std::optional<Track>;
     };
 }
\ No newline at end of file
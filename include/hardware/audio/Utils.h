@@ -2,7 +2,13 @@
 #pragma once
 
 #include "Track.h"
+#include <algorithm>
+#include <utility>
+#include <cmath>
+#include <cstdint>
 #include <optional>
+#include <span>
+#include <string_view>
 #include <SDL2/SDL.h>
 
 namespace ml::audio
@@ -17,7 +23,45 @@ namespace ml::audio
         /** Estimates the duration of the decoded audio buffer played with given specs. */
         static auto EstimateBufferDuration(size_t bufferLength, SDL_AudioSpec spec) noexcept -> time_t;
 
+        /** Returns whether the samples of both formats are interchangeable ( the buffer size is ignored ). */
+        static auto SameFormat(const SDL_AudioSpec& a, const SDL_AudioSpec& b) noexcept -> bool;
+
         /** Resamples the track to fit into the given format. */
         static auto Resample(const Track& original, SDL_AudioSpec spec) noexcept -> std::optional<Track>;
+
+        /** Converts the raw samples between the formats. */
+        static auto Convert(std::span<const uint8_t> samples, const SDL_AudioSpec& from, const SDL_AudioSpec& to) noexcept
+            -> std::optional<std::vector<uint8_t>>;
+
+        /** Parses the sample format name: "s16", "s32", "f32" or "u8" ( little-endian ). */
+        static auto ParseFormat(std::string_view name) noexcept -> std::optional<SDL_AudioFormat>;
+
+        /**
+         * Drops the leading and the trailing frames where all the samples are quieter than the threshold ( dBFS ).
+         * Only the view of the track is narrowed, the samples aren't copied. Tracks of the unsupported formats are returned as is.
+         */
+        static auto TrimSilence(const Track& track, double threshold) noexcept -> Track;
+
+        /** Multiplies the samples by the gain in place, the result is clipped. Returns false for the unsupported formats. */
+        static auto Scale(std::span<uint8_t> samples, SDL_AudioFormat format, float gain) noexcept -> bool;
+
+        /** Converts the native sample ( u8, s16, s32 or f32 ) to float in -1..1. */
+        template <typename T> static auto ToFloat(T sample) noexcept -> float;
+
+        /**
+         * Converts the float sample to the native one, rounding it and clipping it to the native range.
+         * The scale is the same as in ToFloat, so the integer samples survive the round trip unchanged.
+         */
+        template <typename T> static auto FromFloat(float sample) noexcept -> T;
     };
+
+    template <> inline auto Utils::ToFloat(uint8_t sample) noexcept -> float { return ((float)sample - 128) * (1.f / 128); }
+    template <> inline auto Utils::ToFloat(int16_t sample) noexcept -> float { return (float)sample * (1.f / 32768); }
+    template <> inline auto Utils::ToFloat(int32_t sample) noexcept -> float { return (float)sample * (1.f / 2147483648.f); }
+    template <> inline auto Utils::ToFloat(float sample) noexcept -> float { return sample; }
+
+    template <> inline auto Utils::FromFloat(float sample) noexcept -> uint8_t { return (uint8_t)std::clamp(std::lrint(sample * 128) + 128, 0l, 255l); }
+    template <> inline auto Utils::FromFloat(float sample) noexcept -> int16_t { return (int16_t)std::clamp(std::lrint(sample * 32768), -32768l, 32767l); }
+    template <> inline auto Utils::FromFloat(float sample) noexcept -> int32_t { return (int32_t)std::clamp(std::llrint((double)sample * 2147483648.), (long long)INT32_MIN, (long long)INT32_MAX); }
+    template <> inline auto Utils::FromFloat(float sample) noexcept -> float { return std::clamp(sample, -1.f, 1.f); }
 }
\ No newline at end of file
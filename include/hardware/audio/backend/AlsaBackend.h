@@ -0,0 +1,55 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Backend.h"
+
+#include "utils/Metrics.h"
+
+#include <alsa/asoundlib.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace ml::audio
+{
+    /**
+     * @brief The native ALSA output, bypasses SDL and the sound servers.
+     * @safety Fully exception and thread safe.
+     *
+     * The mixer renders straight into the device ring buffer ( mmap transfer ), one period at a time.
+     * Period and buffer sizes are given in frames, the device may adjust them slightly.
+     * Works with the loopback devices as well, e.g. "null" or "hw:Loopback,0" ( snd-aloop ).
+     *
+     * Metrics:
+     * - audio_xruns: the underruns reported by the device, each one is recovered automatically.
+     * - audio_output_latency_us: the delay between rendering a sample and hearing it ( snd_pcm_delay ).
+     */
+    class AlsaBackend : public Backend
+    {
+        std::string Device_;
+        snd_pcm_uframes_t Period_ {};
+        snd_pcm_uframes_t Buffer_ {};
+
+        snd_pcm_t* Pcm_ {};
+        SDL_AudioSpec Spec_ {};
+        std::jthread Transfer_;
+
+    public:
+        /** Creates the backend bound to the given ALSA device. */
+        static auto Create(const std::string& device, size_t period, size_t buffer) noexcept -> std::shared_ptr<AlsaBackend>;
+
+        /** Closes the device. */
+        ~AlsaBackend() override;
+
+        auto Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec> final;
+        void Start() noexcept final;
+        void Close() noexcept final;
+
+    private:
+        void Transfer(const std::stop_token& token) noexcept;
+        void Recover(int error) noexcept;
+
+        static auto BindFormat(SDL_AudioFormat format) noexcept -> snd_pcm_format_t;
+    };
+}
@@ -0,0 +1,35 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "utils/CustomConstructor.h"
+
+#include <SDL2/SDL.h>
+
+#include <optional>
+
+namespace ml::audio
+{
+    /**
+     * @brief Abstract audio output.
+     * @safety Fully exception and thread safe.
+     *
+     * Owns the output thread which periodically pulls the audio from the callback given in the spec ( SDL-like ).
+     *
+     * Requirements for concrete implementations:
+     * 1. The output MUST be opened only once and stay silent until it's started.
+     * 2. The callback MUST NOT be invoked after the output is closed.
+     * 3. The obtained spec MUST describe the data layout the callback is asked for.
+     */
+    class Backend : public utils::CustomConstructor
+    {
+    public:
+        /** Opens the output, fills the missing parts of the desired spec. Returns the obtained spec. */
+        virtual auto Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec> = 0;
+
+        /** Starts pulling the audio from the callback. */
+        virtual void Start() noexcept = 0;
+
+        /** Stops the playback and releases the output. */
+        virtual void Close() noexcept = 0;
+    };
+}
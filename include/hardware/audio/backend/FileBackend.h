@@ -0,0 +1,42 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "NullBackend.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace ml::audio
+{
+    /**
+     * @brief The headless output that writes the exact mixed audio into the wav file.
+     * @safety Fully exception and thread safe.
+     *
+     * Runs on the same clock as the NullBackend. The wav header is finalized when the backend is closed.
+     *
+     * Warnings:
+     * - The wav file holds at most 4GiB of the samples, the audio beyond it is discarded.
+     */
+    class FileBackend : public NullBackend
+    {
+        std::ofstream File_;
+        SDL_AudioSpec Spec_ {};
+        uint32_t Written_ {};
+
+    public:
+        /** Creates the backend, truncates the file. */
+        static auto Create(const std::string& path) noexcept -> std::shared_ptr<FileBackend>;
+
+        /** Finalizes the file. */
+        ~FileBackend() override;
+
+        auto Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec> final;
+        void Close() noexcept final;
+
+    private:
+        void Consume(const uint8_t* data, size_t len) noexcept final;
+        void WriteHeader() noexcept;
+    };
+}
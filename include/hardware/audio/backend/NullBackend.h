@@ -0,0 +1,50 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Backend.h"
+
+#include "utils/Time.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace ml::audio
+{
+    /**
+     * @brief The headless output, discards the audio.
+     * @safety Fully exception and thread safe.
+     *
+     * The callback is invoked from the separate thread on the precise sample clock, exactly as the real device would do.
+     * In the simulated time the callback is a routine run by Time::Advance, on the same sample clock rounded to milliseconds.
+     * Missing parts of the spec are pinned to 44100Hz s16le stereo.
+     */
+    class NullBackend : public Backend
+    {
+        SDL_AudioSpec Spec_ {};
+        std::vector<uint8_t> Period_;
+        std::jthread Clock_;
+        utils::Routine SimulatedClock_;
+
+    public:
+        /** Creates the backend. */
+        static auto Create() noexcept -> std::shared_ptr<NullBackend>;
+
+        /** Stops the clock. */
+        ~NullBackend() override;
+
+        auto Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec> override;
+        void Start() noexcept override;
+        void Close() noexcept override;
+
+    protected:
+        NullBackend() = default;
+
+        /** Consumes the rendered period, invoked from the clock thread. */
+        virtual void Consume(const uint8_t* data, size_t len) noexcept;
+
+    private:
+        void Clock(const std::stop_token& token) noexcept;
+        auto SimulatedTick(time_t startTime, int64_t& period) noexcept -> time_t;
+    };
+}
@@ -0,0 +1,33 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Backend.h"
+
+#include <memory>
+#include <string>
+
+namespace ml::audio
+{
+    /**
+     * @brief The output built on top of SDL audio subsystem.
+     * @safety Fully exception and thread safe.
+     *
+     * Keeps the requested freq, format and channels, only the buffer size may be changed by the device.
+     */
+    class SdlBackend : public Backend
+    {
+        std::optional<std::string> Device_;
+        SDL_AudioDeviceID Out_ {};
+
+    public:
+        /** Creates the backend bound to the given audio device ( or to the default one ). */
+        static auto Create(const std::optional<std::string>& device = std::nullopt) noexcept -> std::shared_ptr<SdlBackend>;
+
+        /** Closes the audio device. */
+        ~SdlBackend() override;
+
+        auto Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec> final;
+        void Start() noexcept final;
+        void Close() noexcept final;
+    };
+}
@@ -4,54 +4,31 @@
 #include "utils/CustomConstructor.h"
 
 #include <memory>
-#include <optional>
-#include <atomic>
-
-#include <termios.h>
-#include <sys/ioctl.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/types.h>
-#include <sys/stat.h>
-#include <climits>
-#include <sys/file.h>
-#include <cerrno>
+#include <string_view>
 
 namespace ml::relay
 {
     /**
-     * @brief A high level driver for RS232 based 5V relay.
-     * The relay utilizes DTR line of RS232 port.
-     * Fully exception and thread safe.
+     * @brief Abstract driver for the power relay.
+     * @safety Fully exception and thread safe.
+     *
+     * Requirements for concrete implementations:
+     * 1. The relay MUST be opened on creation ( the safe state ).
+     * 2. The switching MUST be done immediately.
      */
     class Driver : public utils::CustomConstructor
     {
-        int PortFd_;
-        std::string Port_;
-
-        std::atomic<bool> Enabled_;
-        std::mutex UpdateLock_;
-
     public:
-        /** Takes ownership over the physical relay. Enforces closed state on creation. */
-        static auto Create(const std::string& port) noexcept -> std::shared_ptr<Driver>;
-
-        /** Opens the relay and releases the comport. */
-        ~Driver();
-
         /** Immediately turns the relay on. */
-        void Close() noexcept;
+        virtual void Close() noexcept = 0;
 
         /** Immediately turns the relay off. */
-        void Open() noexcept;
+        virtual void Open() noexcept = 0;
 
         /** Returns the relay state. */
-        auto Closed() const noexcept -> bool;
+        virtual auto Closed() const noexcept -> bool = 0;
 
         /** Returns the part of the relay' port. */
-        auto Path() const noexcept -> std::string_view;
-
-    private:
-        void UpdatePort(int add, int remove) noexcept;
+        virtual auto Path() const noexcept -> std::string_view = 0;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,34 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "../Driver.h"
+
+#include <atomic>
+#include <memory>
+
+namespace ml::relay
+{
+    /**
+     * @brief The relay stand-in, only keeps the state in the memory.
+     * @safety Fully exception and thread safe.
+     *
+     * Allows to run the whole stack on the machines without the physical relay ( build servers, benchmarks ).
+     */
+    class MemoryDriver : public Driver
+    {
+        std::atomic<bool> Enabled_ {};
+        std::atomic<size_t> Switches_ {};
+
+    public:
+        /** Creates the relay in the opened state. */
+        static auto Create() noexcept -> std::shared_ptr<MemoryDriver>;
+
+        void Close() noexcept final;
+        void Open() noexcept final;
+        auto Closed() const noexcept -> bool final;
+        auto Path() const noexcept -> std::string_view final;
+
+        /** Returns how many times the relay has been closed. */
+        auto Switches() const noexcept -> size_t;
+    };
+}
@@ -0,0 +1,52 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "../Driver.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <optional>
+#include <atomic>
+
+#include <termios.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <climits>
+#include <sys/file.h>
+#include <cerrno>
+
+namespace ml::relay
+{
+    /**
+     * @brief A high level driver for RS232 based 5V relay.
+     * The relay utilizes DTR line of RS232 port.
+     * Fully exception and thread safe.
+     */
+    class SerialDriver : public Driver
+    {
+        int PortFd_;
+        std::string Port_;
+
+        std::atomic<bool> Enabled_;
+        std::mutex UpdateLock_;
+
+    public:
+        /** Takes ownership over the physical relay. Enforces closed state on creation. */
+        static auto Create(const std::string& port) noexcept -> std::shared_ptr<SerialDriver>;
+
+        /** Opens the relay and releases the comport. */
+        ~SerialDriver() override;
+
+        void Close() noexcept final;
+        void Open() noexcept final;
+        auto Closed() const noexcept -> bool final;
+        auto Path() const noexcept -> std::string_view final;
+
+    private:
+        void UpdatePort(int add, int remove) noexcept;
+    };
+}
\ No newline at end of file
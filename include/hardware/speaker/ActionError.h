@@ -10,6 +10,7 @@ namespace ml::speaker
         AE_ChannelNotFound = 2,
         AE_ChannelInactive = 3,
         AE_IncompatibleTrack = 4,
-        AE_AllChannelsClosed = 5
+        AE_AllChannelsClosed = 5,
+        AE_ChannelExists = 6
     };
 }
\ No newline at end of file
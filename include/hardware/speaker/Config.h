@@ -1,6 +1,9 @@
 // Created by Tube Lab. Part of the meloun project.
 #pragma once
 
+#include "Predictor.h"
+#include "Journal.h"
+
 #include "hardware/amplifier/Driver.h"
 
 #include <string>
@@ -16,5 +19,11 @@ namespace ml::speaker
 
         /** The speaker channels sorted by priority. */
         std::vector<std::string> Channels {};
+
+        /** The predictor used to pre-warm the amplifier ahead of the likely demand ( nullptr - disabled ). */
+        std::shared_ptr<Predictor> DemandPredictor {};
+
+        /** The journal that keeps the queues and the channels states across restarts ( nullptr - disabled ). */
+        std::shared_ptr<Journal> QueueJournal {};
     };
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 #include "ChannelState.h"
 
 #include "utils/Time.h"
+#include "utils/Metrics.h"
+#include "utils/Realtime.h"
 #include "utils/CustomConstructor.h"
 
 #include <unordered_map>
@@ -37,26 +39,52 @@ namespace ml::speaker
      * - These tracks are played.
      * - The user releases the channel signalling to the speaker that no tracks will be played ( takes some time ).
      *
+     * Pre-warming mechanism ( optional ):
+     * - Each activation is reported to the predictor.
+     * - While no channel uses the amplifier, it is started up ahead of the likely demand and kept warm until it ends.
+     * - The pre-warming time is bounded by the daily budget of the predictor.
+     *
+     * Journaling mechanism ( optional ):
+     * - The enqueued tracks, the playback offsets and the channels states are recorded in the journal.
+     * - On creation the opened channels are restored with a fresh session, the active ones start activating.
+     * - The restored queues are enqueued back once their channels become active.
+     *
      * Main features:
      * - All channels related function fail if the channel isn't active.
+     * - The channels may be added and removed at runtime, the names are resolved through a hashed table.
+     *
+     * Metrics:
+     * - prewarm_starts: how many times the amplifier has been pre-warmed.
+     * - prewarm_hits: how many activations have been served by the pre-warmed amplifier.
+     * - prewarm_spent_ms: the total time the amplifier has been kept warm without the demand.
+     * - prewarm_saved_ms: the total activation latency saved by the pre-warming.
      */
     class Driver : public utils::CustomConstructor
     {
         struct Channel
         {
+            std::string Name;
             ChannelState State;
             std::optional<time_t> ExpiresAt;
             std::vector<std::promise<void>> ActivationListeners;
             std::vector<std::promise<void>> DeactivationListeners;
+            std::vector<audio::Track> Replay;
         };
 
         std::shared_ptr<amplifier::Driver> Amplifier_;
-        std::map<std::string, uint> ChannelsMap_;
+        std::unordered_map<std::string, uint> ChannelsMap_;
 
         std::vector<Channel> Channels_;
         mutable std::recursive_mutex ChannelsLock_;
 
-        std::jthread Mainloop_;
+        std::shared_ptr<Predictor> Predictor_;
+        std::optional<time_t> PrewarmingUntil_;
+        time_t PrewarmingCost_ {};
+        time_t PrewarmingTick_ {};
+
+        std::shared_ptr<Journal> Journal_;
+
+        utils::Routine Mainloop_;
 
     public:
         template <typename T = void> using Result = std::expected<T, ActionError>;
@@ -79,6 +107,12 @@ namespace ml::speaker
         /** Appends the audio track to the particular active channel. */
         auto Enqueue(const std::string& channel, const audio::Track& audio) noexcept -> Result<std::future<void>>;
 
+        /**
+         * Starts the live stream in the particular active channel, optionally played through the jitter buffer.
+         * The live audio isn't journaled, so it isn't replayed after a restart.
+         */
+        auto Stream(const std::string& channel, const SDL_AudioSpec& format, const std::optional<audio::JitterConfig>& jitter) noexcept -> Result<std::shared_ptr<audio::LiveStream>>;
+
         /** Empties the channel. Channel' playback will be stopped immediately. Doesn't pause the channel. */
         auto Clear(const std::string& channel) noexcept -> Result<>;
 
@@ -88,10 +122,22 @@ namespace ml::speaker
         /** Determines for how long the channel will continue to play. */
         auto DurationLeft(const std::string& channel) const noexcept -> Result<time_t>;
 
+        /** Sets the gain of the channel in dB. Doesn't require a session, the gain is kept while the channel exists. */
+        auto SetGain(const std::string& channel, double db) noexcept -> Result<>;
+
+        /** Returns the gain of the channel in dB. */
+        auto Gain(const std::string& channel) const noexcept -> Result<double>;
+
+        /** Sets whether the channel is muted or paused while a higher one plays. Doesn't require a session. */
+        auto SetPreemption(const std::string& channel, audio::PreemptPolicy policy) noexcept -> Result<>;
+
+        /** Returns the preemption policy of the channel. */
+        auto Preemption(const std::string& channel) const noexcept -> Result<audio::PreemptPolicy>;
+
         /** Returns the state of particular channel. */
         auto State(const std::string& channel) const noexcept -> Result<ChannelState>;
 
-        /** Returns the longest duration that the activation of a channel may take. */
+        /** Returns the expected duration of a channel activation, predicted from the amplifier' state. */
         auto ActivationDuration(bool urgently) const noexcept -> time_t;
 
         /** Returns the longest duration that the activation of a channel may take. */
@@ -103,8 +149,29 @@ namespace ml::speaker
         /** Returns whether the amplifier is ready to play the audio. */
         auto Ready() const noexcept -> bool;
 
+        /** Returns the position of the channel in the priorities list, 0 is the lowest. */
+        auto Priority(const std::string& channel) const noexcept -> Result<uint>;
+
+        /** Returns the channels ordered by the priority. */
+        auto Channels() const noexcept -> std::vector<std::string>;
+
+        /** Adds a closed channel at the given position of the priorities list ( 0 is the lowest, the larger ones place it on the top ). */
+        auto AddChannel(const std::string& channel, uint priority) noexcept -> Result<>;
+
+        /** Removes the channel, its session is terminated and its queue is dropped. */
+        auto RemoveChannel(const std::string& channel) noexcept -> Result<>;
+
+        /**
+         * Replaces the channels list ( ordered by the priority ) keeping the sessions and the queues of the retained channels.
+         * The sessions of the removed channels are terminated and their listeners are released.
+         */
+        void Remap(const std::vector<std::string>& channels) noexcept;
+
     private:
-        void Mainloop(const std::stop_token& token) noexcept;
+        auto Mainloop() noexcept -> time_t;
+        void Prewarm(time_t time) noexcept;
+        void Restore(time_t time) noexcept;
+        void Persist() noexcept;
         auto MapToIndex(const std::string& channel) const noexcept -> Result<uint>;
         auto CountActive() const noexcept -> uint;
 
@@ -0,0 +1,126 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "ChannelState.h"
+
+#include "hardware/audio/Track.h"
+#include "hardware/audio/ClipLibrary.h"
+#include "hardware/audio/Utils.h"
+
+#include "utils/CustomConstructor.h"
+#include "utils/MappedFile.h"
+#include "utils/Logger.h"
+
+#include <unordered_map>
+#include <filesystem>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace ml::speaker
+{
+    /**
+     * @brief Persists the playback queues and the channels states, so they survive a restart.
+     * @safety Fully exception and thread safe.
+     *
+     * Layout of the directory:
+     * - state: the memory-mapped table of the channels states and the playback offsets, updated in place.
+     * - <sequence>.pcm: an enqueued track ( a small header followed by the decoded samples ), removed once played.
+     *   The part of a clip is recorded as the reference to the clip instead, it's resolved from the library on the restore.
+     *
+     * The channels are identified by the names, so the journal doesn't depend on the channels order.
+     * The closed channel with the empty queue gives its slot of the table back, so the slots are shared by the channels over time.
+     * The live streams keep their places in the queues but aren't persisted, so the queues stay aligned with the players.
+     * The playback offset is tracked with the millisecond precision from the remaining duration of the queued tracks.
+     * The tracks are written by the background thread, so the callers never wait for the disk.
+     *
+     * Warnings:
+     * - Nothing is synced explicitly, so the journal survives the crashes of the process but not of the system.
+     * - The tracks appended right before a crash may be missing, the rest of the queue is restored anyway.
+     * - The table has 256 slots, the channels beyond them aren't persisted ( it's logged as a warning ).
+     * - The referenced clips that are gone or changed by the restart are dropped from the queues.
+     */
+    class Journal : public utils::CustomConstructor
+    {
+        struct Record
+        {
+            uint64_t Sequence;
+            time_t Duration;
+            bool Stream {}; ///< The live stream only keeps its place in the queue, it has no file.
+        };
+
+        struct Slot;
+
+        struct Pending
+        {
+            uint64_t Sequence;
+            std::string Channel;
+            audio::Track Track;
+        };
+
+        std::filesystem::path Directory_;
+        std::shared_ptr<audio::ClipLibrary> Clips_;
+        std::shared_ptr<utils::MappedFile> State_;
+        std::unordered_map<std::string, std::deque<Record>> Queues_;
+        uint64_t Sequence_ {};
+        bool Exhausted_ {}; ///< Whether the lack of the slots has been reported.
+        std::deque<Pending> Pending_;
+        std::condition_variable_any Wake_;
+        mutable std::mutex Lock_;
+        std::jthread Writer_; ///< Stops first, so the pending tracks are written before the rest is gone.
+
+    public:
+        /** The channel as it was before the restart. The first track is already trimmed to the playback offset. */
+        struct Snapshot
+        {
+            std::string Channel;
+            ChannelState State;
+            std::vector<audio::Track> Tracks;
+        };
+
+        /** Opens the journal in the directory, creates the directory when required. The clips are journaled by the name. */
+        static auto Create(const std::string& directory, const std::shared_ptr<audio::ClipLibrary>& clips = nullptr) noexcept
+            -> std::shared_ptr<Journal>;
+
+        /** Reads the channels back, must be called once before any other method. Corrupted tracks are dropped. */
+        auto Restore() noexcept -> std::vector<Snapshot>;
+
+        /** Records the track appended to the channel' queue, the samples are written in the background. */
+        void Append(const std::string& channel, const audio::Track& track) noexcept;
+
+        /** Records the live stream appended to the channel' queue, it isn't restored but takes its place in the queue. */
+        void AppendStream(const std::string& channel) noexcept;
+
+        /**
+         * Accounts the playback by the number of the entries left in the channel' queue and the remaining duration of its tracks.
+         * Drops the played tracks and streams.
+         */
+        void Progress(const std::string& channel, size_t entries, time_t left) noexcept;
+
+        /** Drops the first track or stream of the channel. */
+        void Skip(const std::string& channel) noexcept;
+
+        /** Drops all the tracks of the channel. */
+        void Clear(const std::string& channel) noexcept;
+
+        /** Records the state of the channel. */
+        void Save(const std::string& channel, ChannelState state) noexcept;
+
+    private:
+        auto FindSlot(const std::string& channel, bool create = true) noexcept -> Slot*;
+        void ReleaseSlot(const std::string& channel) noexcept;
+        auto TrackPath(uint64_t sequence) const noexcept -> std::filesystem::path;
+        void Write(const std::stop_token& token) noexcept;
+        auto WriteTrack(const Pending& pending) const noexcept -> bool;
+        void DropFirst(std::deque<Record>& queue) noexcept;
+    };
+}
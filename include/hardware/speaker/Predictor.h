@@ -0,0 +1,66 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "PredictorConfig.h"
+
+#include "utils/CustomConstructor.h"
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace ml::speaker
+{
+    /**
+     * @brief Predicts the channels activations from their history.
+     * @safety Fully exception and thread safe.
+     *
+     * The (local) day is split into slots. Each slot keeps an exponentially decaying count of the days when the channel
+     * was activated within it, so the score of a slot is the probability of the activation there.
+     * Also accounts the time spent in pre-warming against the daily budget.
+     */
+    class Predictor : public utils::CustomConstructor
+    {
+        struct Slot
+        {
+            double Score {};
+            int64_t Day = -1;
+        };
+
+        PredictorConfig Config_;
+        std::vector<std::vector<Slot>> Slots_;
+
+        int64_t BudgetDay_ {};
+        time_t Spent_ {};
+        mutable std::mutex Lock_;
+
+    public:
+        /** Creates the predictor without any history. */
+        static auto Create(const PredictorConfig& config) noexcept -> std::shared_ptr<Predictor>;
+
+        /** Learns from the activation of the channel at the given time. */
+        void Observe(uint channel, time_t time) noexcept;
+
+        /**
+         * Returns when the likely demand ends, if any channel is likely activated within [time, time + lead].
+         * The slots where the demand has already happened today are skipped.
+         */
+        auto Forecast(time_t time, time_t lead) const noexcept -> std::optional<time_t>;
+
+        /** Accounts the time spent in pre-warming. Returns whether the daily budget allows to continue. */
+        auto Spend(time_t time, time_t duration) noexcept -> bool;
+
+        /** Returns how much pre-warming time is left for today. */
+        auto Budget(time_t time) const noexcept -> time_t;
+
+        /** Rebuilds the history for the new channels list, the new channel i inherits the history of mapping[i]. */
+        void Remap(const std::vector<std::optional<uint>>& mapping) noexcept;
+
+    private:
+        auto Probability(const Slot& slot, int64_t day) const noexcept -> double;
+        auto Limit() const noexcept -> time_t;
+
+        static auto LocalTime(time_t time) noexcept -> time_t;
+    };
+}
@@ -0,0 +1,32 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include <ctime>
+#include <sys/types.h>
+
+namespace ml::speaker
+{
+    struct PredictorConfig
+    {
+        /** The number of the speaker channels. */
+        uint Channels {};
+
+        /** The granularity of the day in which the activations are counted. */
+        time_t SlotDuration = 15*60*1000;
+
+        /** The probability of the activation within a slot required to pre-warm the amplifier for it. */
+        double Threshold = 0.5;
+
+        /** How fast the old observations are forgotten, the weight of a day-old observation ( 0..1 ). */
+        double Decay = 0.9;
+
+        /** How long the amplifier may be pre-warmed per day ( lamp-hours budget ). */
+        time_t LampBudget = 60*60*1000;
+
+        /** How much energy the pre-warming may consume per day, Wh ( 0 - unlimited ). */
+        double EnergyBudget = 0;
+
+        /** The power consumption of the working amplifier, W. */
+        double AmplifierPower = 0;
+    };
+}
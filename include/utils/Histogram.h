@@ -0,0 +1,46 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace ml::utils
+{
+    /**
+     * @brief Lock-free histogram with logarithmic buckets.
+     * @safety Fully exception and thread safe.
+     *
+     * Values below 64 are exact, larger ones are stored with at most ~3% relative error.
+     */
+    class Histogram
+    {
+        static constexpr size_t SubBuckets = 32;
+        static constexpr size_t Buckets = 2*SubBuckets + 57*SubBuckets;
+
+        std::array<std::atomic<uint64_t>, Buckets> Counts_ {};
+        std::atomic<uint64_t> Count_ {};
+        std::atomic<int64_t> Sum_ {};
+        std::atomic<int64_t> Max_ {};
+
+    public:
+        /** Records a single non-negative value. */
+        void Record(int64_t value) noexcept;
+
+        /** Returns the value below which the given fraction ( 0..1 ) of the records falls. */
+        auto Percentile(double fraction) const noexcept -> int64_t;
+
+        /** Returns the number of the records. */
+        auto Count() const noexcept -> uint64_t;
+
+        /** Returns the arithmetic mean of the records. */
+        auto Mean() const noexcept -> int64_t;
+
+        /** Returns the largest recorded value. */
+        auto Max() const noexcept -> int64_t;
+
+    private:
+        static auto BucketOf(int64_t value) noexcept -> size_t;
+        static auto ValueOf(size_t bucket) noexcept -> int64_t;
+    };
+}
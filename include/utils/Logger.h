@@ -0,0 +1,69 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Metrics.h"
+#include "Time.h"
+
+#include <initializer_list>
+#include <string_view>
+#include <optional>
+#include <variant>
+#include <string>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ml::utils
+{
+    enum LogLevel
+    {
+        LL_Debug = 0,
+        LL_Info = 1,
+        LL_Warning = 2,
+        LL_Error = 3
+    };
+
+    /** The named value of the record. */
+    struct LogField
+    {
+        std::string_view Key;
+        std::variant<int64_t, double, std::string_view> Value;
+    };
+
+    /**
+     * @brief The process-wide asynchronous logger, writes the records as JSON lines.
+     * @safety Fully exception and thread safe.
+     *
+     * The memory is reserved once and split into the rings. The record is formatted by the calling thread and copied into
+     * a free ring taken from a lock-free stack, so the writing threads never wait for each other nor for the sink.
+     * The background writer drains all the rings into the sink by a single write per pass.
+     *
+     * Metrics:
+     * - log_records: the records written into the rings.
+     * - log_dropped: the records dropped since the rings were full ( the sink falls behind ) or all of them were taken.
+     *
+     * Warnings:
+     * - The records written before the start are dropped.
+     */
+    class Logger
+    {
+    public:
+        /** Opens the sink ( nullopt - stdout ), reserves the memory for the rings and starts the writer. Only the first call has an effect. */
+        static auto Start(const std::optional<std::string>& path, size_t memory) noexcept -> bool;
+
+        /** Sets the lowest level of the written records. */
+        static void SetLevel(LogLevel level) noexcept;
+
+        /** Returns whether the records of the level are written, so the expensive fields may be skipped. */
+        static auto Enabled(LogLevel level) noexcept -> bool;
+
+        /** Writes the record, drops it when the rings are full. */
+        static void Write(LogLevel level, std::string_view message, std::initializer_list<LogField> fields = {}) noexcept;
+
+        /** Parses the level name: "debug", "info", "warning" or "error". */
+        static auto ParseLevel(std::string_view name) noexcept -> std::optional<LogLevel>;
+    };
+}
@@ -0,0 +1,43 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "CustomConstructor.h"
+
+#include <memory>
+#include <string>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ml::utils
+{
+    /**
+     * @brief A file mapped into the memory.
+     * @safety Exception safe. The mapped memory isn't synchronized, so the owner takes care about the access.
+     */
+    class MappedFile : public CustomConstructor
+    {
+        int Fd_ = -1;
+        uint8_t* Data_ {};
+        size_t Size_ {};
+
+    public:
+        /** Maps the whole existing file read-only. Fails on empty files. */
+        static auto Open(const std::string& path) noexcept -> std::shared_ptr<MappedFile>;
+
+        /** Maps the file for reading and writing, creates it and grows it to the size when required. */
+        static auto Create(const std::string& path, size_t size) noexcept -> std::shared_ptr<MappedFile>;
+
+        /** Unmaps the file, the changes are written back by the kernel. */
+        ~MappedFile() override;
+
+        auto Data() const noexcept -> uint8_t*; ///< Returns the mapped memory.
+        auto Size() const noexcept -> size_t; ///< Returns the size of the mapped memory.
+
+    private:
+        static auto Map(int fd, size_t size, bool writable) noexcept -> std::shared_ptr<MappedFile>;
+    };
+}
@@ -0,0 +1,33 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Histogram.h"
+
+#include <atomic>
+#include <string>
+
+namespace ml::utils
+{
+    /**
+     * @brief The process-wide registry of the runtime metrics.
+     * @safety Fully exception and thread safe.
+     *
+     * The metrics are created on the first access and live until the process exits,
+     * so the returned references may be cached ( e.g. in function-local statics on hot paths ).
+     */
+    class Metrics
+    {
+    public:
+        /** Returns the monotonically growing counter. */
+        static auto Counter(const std::string& name) noexcept -> std::atomic<int64_t>&;
+
+        /** Returns the value that reflects the current state of something. */
+        static auto Gauge(const std::string& name) noexcept -> std::atomic<int64_t>&;
+
+        /** Returns the distribution of some value ( usually latency ). */
+        static auto Distribution(const std::string& name) noexcept -> Histogram&;
+
+        /** Renders all the metrics as text, one "name value" pair per line. */
+        static auto Render() noexcept -> std::string;
+    };
+}
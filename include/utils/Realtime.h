@@ -0,0 +1,70 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "Metrics.h"
+#include "Logger.h"
+
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace ml::utils
+{
+    /** The kind of the thread, defines the scheduling it gets. */
+    enum ThreadRole
+    {
+        TR_Audio = 0, ///< The thread invoking the audio callback, gets the real-time policy and the audio cores.
+        TR_Mainloop = 1 ///< The thread of the drivers mainloops, gets the mainloop cores.
+    };
+
+    struct RealtimeConfig
+    {
+        int Policy = SCHED_OTHER; ///< The policy of the audio threads: SCHED_OTHER, SCHED_FIFO or SCHED_RR.
+        int Priority {}; ///< The real-time priority of the audio threads.
+        std::vector<uint> AudioCpus {}; ///< The cores of the audio threads ( empty - any ).
+        std::vector<uint> MainloopCpus {}; ///< The cores of the mainloop threads ( empty - any ).
+    };
+
+    /**
+     * @brief The process-wide scheduling of the latency-critical threads.
+     * @safety Fully exception and thread safe.
+     *
+     * The threads are created by the libraries ( e.g. SDL ), so each of them applies the scheduling of its role by itself,
+     * once after every change of the config.
+     * When the real-time policy is denied, the priority is lowered to the RLIMIT_RTPRIO limit, then the thread falls back
+     * to the lowest niceness the RLIMIT_NICE limit allows.
+     *
+     * Metrics:
+     * - audio_realtime: 1 when the last audio thread got the real-time policy, 0 otherwise.
+     * - realtime_fallbacks: how many times the real-time policy was denied.
+     *
+     * Warnings:
+     * - The reserved cores are excluded only from the threads started by the configuring thread afterwards.
+     */
+    class Realtime
+    {
+    public:
+        /** Applies the config to the threads entering their roles from now on, moves the calling thread off the reserved cores. */
+        static void Configure(const RealtimeConfig& config) noexcept;
+
+        /** Applies the scheduling of the role to the calling thread, only the first call after the config change has an effect. */
+        static void Enter(ThreadRole role) noexcept;
+
+        /** Locks the pages of the process in the memory as they are faulted, so the audio never waits for the swap. Fails without MCL_ONFAULT. */
+        static auto LockMemory() noexcept -> bool;
+
+        /** Parses the policy name: "other", "fifo" or "rr". */
+        static auto ParsePolicy(std::string_view name) noexcept -> std::optional<int>;
+
+        /** Parses the list of cores, e.g. "2,3" or "2-5". */
+        static auto ParseCpus(std::string_view list) noexcept -> std::optional<std::vector<uint>>;
+    };
+}
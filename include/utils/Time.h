@@ -1,18 +1,70 @@
 // Created by Tube Lab. Part of the meloun project.
 #pragma once
 
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <utility>
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <cstdint>
 
 namespace ml::utils
 {
+    /** The periodic routine started by Time::Schedule, stops on destruction. */
+    class Routine
+    {
+        std::jthread Thread_;
+        uint64_t Id_ {}; ///< The id of the simulated routine, 0 when it runs on the thread.
+
+    public:
+        Routine() = default;
+        Routine(std::jthread thread, uint64_t id) noexcept;
+        Routine(Routine&& other) noexcept;
+        auto operator=(Routine&& other) noexcept -> Routine&;
+        ~Routine();
+
+        /** Stops the routine, waits till its current run ends. */
+        void Stop() noexcept;
+
+        /** Returns whether the routine is scheduled. */
+        auto Active() const noexcept -> bool;
+    };
+
     /**
      * @brief Utils for working with the time.
      * @safety Fully exception and thread safe.
+     *
+     * Simulation:
+     * - The process may be switched to the virtual time before any routine is scheduled.
+     * - The virtual time stands still until it's advanced, then the routines run in the order of their deadlines on the advancing thread,
+     *   the ones with the same deadline in the order of their scheduling. So a day of the state machines passes in seconds and
+     *   the same inputs always give the same results.
+     *
+     * Warnings:
+     * - The simulation must be driven by a single thread, the routines and the clients of the drivers are called from it.
      */
     class Time
     {
     public:
-        /** Returns the timestamp based on the system time. */
+        /** Returns the timestamp based on the system time ( the virtual one in the simulation ). */
         static auto Now() noexcept -> time_t;
+
+        /** Runs the task repeatedly, each run returns the delay till the next one. The first run is due right away. */
+        static auto Schedule(std::function<time_t()> task) noexcept -> Routine;
+
+        /** Switches the process to the virtual time that starts at the given timestamp. */
+        static void Simulate(time_t start) noexcept;
+
+        /** Returns whether the time is virtual. */
+        static auto Simulated() noexcept -> bool;
+
+        /** Moves the virtual time forward by the duration running all the routines that become due. */
+        static void Advance(time_t duration) noexcept;
+
+    private:
+        friend class Routine;
+        static void Unschedule(uint64_t id) noexcept;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,192 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "app/Admission.h"
+using namespace ml::app;
+
+namespace
+{
+    constexpr time_t RequestsRetry = 1000; // the requests in flight may end any moment, so the client retries soon
+}
+
+Admission::Ticket::Ticket(Admission* owner, std::string channel) noexcept
+    : Owner_ { owner }, Channel_ { std::move(channel) }
+{
+}
+
+Admission::Ticket::Ticket(Ticket&& other) noexcept
+    : Owner_ { std::exchange(other.Owner_, nullptr) }, Channel_ { std::move(other.Channel_) }, Decoding_ { other.Decoding_ }
+{
+}
+
+Admission::Ticket::~Ticket()
+{
+    if (Owner_)
+    {
+        Owner_->Release(Channel_, Decoding_);
+    }
+}
+
+void Admission::Ticket::Decoded() noexcept
+{
+    if (Owner_ && Decoding_)
+    {
+        Owner_->Release({}, true);
+        Decoding_ = false;
+    }
+}
+
+auto Admission::Create(uint slots, size_t queue, time_t wait, const std::vector<ChannelLimit>& limits) noexcept -> std::shared_ptr<Admission>
+{
+    auto admission = std::make_shared<Admission>();
+    admission->Reconfigure(slots, queue, wait, limits);
+
+    return admission;
+}
+
+void Admission::Reconfigure(uint slots, size_t queue, time_t wait, const std::vector<ChannelLimit>& limits) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        Slots_ = slots ? slots : std::max(std::thread::hardware_concurrency(), 1u);
+        QueueLimit_ = queue;
+        Wait_ = wait;
+
+        Limits_.clear();
+        for (const auto& limit : limits)
+        {
+            Limits_[limit.Channel] = limit;
+        }
+    }
+
+    // More slots may be free now
+    Released_.notify_all();
+}
+
+auto Admission::Admit(const std::string& channel, uint priority, size_t bytes) noexcept -> std::expected<Ticket, Rejection>
+{
+    static auto& admitted = utils::Metrics::Counter("admission_admitted");
+    static auto& throttled = utils::Metrics::Counter("admission_throttled");
+    static auto& overloaded = utils::Metrics::Counter("admission_overloaded");
+    static auto& queued = utils::Metrics::Gauge("admission_queue");
+    static auto& waited = utils::Metrics::Distribution("admission_wait_ms");
+
+    std::unique_lock lock { Lock_ };
+    auto time = utils::Time::Now();
+
+    // The limits of the channel are checked first, so the flooding channel never occupies the queue
+    auto limit = Limits_.find(channel);
+    auto& bucket = Buckets_[channel];
+
+    if (limit != Limits_.end())
+    {
+        Refill(bucket, limit->second, time);
+
+        if (limit->second.MaxRequests && bucket.Requests >= limit->second.MaxRequests)
+        {
+            ++throttled;
+            return std::unexpected { Rejection { RR_Throttled, RequestsRetry } };
+        }
+
+        // The upload larger than the burst passes with the full bucket and leaves the channel in debt
+        auto rate = (double)limit->second.MaxRate;
+        auto required = std::min((double)bytes, rate);
+
+        if (limit->second.MaxRate && bucket.Tokens < required)
+        {
+            ++throttled;
+            return std::unexpected { Rejection { RR_Throttled, (time_t)std::ceil((required - bucket.Tokens) * 1000 / rate) } };
+        }
+
+        bucket.Tokens -= limit->second.MaxRate ? (double)bytes : 0;
+    }
+
+    ++bucket.Requests;
+
+    // Wait for the slot in the order of the priorities, the request leaves the queue when it's pushed out by a higher one
+    if (Busy_ >= Slots_ || !Waiting_.empty())
+    {
+        std::pair<int64_t, uint64_t> key { -(int64_t)priority, Arrivals_++ };
+
+        if (Waiting_.size() >= QueueLimit_)
+        {
+            if (Waiting_.empty() || Waiting_.rbegin()->first <= key.first)
+            {
+                --bucket.Requests;
+                bucket.Tokens += limit != Limits_.end() && limit->second.MaxRate ? (double)bytes : 0;
+
+                ++overloaded;
+                return std::unexpected { Rejection { RR_Overloaded, Wait_ } };
+            }
+
+            Waiting_.erase(std::prev(Waiting_.end()));
+            Released_.notify_all();
+        }
+
+        Waiting_.insert(key);
+        queued = (int64_t)Waiting_.size();
+
+        bool granted = Released_.wait_for(lock, std::chrono::milliseconds { Wait_ }, [&]
+        {
+            return !Waiting_.contains(key) || (Busy_ < Slots_ && *Waiting_.begin() == key);
+        });
+
+        bool pushed = !Waiting_.contains(key);
+        Waiting_.erase(key);
+        queued = (int64_t)Waiting_.size();
+
+        if (!granted || pushed)
+        {
+            // The next one may get the slot now, the limits are found again since the config may be reloaded meanwhile
+            Released_.notify_all();
+            limit = Limits_.find(channel);
+
+            auto& current = Buckets_[channel];
+            --current.Requests;
+            current.Tokens += limit != Limits_.end() && limit->second.MaxRate ? (double)bytes : 0;
+
+            ++overloaded;
+            return std::unexpected { Rejection { RR_Overloaded, Wait_ } };
+        }
+
+        waited.Record(utils::Time::Now() - time);
+    }
+
+    ++Busy_;
+    ++admitted;
+
+    // The slots freed at once go on to the next waiter, it may have checked while this one was still the head
+    if (Busy_ < Slots_ && !Waiting_.empty())
+    {
+        Released_.notify_all();
+    }
+
+    return Ticket { this, channel };
+}
+
+void Admission::Refill(Bucket& bucket, const ChannelLimit& limit, time_t time) noexcept
+{
+    // The bucket starts full and holds a second worth of the rate
+    auto rate = (double)limit.MaxRate;
+    bucket.Tokens = bucket.RefilledAt ? std::min(rate, bucket.Tokens + rate * (double)(time - bucket.RefilledAt) / 1000) : rate;
+    bucket.RefilledAt = time;
+}
+
+void Admission::Release(const std::string& channel, bool decoding) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        Busy_ -= decoding ? 1 : 0;
+
+        // The empty channel without the limits is forgotten, so the removed runtime channels don't accumulate
+        auto bucket = Buckets_.find(channel);
+        if (!channel.empty() && bucket != Buckets_.end())
+        {
+            --bucket->second.Requests;
+            if (!bucket->second.Requests && !Limits_.contains(channel))
+            {
+                Buckets_.erase(bucket);
+            }
+        }
+    }
+
+    Released_.notify_all();
+}
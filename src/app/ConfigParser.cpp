@@ -17,11 +17,59 @@ auto ConfigParser::FromIni(const std::string& data) noexcept -> std::optional<Co
     Config cfg;
 
     if (ini.KeyExists("general", "port")) cfg.Port = ini.GetLongValue("general", "port");
+    if (ini.KeyExists("general", "http-workers")) cfg.HttpWorkers = ini.GetLongValue("general", "http-workers");
+    if (ini.KeyExists("general", "http-workers-max")) cfg.HttpWorkersMax = ini.GetLongValue("general", "http-workers-max");
     if (ini.KeyExists("general", "token")) cfg.Token = ini.GetValue("general", "token");
+    if (ini.KeyExists("general", "power-relay")) cfg.PowerRelay = ini.GetValue("general", "power-relay");
     if (ini.KeyExists("general", "power-port")) cfg.PowerPort = ini.GetValue("general", "power-port");
+    if (ini.KeyExists("general", "audio-backend")) cfg.AudioBackend = ini.GetValue("general", "audio-backend");
     if (ini.KeyExists("general", "audio-device")) cfg.AudioDevice = ini.GetValue("general", "audio-device");
+    if (ini.KeyExists("general", "audio-file")) cfg.AudioFile = ini.GetValue("general", "audio-file");
+    if (ini.KeyExists("general", "audio-rate")) cfg.AudioRate = ini.GetLongValue("general", "audio-rate");
+    if (ini.KeyExists("general", "audio-format")) cfg.AudioFormat = ini.GetValue("general", "audio-format");
+    if (ini.KeyExists("general", "audio-channels")) cfg.AudioChannels = ini.GetLongValue("general", "audio-channels");
+    if (ini.KeyExists("general", "audio-page-size")) cfg.AudioPageSize = ini.GetLongValue("general", "audio-page-size");
+    if (ini.KeyExists("general", "audio-pool-pages")) cfg.AudioPoolPages = ini.GetLongValue("general", "audio-pool-pages");
+    if (ini.KeyExists("general", "audio-pool-hugepages")) cfg.AudioPoolHugepages = ini.GetBoolValue("general", "audio-pool-hugepages");
+    if (ini.KeyExists("general", "memory-lock")) cfg.MemoryLock = ini.GetBoolValue("general", "memory-lock");
+    if (ini.KeyExists("general", "audio-scheduling")) cfg.AudioScheduling = ini.GetValue("general", "audio-scheduling");
+    if (ini.KeyExists("general", "audio-priority")) cfg.AudioPriority = ini.GetLongValue("general", "audio-priority");
+    if (ini.KeyExists("general", "audio-cpus")) cfg.AudioCpus = ini.GetValue("general", "audio-cpus");
+    if (ini.KeyExists("general", "mainloop-cpus")) cfg.MainloopCpus = ini.GetValue("general", "mainloop-cpus");
+    if (ini.KeyExists("general", "audio-period")) cfg.AudioPeriod = ini.GetLongValue("general", "audio-period");
+    if (ini.KeyExists("general", "audio-buffer")) cfg.AudioBuffer = ini.GetLongValue("general", "audio-buffer");
     if (ini.KeyExists("general", "warming-duration")) cfg.WarmingDuration = ini.GetLongValue("general", "warming-duration");
     if (ini.KeyExists("general", "cooling-duration")) cfg.CoolingDuration = ini.GetLongValue("general", "cooling-duration");
+    if (ini.KeyExists("general", "thermal-model")) cfg.ThermalModel = ini.GetValue("general", "thermal-model");
+    if (ini.KeyExists("general", "clip-path")) cfg.ClipPath = ini.GetValue("general", "clip-path");
+    if (ini.KeyExists("general", "journal-path")) cfg.JournalPath = ini.GetValue("general", "journal-path");
+    if (ini.KeyExists("general", "thermal-threshold")) cfg.ThermalThreshold = ini.GetDoubleValue("general", "thermal-threshold");
+    if (ini.KeyExists("general", "blend-mode")) cfg.BlendMode = ini.GetValue("general", "blend-mode");
+    if (ini.KeyExists("general", "duck-depth")) cfg.DuckDepth = ini.GetDoubleValue("general", "duck-depth");
+    if (ini.KeyExists("general", "duck-attack")) cfg.DuckAttack = ini.GetLongValue("general", "duck-attack");
+    if (ini.KeyExists("general", "duck-release")) cfg.DuckRelease = ini.GetLongValue("general", "duck-release");
+    if (ini.KeyExists("general", "loudness-target")) cfg.LoudnessTarget = ini.GetDoubleValue("general", "loudness-target");
+    if (ini.KeyExists("general", "trim-threshold")) cfg.TrimThreshold = ini.GetDoubleValue("general", "trim-threshold");
+    if (ini.KeyExists("general", "jitter-target")) cfg.JitterTarget = ini.GetLongValue("general", "jitter-target");
+    if (ini.KeyExists("general", "rtp-timeout")) cfg.RtpTimeout = ini.GetLongValue("general", "rtp-timeout");
+    if (ini.KeyExists("general", "jitter-max")) cfg.JitterMax = ini.GetLongValue("general", "jitter-max");
+    if (ini.KeyExists("general", "log-level")) cfg.LogLevel = ini.GetValue("general", "log-level");
+    if (ini.KeyExists("general", "log-file")) cfg.LogFile = ini.GetValue("general", "log-file");
+    if (ini.KeyExists("general", "log-memory")) cfg.LogMemory = ini.GetLongValue("general", "log-memory");
+    if (ini.KeyExists("general", "log-sample")) cfg.LogSample = ini.GetLongValue("general", "log-sample");
+    if (ini.KeyExists("general", "decode-slots")) cfg.DecodeSlots = ini.GetLongValue("general", "decode-slots");
+    if (ini.KeyExists("general", "decode-queue")) cfg.DecodeQueue = ini.GetLongValue("general", "decode-queue");
+    if (ini.KeyExists("general", "decode-wait")) cfg.DecodeWait = ini.GetLongValue("general", "decode-wait");
+    if (ini.KeyExists("general", "loudness-max-gain")) cfg.LoudnessMaxGain = ini.GetDoubleValue("general", "loudness-max-gain");
+
+    // Parse "prewarm" section
+    if (ini.KeyExists("prewarm", "enabled")) cfg.Prewarm = ini.GetBoolValue("prewarm", "enabled");
+    if (ini.KeyExists("prewarm", "slot")) cfg.PrewarmSlot = ini.GetLongValue("prewarm", "slot");
+    if (ini.KeyExists("prewarm", "threshold")) cfg.PrewarmThreshold = ini.GetDoubleValue("prewarm", "threshold");
+    if (ini.KeyExists("prewarm", "decay")) cfg.PrewarmDecay = ini.GetDoubleValue("prewarm", "decay");
+    if (ini.KeyExists("prewarm", "lamp-budget")) cfg.PrewarmLampBudget = ini.GetLongValue("prewarm", "lamp-budget");
+    if (ini.KeyExists("prewarm", "energy-budget")) cfg.PrewarmEnergyBudget = ini.GetDoubleValue("prewarm", "energy-budget");
+    if (ini.KeyExists("prewarm", "amplifier-power")) cfg.AmplifierPower = ini.GetDoubleValue("prewarm", "amplifier-power");
 
     // Parse all the sink sections
     CSimpleIniA::TNamesDepend sections;
@@ -33,6 +81,44 @@ auto ConfigParser::FromIni(const std::string& data) noexcept -> std::optional<Co
         if (std::string {entry.pItem }.starts_with("channel."))
         {
             extracted.emplace_back(entry.pItem + 8, ini.GetLongValue(entry.pItem, "priority"));
+            if (ini.GetBoolValue(entry.pItem, "trim-silence", false))
+            {
+                cfg.TrimmedChannels.emplace_back(entry.pItem + 8);
+            }
+
+            if (std::string { ini.GetValue(entry.pItem, "preempt", "mute") } == "pause")
+            {
+                cfg.PausedChannels.emplace_back(entry.pItem + 8);
+            }
+
+            if (ini.GetBoolValue(entry.pItem, "jitter-buffer", false))
+            {
+                cfg.JitterChannels.emplace_back(entry.pItem + 8);
+            }
+
+            if (ini.KeyExists(entry.pItem, "max-requests") || ini.KeyExists(entry.pItem, "max-rate"))
+            {
+                cfg.ChannelLimits.push_back(ChannelLimit {
+                    .Channel = entry.pItem + 8,
+                    .MaxRequests = (uint)ini.GetLongValue(entry.pItem, "max-requests"),
+                    .MaxRate = (size_t)ini.GetLongValue(entry.pItem, "max-rate")
+                });
+            }
+
+            // The rate defaults to the one of the encoding ( RFC 3551, RFC 7587 )
+            if (ini.KeyExists(entry.pItem, "rtp-port"))
+            {
+                std::string encoding = ini.GetValue(entry.pItem, "rtp-encoding", "pcmu");
+                long rate = encoding == "opus" ? 48000 : encoding == "l16" ? 44100 : 8000;
+
+                cfg.RtpIngests.push_back(RtpIngest {
+                    .Channel = entry.pItem + 8,
+                    .Port = (uint16_t)ini.GetLongValue(entry.pItem, "rtp-port"),
+                    .Encoding = encoding,
+                    .Rate = (int)ini.GetLongValue(entry.pItem, "rtp-rate", rate),
+                    .Channels = (uint8_t)ini.GetLongValue(entry.pItem, "rtp-channels", 1)
+                });
+            }
         }
     }
 
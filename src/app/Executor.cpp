@@ -0,0 +1,193 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "app/Executor.h"
+using namespace ml::app;
+
+namespace
+{
+    constexpr time_t WatchInterval = 20;
+    constexpr auto IdleTimeout = std::chrono::seconds { 10 };
+}
+
+auto Executor::Create(uint cores, uint limit) noexcept -> Executor*
+{
+    auto* executor = new Executor {};
+    executor->Cores_ = cores ? cores : std::max(std::thread::hardware_concurrency(), 1u);
+    executor->Limit_ = std::max(limit, executor->Cores_);
+    executor->Lanes_ = std::make_unique<Lane[]>(executor->Cores_);
+
+    std::lock_guard _ { executor->Lock_ };
+    {
+        for (uint i = 0; i < executor->Cores_; ++i)
+        {
+            executor->Spawn(i);
+        }
+    }
+
+    executor->Watchdog_ = utils::Time::Schedule([executor] { return executor->Watch(); });
+    return executor;
+}
+
+Executor::~Executor()
+{
+    shutdown();
+}
+
+auto Executor::enqueue(std::function<void()> task) -> bool
+{
+    static auto& queue = utils::Metrics::Gauge("http_queue");
+
+    if (Stopping_)
+    {
+        return false;
+    }
+
+    // Spread over the lanes, so the producers and the core workers rarely contend for the same one
+    auto& lane = Lanes_[Next_.fetch_add(1, std::memory_order_relaxed) % Cores_];
+    {
+        std::lock_guard _ { lane.Lock };
+        lane.Tasks.push_back(std::move(task));
+    }
+
+    // The worker counts itself idle before it checks the queue, so one of the sides always sees the other.
+    // The notify is made under the lock, so it can't slip in between the check and the wait of the worker.
+    queue = ++Queued_;
+    if (Idle_ > 0)
+    {
+        std::lock_guard _ { Lock_ };
+        Wakeup_.notify_one();
+    }
+
+    return true;
+}
+
+void Executor::shutdown()
+{
+    {
+        std::lock_guard _ { Lock_ };
+        Stopping_ = true;
+        Wakeup_.notify_all();
+    }
+
+    // The workers finish the queued tasks before they exit
+    Watchdog_.Stop();
+
+    std::list<Worker> workers;
+    {
+        std::lock_guard _ { Lock_ };
+        workers.splice(workers.end(), Workers_);
+    }
+}
+
+void Executor::Work(Worker& worker, std::optional<uint> lane) noexcept
+{
+    static auto& queue = utils::Metrics::Gauge("http_queue");
+    static auto& workers = utils::Metrics::Gauge("http_workers");
+
+    while (true)
+    {
+        if (auto task = Take(lane))
+        {
+            queue = --Queued_;
+            ++Taken_;
+            (*task)();
+            continue;
+        }
+
+        std::unique_lock lock { Lock_ };
+        auto ready = [&] { return Queued_ > 0 || Stopping_; };
+
+        // Only the elastic workers retire, the core ones wait for the work forever
+        ++Idle_;
+        bool woken = lane ? (Wakeup_.wait(lock, ready), true) : Wakeup_.wait_for(lock, IdleTimeout, ready);
+        --Idle_;
+
+        if (Queued_ == 0 && (Stopping_ || !woken))
+        {
+            break;
+        }
+    }
+
+    --workers;
+    worker.Done = true;
+}
+
+auto Executor::Take(std::optional<uint> lane) noexcept -> std::optional<std::function<void()>>
+{
+    auto take = [&](uint index) -> std::optional<std::function<void()>>
+    {
+        auto& source = Lanes_[index];
+        std::lock_guard _ { source.Lock };
+
+        if (source.Tasks.empty())
+        {
+            return std::nullopt;
+        }
+
+        auto task = std::move(source.Tasks.front());
+        source.Tasks.pop_front();
+        return task;
+    };
+
+    if (lane)
+    {
+        if (auto task = take(*lane))
+        {
+            return task;
+        }
+    }
+
+    // Steal the oldest task of the others, the elastic workers start from the lane filled next
+    auto start = lane ? *lane + 1 : Next_.load(std::memory_order_relaxed);
+    for (uint i = 0; i < Cores_; ++i)
+    {
+        auto index = (start + i) % Cores_;
+        if (index == lane)
+        {
+            continue;
+        }
+
+        if (auto task = take(index))
+        {
+            return task;
+        }
+    }
+
+    return std::nullopt;
+}
+
+void Executor::Spawn(std::optional<uint> lane) noexcept
+{
+    static auto& workers = utils::Metrics::Gauge("http_workers");
+
+    auto& worker = Workers_.emplace_back();
+    worker.Thread = std::jthread { [this, &worker, lane] { Work(worker, lane); } };
+    ++workers;
+}
+
+auto Executor::Watch() noexcept -> time_t
+{
+    static auto& stalls = utils::Metrics::Counter("http_stalls");
+
+    std::lock_guard _ { Lock_ };
+    {
+        Workers_.remove_if([](const Worker& worker) { return worker.Done.load(); });
+
+        // Every worker is busy and none of them has taken a task since the last check, so the tasks block
+        auto taken = Taken_.load();
+        if (Queued_ > 0 && Idle_ == 0 && taken == WatchedTaken_ && !Stopping_ && Workers_.size() < Limit_)
+        {
+            // At most doubles per check, so a burst of the quick tasks behind the blocked ones doesn't spawn a worker each
+            auto grow = std::min({ (size_t)Queued_.load(), Workers_.size(), Limit_ - Workers_.size() });
+            for (size_t i = 0; i < grow; ++i)
+            {
+                Spawn(std::nullopt);
+            }
+
+            ++stalls;
+        }
+
+        WatchedTaken_ = taken;
+    }
+
+    return WatchInterval;
+}
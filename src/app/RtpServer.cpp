@@ -0,0 +1,233 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "app/RtpServer.h"
+using namespace ml::app;
+
+namespace
+{
+    constexpr size_t BatchSize = 32;
+    constexpr size_t DatagramSize = 2048; // above the usual MTU
+    constexpr int PollInterval = 100;
+    constexpr time_t RetryInterval = 1000; // how often the stream into the inactive channel is retried
+    constexpr int ReceiveBuffer = 1024*1024;
+}
+
+auto RtpServer::Create(const std::vector<RtpIngest>& ingests, time_t timeout, const std::shared_ptr<speaker::Driver>& speaker,
+    const audio::JitterConfig& jitter) noexcept -> std::shared_ptr<RtpServer>
+{
+    auto server = std::make_shared<RtpServer>();
+    server->Speaker_ = speaker;
+    server->Timeout_ = timeout;
+    server->Jitter_ = jitter;
+
+    for (const auto& ingest : ingests)
+    {
+        Binding binding;
+        binding.Ingest = ingest;
+        binding.Decoder = audio::RtpDecoder::Create(ingest.Encoding, ingest.Rate, ingest.Channels);
+        binding.Socket = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+
+        // The socket is kept by the server right away, so it's closed on any failure
+        server->Bindings_.push_back(binding);
+        if (!binding.Decoder || binding.Socket < 0)
+        {
+            return nullptr;
+        }
+
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(ingest.Port);
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        int reuse = 1;
+        setsockopt(binding.Socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        setsockopt(binding.Socket, SOL_SOCKET, SO_RCVBUF, &ReceiveBuffer, sizeof(ReceiveBuffer));
+
+        if (bind(binding.Socket, (const sockaddr*)&address, sizeof(address)) != 0)
+        {
+            return nullptr;
+        }
+    }
+
+    server->Receiver_ = std::jthread { [server = server.get()](const std::stop_token& token)
+    {
+        server->Receive(token);
+    }};
+
+    return server;
+}
+
+RtpServer::~RtpServer()
+{
+    // The streams and the sockets belong to the receiver till it stops
+    Receiver_.request_stop();
+    if (Receiver_.joinable())
+    {
+        Receiver_.join();
+    }
+
+    for (auto& binding : Bindings_)
+    {
+        Finish(binding);
+        if (binding.Socket >= 0)
+        {
+            close(binding.Socket);
+        }
+    }
+}
+
+void RtpServer::SetJitter(const audio::JitterConfig& jitter) noexcept
+{
+    std::lock_guard _ { JitterLock_ };
+    {
+        Jitter_ = jitter;
+    }
+}
+
+void RtpServer::Receive(const std::stop_token& token) noexcept
+{
+    static auto& batch = utils::Metrics::Distribution("rtp_batch_size");
+
+    std::vector<pollfd> sockets;
+    for (const auto& binding : Bindings_)
+    {
+        sockets.push_back({ .fd = binding.Socket, .events = POLLIN });
+    }
+
+    // The datagrams of a batch land in the consecutive slots of a single buffer
+    std::vector<uint8_t> buffer(BatchSize * DatagramSize);
+    std::array<iovec, BatchSize> vectors {};
+    std::array<mmsghdr, BatchSize> messages {};
+
+    for (size_t i = 0; i < BatchSize; ++i)
+    {
+        vectors[i] = { buffer.data() + i*DatagramSize, DatagramSize };
+        messages[i].msg_hdr.msg_iov = &vectors[i];
+        messages[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    while (!token.stop_requested())
+    {
+        if (poll(sockets.data(), sockets.size(), PollInterval) < 0)
+        {
+            continue;
+        }
+
+        auto now = utils::Time::Now();
+        for (size_t s = 0; s < sockets.size(); ++s)
+        {
+            if (!(sockets[s].revents & POLLIN))
+            {
+                continue;
+            }
+
+            // Drain the socket, the full batch means more datagrams may be waiting
+            int received = 0;
+            do
+            {
+                received = recvmmsg(sockets[s].fd, messages.data(), BatchSize, MSG_DONTWAIT, nullptr);
+                if (received <= 0)
+                {
+                    break;
+                }
+
+                batch.Record(received);
+                for (int i = 0; i < received; ++i)
+                {
+                    Handle(Bindings_[s], { buffer.data() + i*DatagramSize, messages[i].msg_len }, now);
+                }
+            }
+            while (received == BatchSize);
+        }
+
+        // The talkers that went silent end their streams, so the rest of the queue is played
+        for (auto& binding : Bindings_)
+        {
+            if (binding.Talker && now - binding.LastPacket > Timeout_)
+            {
+                Finish(binding);
+            }
+        }
+    }
+}
+
+void RtpServer::Handle(Binding& binding, std::span<const uint8_t> datagram, time_t now) noexcept
+{
+    static auto& packets = utils::Metrics::Counter("rtp_packets");
+    static auto& invalid = utils::Metrics::Counter("rtp_invalid_packets");
+    static auto& rejected = utils::Metrics::Counter("rtp_rejected_packets");
+
+    ++packets;
+    auto packet = audio::RtpDecoder::Parse(datagram);
+    if (!packet)
+    {
+        ++invalid;
+        return;
+    }
+
+    // Another talker takes over the port
+    if (binding.Talker != packet->Ssrc)
+    {
+        Finish(binding);
+        binding.Talker = packet->Ssrc;
+    }
+
+    binding.LastPacket = now;
+    if (binding.Cut)
+    {
+        ++rejected;
+        return;
+    }
+
+    if (!binding.Stream)
+    {
+        if (now - binding.LastAttempt < RetryInterval)
+        {
+            ++rejected;
+            return;
+        }
+
+        std::optional<audio::JitterConfig> jitter;
+        {
+            std::lock_guard _ { JitterLock_ };
+            jitter = Jitter_;
+        }
+
+        binding.LastAttempt = now;
+        auto stream = Speaker_->Stream(binding.Ingest.Channel, binding.Decoder->Spec(), jitter);
+        if (!stream)
+        {
+            ++rejected;
+            return;
+        }
+
+        binding.Stream = stream.value();
+    }
+
+    auto samples = binding.Decoder->Decode(packet->Payload);
+    if (samples.empty())
+    {
+        ++invalid;
+        return;
+    }
+
+    // The stream fails only when it was skipped or cleared
+    if (!binding.Stream->Feed(samples, packet->Sequence))
+    {
+        ++rejected;
+        binding.Stream.reset();
+        binding.Cut = true;
+    }
+}
+
+void RtpServer::Finish(Binding& binding) noexcept
+{
+    if (binding.Stream)
+    {
+        binding.Stream->End();
+    }
+
+    binding.Stream.reset();
+    binding.Talker.reset();
+    binding.Cut = false;
+    binding.LastAttempt = 0;
+}
@@ -2,174 +2,937 @@
 #include "app/WebServer.h"
 using namespace ml::app;
 
+namespace
+{
+    // The request is served by a single worker from the routing till the logging, so its context is kept by the thread
+    thread_local std::string RequestId;
+    thread_local std::chrono::steady_clock::time_point RequestStart;
+}
+
 auto WebServer::Run(const std::string& configPath) noexcept -> bool
 {
-    // Load the config
-    std::ifstream stream { configPath };
-    if (!stream)
+    // Reloads are requested by SIGHUP, block it before any thread starts so only the reload thread receives it
+    sigset_t hangup;
+    sigemptyset(&hangup);
+    sigaddset(&hangup, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &hangup, nullptr);
+
+    // Load the config, the reload replaces it along with the devices
+    Runtime runtime { .ConfigPath = configPath, .Current = LoadConfig(configPath) };
+    auto& config = runtime.Current;
+    if (!config)
     {
-        std::cerr << "Can't open the config file.";
         return false;
     }
 
-    auto config = ConfigParser::FromIni({ std::istreambuf_iterator<char> { stream }, std::istreambuf_iterator<char> {} });
-    if (!config)
+    // Reserve the cores before any thread starts ( the log writer included ), the audio and the mainloop threads take
+    // their scheduling on the first run
+    utils::Realtime::Configure(utils::RealtimeConfig {
+        .Policy = *utils::Realtime::ParsePolicy(config->AudioScheduling),
+        .Priority = config->AudioPriority,
+        .AudioCpus = *utils::Realtime::ParseCpus(config->AudioCpus),
+        .MainloopCpus = *utils::Realtime::ParseCpus(config->MainloopCpus)
+    });
+
+    if (config->MemoryLock && !utils::Realtime::LockMemory())
+    {
+        std::cout << "Can't lock the memory, the audio may wait for the page faults. Check RLIMIT_MEMLOCK, CAP_IPC_LOCK or the kernel ( 4.4+ ).\n";
+    }
+
+    // Start the log, the records are written by the background thread
+    if (!utils::Logger::Start(config->LogFile, config->LogMemory))
     {
-        std::cerr << "Can't parse the config.";
+        std::cerr << "Can't open the log. Check log-file validity.\n";
         return false;
     }
 
-    stream.close();
+    utils::Logger::SetLevel(*utils::Logger::ParseLevel(config->LogLevel));
+    runtime.Sampling = config->LogSample;
+
+    // Create the hardware
+    runtime.Relay = CreateRelay(*config);
+    if (!runtime.Relay)
+    {
+        std::cerr << "Can't create the power relay. Check power-relay and power-port validity.\n";
+        return false;
+    }
+
+    runtime.Output = CreateOutput(*config);
+    if (!runtime.Output)
+    {
+        std::cerr << "Can't create the audio output. Check audio-backend and audio-file validity.\n";
+        return false;
+    }
+
+    runtime.Pool = audio::PagePool::Create(config->AudioPageSize, (uint32_t)config->AudioPoolPages, config->AudioPoolHugepages, config->MemoryLock);
+    if (!runtime.Pool)
+    {
+        std::cerr << "Can't reserve the audio pool. Check audio-page-size and audio-pool-pages validity.\n";
+        return false;
+    }
 
     // Create the amplifier
-    auto amplifier = amplifier::LampDriver::Create(amplifier::LampConfig {
+    runtime.Amplifier = amplifier::LampDriver::Create(amplifier::LampConfig {
         .WarmingDuration = config->WarmingDuration,
         .CoolingDuration = config->CoolingDuration,
-        .PowerPort = config->PowerPort,
-        .AudioDevice = config->AudioDevice,
+        .Thermal = config->ThermalModel == "exponential" ? amplifier::TC_Exponential : amplifier::TC_Binary,
+        .ThermalThreshold = config->ThermalThreshold,
+        .PowerRelay = runtime.Relay,
+        .AudioOutput = runtime.Output,
+        .AudioPool = runtime.Pool,
+        .Blending = CreateBlending(*config),
+        .AudioFormat = { .freq = config->AudioRate, .format = *audio::Utils::ParseFormat(config->AudioFormat), .channels = config->AudioChannels },
         .Channels = (uint)config->Channels.size()
     });
 
-    if (!amplifier)
+    if (!runtime.Amplifier)
     {
-        std::cerr << "Can't create the amplifier driver. Check audio-device and power-power validity.\n";
+        std::cerr << "Can't create the amplifier driver. Check audio-device and thermal-threshold validity.\n";
         return false;
     }
 
+    // Everything is decoded right into the output format, so warn when the device couldn't keep the canonical one
+    auto spec = runtime.Amplifier->Spec();
+    if (spec.freq != config->AudioRate || spec.format != *audio::Utils::ParseFormat(config->AudioFormat) || spec.channels != config->AudioChannels)
+    {
+        std::cout << "The audio output doesn't support the canonical format, using " << spec.freq << "Hz "
+                  << (int)spec.channels << "ch instead.\n";
+    }
+
+    // Load the clips in the output format, so they are played as is
+    std::shared_ptr<audio::ClipLibrary> clips;
+    if (config->ClipPath)
+    {
+        clips = audio::ClipLibrary::Create(*config->ClipPath, runtime.Amplifier->Spec());
+        if (!clips)
+        {
+            std::cerr << "Can't load the clips. Check clip-path validity and the wav files in it.\n";
+            return false;
+        }
+
+        std::cout << "Loaded " << clips->Size() << " clips from " << *config->ClipPath << '\n';
+    }
+
+    // Create the demand predictor
+    std::shared_ptr<speaker::Predictor> predictor;
+    if (config->Prewarm)
+    {
+        predictor = speaker::Predictor::Create(speaker::PredictorConfig {
+            .Channels = (uint)config->Channels.size(),
+            .SlotDuration = config->PrewarmSlot,
+            .Threshold = config->PrewarmThreshold,
+            .Decay = config->PrewarmDecay,
+            .LampBudget = config->PrewarmLampBudget,
+            .EnergyBudget = config->PrewarmEnergyBudget,
+            .AmplifierPower = config->AmplifierPower
+        });
+
+        if (!predictor)
+        {
+            std::cerr << "Can't create the demand predictor. Check prewarm section validity.\n";
+            return false;
+        }
+    }
+
+    // Create the queue journal
+    std::shared_ptr<speaker::Journal> journal;
+    if (config->JournalPath)
+    {
+        journal = speaker::Journal::Create(*config->JournalPath, clips);
+        if (!journal)
+        {
+            std::cerr << "Can't open the journal. Check journal-path validity.\n";
+            return false;
+        }
+    }
+
     // Create the speaker driver
-    auto speaker = speaker::Driver::Create(speaker::Config {
-        .Amplifier = amplifier,
-        .Channels = config->Channels
+    runtime.Speaker = speaker::Driver::Create(speaker::Config {
+        .Amplifier = runtime.Amplifier,
+        .Channels = config->Channels,
+        .DemandPredictor = predictor,
+        .QueueJournal = journal
     });
 
-    if (!speaker)
+    if (!runtime.Speaker)
     {
         std::cerr << "Can't create the speaker driver.\n";
         return false;
     }
 
-    std::cout << "Connected to the audio device: " << config->AudioDevice.value_or("default") << '\n';
-    std::cout << "Connected to the relay: " << config->PowerPort << '\n';
+    SetPreemption(*config, *runtime.Speaker);
+
+    // Receive the rtp streams right into the channels
+    if (!config->RtpIngests.empty())
+    {
+        runtime.Rtp = RtpServer::Create(config->RtpIngests, config->RtpTimeout, runtime.Speaker, CreateJitter(*config));
+        if (!runtime.Rtp)
+        {
+            std::cerr << "Can't receive the rtp streams. Check rtp-port, rtp-encoding, rtp-rate and rtp-channels validity.\n";
+            return false;
+        }
+
+        std::cout << "Receiving " << config->RtpIngests.size() << " rtp streams\n";
+    }
+
+    // Admit the uploads by the limits and the priorities of their channels
+    runtime.Admitter = Admission::Create(config->DecodeSlots, config->DecodeQueue, config->DecodeWait, config->ChannelLimits);
+
+    std::cout << "Connected to the audio device: " << config->AudioBackend << ' ' << config->AudioDevice.value_or("default") << '\n';
+    std::cout << "Connected to the relay: " << runtime.Relay->Path() << '\n';
+
+    // Prepares the enqueued track, both stages only narrow the view or set the gain, so the samples are never copied:
+    // - The silence is trimmed when the channel does it by default or the request asks for it ( ?trim=1 or ?trim=0 ).
+    //   The unknown value of the flag fails the preparation.
+    // - The track is brought to the target loudness, the measurement is cached in the track ( the clips have it from the bundle ).
+    auto prepare = [&](const httplib::Request& req, audio::Track& track) -> bool
+    {
+        std::shared_lock _ { runtime.Lock };
+
+        const auto& trimmed = config->TrimmedChannels;
+        bool trim = std::find(trimmed.begin(), trimmed.end(), req.path_params.at("channel")) != trimmed.end();
+
+        if (!ParseFlag(req.get_param_value("trim"), trim))
+        {
+            return false;
+        }
+
+        if (trim)
+        {
+            track = audio::Utils::TrimSilence(track, config->TrimThreshold);
+        }
+
+        if (config->LoudnessTarget)
+        {
+            audio::Loudness::Normalize(track, *config->LoudnessTarget, config->LoudnessMaxGain);
+        }
+
+        return true;
+    };
+
+    // The uploads are admitted before the decoding, the session requests are cheap and never wait behind them
+    auto admit = [&](const httplib::Request& req, size_t bytes) -> std::expected<Admission::Ticket, httplib::Response>
+    {
+        const auto& channel = req.path_params.at("channel");
+
+        auto priority = runtime.Speaker->Priority(channel);
+        if (!priority)
+        {
+            return std::unexpected { BindError(priority.error()) };
+        }
+
+        auto ticket = runtime.Admitter->Admit(channel, *priority, bytes);
+        return ticket ? std::expected<Admission::Ticket, httplib::Response> { std::move(*ticket) } : std::unexpected { BindRejection(ticket.error()) };
+    };
+
+    // Raw samples are described by the query or the headers, the missing properties are taken from the output
+    auto field = [](const httplib::Request& req, const std::string& param, const std::string& header)
+    {
+        return req.has_param(param) ? req.get_param_value(param) : req.get_header_value(header);
+    };
+
+    auto described = [&](const httplib::Request& req)
+    {
+        return !field(req, "format", "X-Audio-Format").empty() || !field(req, "rate", "X-Audio-Rate").empty() ||
+            !field(req, "channels", "X-Audio-Channels").empty();
+    };
+
+    auto pcmSpec = [&](const httplib::Request& req) -> std::optional<SDL_AudioSpec>
+    {
+        auto format = field(req, "format", "X-Audio-Format");
+        auto spec = runtime.Amplifier->Spec();
+        auto parsed = format.empty() ? std::optional { spec.format } : audio::Utils::ParseFormat(format);
+
+        bool valid = parsed && ParseNumber(field(req, "rate", "X-Audio-Rate"), spec.freq) &&
+            ParseNumber(field(req, "channels", "X-Audio-Channels"), spec.channels);
+
+        spec.format = parsed.value_or(spec.format);
+        return valid ? std::optional { spec } : std::nullopt;
+    };
+
+    // The live streams of the channels that smooth the network jitter are played through the jitter buffer ( ?jitter=1 or ?jitter=0 )
+    auto jitter = [&](const httplib::Request& req, std::optional<audio::JitterConfig>& buffer) -> bool
+    {
+        std::shared_lock _ { runtime.Lock };
+
+        const auto& buffered = config->JitterChannels;
+        bool enabled = std::find(buffered.begin(), buffered.end(), req.path_params.at("channel")) != buffered.end();
+
+        if (!ParseFlag(req.get_param_value("jitter"), enabled))
+        {
+            return false;
+        }
+
+        buffer = enabled ? std::optional { CreateJitter(*config) } : std::nullopt;
+        return true;
+    };
 
     // Create the server & the API
     // For docs refer to API.md
     httplib::Server app;
-    app.new_task_queue = [] { return new httplib::ThreadPool(8096); };
+    app.new_task_queue = [&] { return Executor::Create(config->HttpWorkers, config->HttpWorkersMax); };
 
     // Enable CORS
     app.set_cors(R"(.*)")
         .allow_credentials();
 
-    // Create authorization by token and logging
+    // Create authorization by token, the request keeps the id of the client or gets a new one
+    std::atomic<uint64_t> requests;
     app.set_pre_routing_handler([&](const auto& req, auto& res)
     {
-        std::cout << httplib::HttpMethod::to_string(req.method) << " request to " << req.path
-                  << " from " << req.remote_addr << std::endl;
+        RequestStart = std::chrono::steady_clock::now();
+        RequestId = req.has_header("X-Request-Id") ? req.get_header_value("X-Request-Id") : std::to_string(++requests);
 
+        std::shared_lock _ { runtime.Lock };
         if (req.get_header_value("Authorization") != config->Token)
         {
             res = Response(401, "401 Unauthorized");
+            res.set_header("X-Request-Id", RequestId);
             return httplib::Server::HandlerResponse::Handled;
         }
 
         return httplib::Server::HandlerResponse::Unhandled;
     });
 
+    app.set_post_routing_handler([](const auto& req, auto& res)
+    {
+        res.set_header("X-Request-Id", RequestId);
+    });
+
+    // Log the served requests, only every n-th of the polling and the prolongation is logged unless it fails
+    std::atomic<uint64_t> frequents;
+    app.set_logger([&](const httplib::Request& req, const httplib::Response& res)
+    {
+        auto method = httplib::HttpMethod::to_string(req.method);
+        bool frequent = method == "GET" || req.path.ends_with("/prolong");
+        auto sample = frequent ? std::max(runtime.Sampling.load(), 1u) : 1u;
+
+        if (frequent && res.status < 400 && frequents++ % sample)
+        {
+            return;
+        }
+
+        auto level = res.status >= 500 ? utils::LL_Error : res.status >= 400 ? utils::LL_Warning : utils::LL_Info;
+        auto latency = std::chrono::duration<double, std::milli> { std::chrono::steady_clock::now() - RequestStart }.count();
+
+        utils::Logger::Write(level, "request", {
+            { "id", RequestId },
+            { "method", method },
+            { "path", req.path },
+            { "remote", req.remote_addr },
+            { "status", (int64_t)res.status },
+            { "latency_ms", latency },
+            { "sample", (int64_t)sample }
+        });
+    });
+
+    // Channels management, ?priority=N places the channel at the position N of the priorities list ( the top by default )
+    app.Post("/:channel/create", [&](const httplib::Request& req, httplib::Response& res)
+    {
+        auto value = req.get_param_value("priority");
+        auto policy = req.get_param_value("preempt");
+        uint priority = std::numeric_limits<uint>::max();
+
+        auto [end, err] = std::from_chars(value.data(), value.data() + value.size(), priority);
+        if (!value.empty() && (err != std::errc {} || end != value.data() + value.size()))
+        {
+            res = Response(400, "400 Invalid Priority");
+            return;
+        }
+
+        if (!policy.empty() && policy != "mute" && policy != "pause")
+        {
+            res = Response(400, "400 Invalid Preemption");
+            return;
+        }
+
+        std::unique_lock _ { runtime.Lock };
+
+        auto name = req.path_params.at("channel");
+        auto r = runtime.Speaker->AddChannel(name, priority);
+        if (r)
+        {
+            runtime.Speaker->SetPreemption(name, policy == "pause" ? audio::PP_Pause : audio::PP_Mute);
+            runtime.Created.push_back(name);
+        }
+
+        res = r ? Response(200, "Ok") : BindError(r.error());
+    });
+
+    // Only the runtime.Created channels may be removed, the configured ones are removed from the config
+    app.Post("/:channel/remove", [&](const httplib::Request& req, httplib::Response& res)
+    {
+        std::unique_lock _ { runtime.Lock };
+
+        auto name = req.path_params.at("channel");
+        auto it = std::find(runtime.Created.begin(), runtime.Created.end(), name);
+        if (it == runtime.Created.end())
+        {
+            auto r = runtime.Speaker->State(name);
+            res = r ? Response(400, "400 Channel Configured") : BindError(r.error());
+            return;
+        }
+
+        auto r = runtime.Speaker->RemoveChannel(name);
+        runtime.Created.erase(it);
+
+        res = r ? Response(200, "Ok") : BindError(r.error());
+    });
+
     // Session management
     app.Post("/:channel/open", [&](const httplib::Request& req, httplib::Response& res)
     {
-        auto r = speaker->Open(req.path_params.at("channel"));
+        auto r = runtime.Speaker->Open(req.path_params.at("channel"));
         res = r ? Response(200, "Ok") : BindError(r.error());
     });
 
     app.Post("/:channel/prolong", [&](const httplib::Request& req, httplib::Response& res)
     {
-        auto r = speaker->Prolong(req.path_params.at("channel"));
+        auto r = runtime.Speaker->Prolong(req.path_params.at("channel"));
         res = r ? Response(200, "Ok") : BindError(r.error());
     });
 
     // Activate/deactivate channel
     app.Post("/:channel/activate", [&](const httplib::Request& req, httplib::Response& res)
     {
-        auto r = speaker->Activate(req.path_params.at("channel"), req.has_param("urgently"));
+        auto r = runtime.Speaker->Activate(req.path_params.at("channel"), req.has_param("urgently"));
         res = r ? LongPolling(r.value()) : BindError(r.error());
     });
 
     app.Post("/:channel/deactivate", [&](const httplib::Request& req, httplib::Response& res)
     {
-        auto r = speaker->Deactivate(req.path_params.at("channel"), req.has_param("urgently"));
+        auto r = runtime.Speaker->Deactivate(req.path_params.at("channel"), req.has_param("urgently"));
         res = r ? LongPolling(r.value()) : BindError(r.error());
     });
 
     // Playback management
     app.Post("/:channel/play", [&](const httplib::Request& req, httplib::Response& res)
     {
-        std::string raw = req.body;
-        std::vector<char> decoded { raw.begin(), raw.end() };
+        auto ticket = admit(req, req.body.size());
+        if (!ticket)
+        {
+            res = ticket.error();
+            return;
+        }
+
+        std::optional<audio::Track> track;
+        if (!described(req))
+        {
+            // The samples are converted right into the queue pages, so the body is decoded in place
+            track = audio::TrackLoader::FromWav(req.body);
+            if (!track)
+            {
+                res = Response(400, "400 Track Not Wav");
+                return;
+            }
+        }
+        else
+        {
+            // The body isn't read after this point, so the track takes it over and is played right from it
+            auto spec = pcmSpec(req);
+            track = spec ? audio::TrackLoader::FromPcm(std::move(const_cast<std::string&>(req.body)), *spec) : std::nullopt;
+            if (!track)
+            {
+                res = Response(400, "400 Invalid Pcm");
+                return;
+            }
+        }
+
+        if (!prepare(req, *track))
+        {
+            res = Response(400, "400 Invalid Flag");
+            return;
+        }
+
+        // The decode slot isn't kept while the track is played
+        auto r = runtime.Speaker->Enqueue(req.path_params.at("channel"), *track);
+        ticket->Decoded();
+
+        res = r ? LongPolling(r.value()) : BindError(r.error());
+    });
+
+    // The chunked body is played while it's being received, the request ends once the stream is played out
+    app.Post("/:channel/stream", [&](const httplib::Request& req, httplib::Response& res, const httplib::ContentReader& content)
+    {
+        auto spec = pcmSpec(req);
+        time_t captured {};
+        std::optional<audio::JitterConfig> buffer;
 
-        auto track = audio::TrackLoader::FromWav(decoded);
-        if (!track)
+        if (!spec || !ParseNumber(req.get_header_value("X-Capture-Time"), captured))
         {
-            res = Response(400, "400 Track Not Wav");
+            res = Response(400, "400 Invalid Pcm");
             return;
         }
 
-        auto r = speaker->Enqueue(req.path_params.at("channel"), *track);
+        if (!jitter(req, buffer))
+        {
+            res = Response(400, "400 Invalid Flag");
+            return;
+        }
+
+        auto r = runtime.Speaker->Stream(req.path_params.at("channel"), *spec, buffer);
+        if (!r)
+        {
+            res = BindError(r.error());
+            return;
+        }
+
+        auto stream = r.value();
+        if (captured)
+        {
+            stream->SetCaptureTime(captured);
+        }
+
+        // The stream is cut off when it's skipped or cleared, the rest of the body is dropped then
+        content([&](const char* data, size_t size)
+        {
+            return stream->Feed({ (const uint8_t*)data, size });
+        });
+
+        res = LongPolling(stream->End());
+    });
+
+    app.Post("/:channel/play-clip/:name", [&](const httplib::Request& req, httplib::Response& res)
+    {
+        auto* clip = clips ? clips->Find(req.path_params.at("name")) : nullptr;
+        if (!clip)
+        {
+            res = Response(404, "404 Clip Not Found");
+            return;
+        }
+
+        // The clips are decoded already, but their loudness may be measured
+        auto ticket = admit(req, 0);
+        if (!ticket)
+        {
+            res = ticket.error();
+            return;
+        }
+
+        auto track = *clip;
+        if (!prepare(req, track))
+        {
+            res = Response(400, "400 Invalid Flag");
+            return;
+        }
+
+        auto r = runtime.Speaker->Enqueue(req.path_params.at("channel"), track);
+        ticket->Decoded();
+
         res = r ? LongPolling(r.value()) : BindError(r.error());
     });
 
     app.Post("/:channel/skip", [&](const httplib::Request& req, httplib::Response& res)
     {
-        auto r = speaker->Skip(req.path_params.at("channel"));
+        auto r = runtime.Speaker->Skip(req.path_params.at("channel"));
         res = r ? Response(200, "Ok") : BindError(r.error());
     });
 
     app.Post("/:channel/clear", [&](const httplib::Request& req, httplib::Response& res)
     {
-        auto r = speaker->Clear(req.path_params.at("channel"));
+        auto r = runtime.Speaker->Clear(req.path_params.at("channel"));
         res = r ? Response(200, "Ok") : BindError(r.error());
     });
 
+    // Channel settings
+    app.Post("/:channel/gain", [&](const httplib::Request& req, httplib::Response& res)
+    {
+        auto value = req.get_param_value("db");
+        double db = 0;
+        auto [end, err] = std::from_chars(value.data(), value.data() + value.size(), db);
+
+        if (value.empty() || err != std::errc {} || end != value.data() + value.size() || !std::isfinite(db) || db < -96 || db > 24)
+        {
+            res = Response(400, "400 Invalid Gain");
+            return;
+        }
+
+        auto r = runtime.Speaker->SetGain(req.path_params.at("channel"), db);
+        res = r ? Response(200, "Ok") : BindError(r.error());
+    });
+
+    app.Get("/:channel/gain", [&](const httplib::Request& req, httplib::Response& res)
+    {
+        auto r = runtime.Speaker->Gain(req.path_params.at("channel"));
+        res = r ? Response(200, std::to_string(r.value())) : BindError(r.error());
+    });
+
     // Channel state getters
     app.Get("/:channel/state", [&](const httplib::Request& req, httplib::Response& res)
     {
-        auto r = speaker->State(req.path_params.at("channel"));
+        auto r = runtime.Speaker->State(req.path_params.at("channel"));
         res = r ? BindState(r.value()) : BindError(r.error());
     });
 
     app.Get("/:channel/duration-left", [&](const httplib::Request& req, httplib::Response& res)
     {
-        auto r = speaker->DurationLeft(req.path_params.at("channel"));
+        auto r = runtime.Speaker->DurationLeft(req.path_params.at("channel"));
         res = r ? Response(200, std::to_string(r.value())) : BindError(r.error());
     });
 
     // Speaker state getters
     app.Get("/activation-duration", [&](const httplib::Request& req, httplib::Response& res)
     {
-        res = Response(200, std::to_string(speaker->ActivationDuration(req.has_param("urgently"))));
+        res = Response(200, std::to_string(runtime.Speaker->ActivationDuration(req.has_param("urgently"))));
     });
 
     app.Get("/deactivation-duration", [&](const httplib::Request& req, httplib::Response& res)
     {
-        res = Response(200, std::to_string(speaker->DeactivationDuration(req.has_param("urgently"))));
+        res = Response(200, std::to_string(runtime.Speaker->DeactivationDuration(req.has_param("urgently"))));
     });
 
     app.Get("/duration-left", [&](const httplib::Request& req, httplib::Response& res)
     {
-        res = Response(200, std::to_string(speaker->DurationLeft()));
+        res = Response(200, std::to_string(runtime.Speaker->DurationLeft()));
     });
 
     app.Get("/ready", [&](const httplib::Request& req, httplib::Response& res)
     {
-        res = Response(200, std::to_string(speaker->Ready()));
+        res = Response(200, std::to_string(runtime.Speaker->Ready()));
+    });
+
+    // Runtime metrics
+    app.Get("/metrics", [&](const httplib::Request& req, httplib::Response& res)
+    {
+        res = Response(200, utils::Metrics::Render());
     });
 
+    // Configuration
+    app.Post("/reload", [&](const httplib::Request& req, httplib::Response& res)
+    {
+        auto r = Reload(runtime);
+        res = r ? Response(200, *r) : Response(400, "400 Invalid Config");
+    });
+
+    std::jthread reloader { [&](const std::stop_token& token)
+    {
+        timespec timeout { 0, 200'000'000 };
+        while (!token.stop_requested())
+        {
+            if (sigtimedwait(&hangup, nullptr, &timeout) == SIGHUP)
+            {
+                auto r = Reload(runtime);
+                r ? utils::Logger::Write(utils::LL_Info, "reloaded the config", { { "report", *r } }) :
+                    utils::Logger::Write(utils::LL_Error, "can't reload the config, kept the current one");
+            }
+        }
+    }};
+
     std::cout << "Created the web-server. Running it on the port " << config->Port << std::endl;
     app.listen("127.0.0.1", config->Port);
 
     return true;
 }
 
+auto WebServer::Reload(Runtime& runtime) noexcept -> std::optional<std::string>
+{
+    auto& config = runtime.Current;
+    auto next = LoadConfig(runtime.ConfigPath);
+    if (!next)
+    {
+        return std::nullopt;
+    }
+
+    std::unique_lock _ { runtime.Lock };
+    std::string report;
+
+    // The hot settings are taken from the new config, the devices are reverted below when they can't be replaced
+    auto applied = *config;
+    Config::TakeHot(*next, applied);
+
+    if (next->Token != config->Token) report += "token: applied\n";
+
+    if (next->Channels != config->Channels)
+    {
+        // The created channel that is configured now becomes a regular one
+        std::erase_if(runtime.Created, [&](const std::string& name)
+        {
+            return std::find(next->Channels.begin(), next->Channels.end(), name) != next->Channels.end();
+        });
+
+        auto channels = next->Channels;
+        auto current = runtime.Speaker->Channels();
+
+        for (size_t i = 0; i < current.size(); ++i)
+        {
+            if (std::find(runtime.Created.begin(), runtime.Created.end(), current[i]) != runtime.Created.end())
+            {
+                channels.insert(channels.begin() + (long)std::min(i, channels.size()), current[i]);
+            }
+        }
+
+        runtime.Speaker->Remap(channels);
+        report += "channels: applied\n";
+    }
+
+    if (next->Channels != config->Channels || next->PausedChannels != config->PausedChannels)
+    {
+        SetPreemption(*next, *runtime.Speaker);
+        report += next->PausedChannels != config->PausedChannels ? "preemption: applied\n" : "";
+    }
+
+    // Devices are recreated only when their settings change, the new ones take over the state of the old ones
+    auto nextRelay = runtime.Relay;
+    if (next->PowerRelay != config->PowerRelay || next->PowerPort != config->PowerPort)
+    {
+        nextRelay = CreateRelay(*next);
+        report += nextRelay ? "power-relay: applied\n" : "power-relay: can't be created, kept\n";
+    }
+
+    auto nextOutput = runtime.Output;
+    if (next->AudioBackend != config->AudioBackend || next->AudioDevice != config->AudioDevice || next->AudioFile != config->AudioFile ||
+        next->AudioPeriod != config->AudioPeriod || next->AudioBuffer != config->AudioBuffer)
+    {
+        nextOutput = CreateOutput(*next);
+        report += nextOutput ? "" : "audio: can't be created, kept\n";
+    }
+
+    bool reconfigured = runtime.Amplifier->Reconfigure(amplifier::LampConfig {
+        .WarmingDuration = next->WarmingDuration,
+        .CoolingDuration = next->CoolingDuration,
+        .Thermal = next->ThermalModel == "exponential" ? amplifier::TC_Exponential : amplifier::TC_Binary,
+        .ThermalThreshold = next->ThermalThreshold,
+        .PowerRelay = nextRelay ? nextRelay : runtime.Relay,
+        .AudioOutput = nextOutput ? nextOutput : runtime.Output,
+        .AudioPool = runtime.Pool,
+        .Blending = CreateBlending(*next)
+    });
+
+    if (nextRelay)
+    {
+        runtime.Relay = nextRelay;
+    }
+    else
+    {
+        applied.PowerRelay = config->PowerRelay;
+        applied.PowerPort = config->PowerPort;
+    }
+
+    // The thermal settings are validated by the parser, so only the audio output may be rejected
+    if (nextOutput && nextOutput != runtime.Output)
+    {
+        report += reconfigured ? "audio: applied\n" : "audio: incompatible with the queued audio, kept\n";
+    }
+
+    if (nextOutput && reconfigured)
+    {
+        runtime.Output = nextOutput;
+    }
+    else
+    {
+        applied.AudioBackend = config->AudioBackend;
+        applied.AudioDevice = config->AudioDevice;
+        applied.AudioFile = config->AudioFile;
+        applied.AudioPeriod = config->AudioPeriod;
+        applied.AudioBuffer = config->AudioBuffer;
+    }
+
+    if (applied.WarmingDuration != config->WarmingDuration || applied.CoolingDuration != config->CoolingDuration ||
+        applied.ThermalModel != config->ThermalModel || applied.ThermalThreshold != config->ThermalThreshold)
+    {
+        report += "durations: applied\n";
+    }
+
+    if (applied.BlendMode != config->BlendMode || applied.DuckDepth != config->DuckDepth ||
+        applied.DuckAttack != config->DuckAttack || applied.DuckRelease != config->DuckRelease)
+    {
+        report += "blending: applied\n";
+    }
+
+    if (applied.LoudnessTarget != config->LoudnessTarget || applied.LoudnessMaxGain != config->LoudnessMaxGain)
+    {
+        report += "loudness: applied\n";
+    }
+
+    if (applied.TrimThreshold != config->TrimThreshold || applied.TrimmedChannels != config->TrimmedChannels)
+    {
+        report += "trimming: applied\n";
+    }
+
+    if (applied.JitterTarget != config->JitterTarget || applied.JitterMax != config->JitterMax || applied.JitterChannels != config->JitterChannels)
+    {
+        report += "jitter buffer: applied\n";
+        if (runtime.Rtp)
+        {
+            runtime.Rtp->SetJitter(CreateJitter(applied));
+        }
+    }
+
+    if (applied.LogLevel != config->LogLevel || applied.LogSample != config->LogSample)
+    {
+        utils::Logger::SetLevel(*utils::Logger::ParseLevel(applied.LogLevel));
+        runtime.Sampling = applied.LogSample;
+        report += "logging: applied\n";
+    }
+
+    if (applied.DecodeSlots != config->DecodeSlots || applied.DecodeQueue != config->DecodeQueue ||
+        applied.DecodeWait != config->DecodeWait || applied.ChannelLimits != config->ChannelLimits)
+    {
+        runtime.Admitter->Reconfigure(applied.DecodeSlots, applied.DecodeQueue, applied.DecodeWait, applied.ChannelLimits);
+        report += "admission: applied\n";
+    }
+
+    // Whatever differs once the hot settings are taken from the new config requires a restart
+    auto cold = *next;
+    Config::TakeHot(*config, cold);
+
+    if (cold != *config)
+    {
+        report += "port, prewarm, journal-path, clip-path, log-file, log-memory, http workers, audio format, audio pool, scheduling: require a restart, kept\n";
+    }
+
+    *config = applied;
+    return report.empty() ? "nothing changed\n" : report;
+}
+
+void WebServer::SetPreemption(const Config& config, speaker::Driver& speaker) noexcept
+{
+    // The policies are applied by the channel names, so they are set again whenever the channels change
+    for (const auto& channel : config.Channels)
+    {
+        bool paused = std::find(config.PausedChannels.begin(), config.PausedChannels.end(), channel) != config.PausedChannels.end();
+        speaker.SetPreemption(channel, paused ? audio::PP_Pause : audio::PP_Mute);
+    }
+}
+
+auto WebServer::LoadConfig(const std::string& path) noexcept -> std::optional<Config>
+{
+    std::ifstream stream { path };
+    if (!stream)
+    {
+        std::cerr << "Can't open the config file.\n";
+        return std::nullopt;
+    }
+
+    auto config = ConfigParser::FromIni({ std::istreambuf_iterator<char> { stream }, std::istreambuf_iterator<char> {} });
+    if (!config)
+    {
+        std::cerr << "Can't parse the config.\n";
+        return std::nullopt;
+    }
+
+    if (config->ThermalModel != "binary" && config->ThermalModel != "exponential")
+    {
+        std::cerr << "Unknown thermal-model, expected binary or exponential.\n";
+        return std::nullopt;
+    }
+
+    if (!audio::Utils::ParseFormat(config->AudioFormat) || config->AudioRate <= 0 || config->AudioChannels == 0)
+    {
+        std::cerr << "Invalid audio format, check audio-rate, audio-format ( s16, s32, f32 or u8 ) and audio-channels.\n";
+        return std::nullopt;
+    }
+
+    if (config->AudioPageSize < sizeof(void*) || config->AudioPoolPages == 0 || config->AudioPoolPages > UINT32_MAX)
+    {
+        std::cerr << "Invalid audio pool, expected audio-page-size of at least 8 bytes and audio-pool-pages between 1 and 4294967295.\n";
+        return std::nullopt;
+    }
+
+    if (config->ThermalThreshold <= 0 || config->ThermalThreshold >= 1)
+    {
+        std::cerr << "Invalid thermal-threshold, expected a value between 0 and 1.\n";
+        return std::nullopt;
+    }
+
+    if ((config->BlendMode != "exclusive" && config->BlendMode != "ducking") || config->DuckDepth < 0 ||
+        config->DuckAttack < 0 || config->DuckRelease < 0)
+    {
+        std::cerr << "Invalid blending, expected blend-mode exclusive or ducking and non-negative duck-depth, duck-attack and duck-release.\n";
+        return std::nullopt;
+    }
+
+    if ((config->LoudnessTarget && (*config->LoudnessTarget < -70 || *config->LoudnessTarget > 0)) || config->LoudnessMaxGain < 0)
+    {
+        std::cerr << "Invalid loudness, expected loudness-target between -70 and 0 LUFS and non-negative loudness-max-gain.\n";
+        return std::nullopt;
+    }
+
+    if (config->JitterTarget < 0 || config->JitterMax < config->JitterTarget)
+    {
+        std::cerr << "Invalid jitter buffer, expected non-negative jitter-target not above jitter-max.\n";
+        return std::nullopt;
+    }
+
+    if (!utils::Logger::ParseLevel(config->LogLevel))
+    {
+        std::cerr << "Unknown log-level, expected debug, info, warning or error.\n";
+        return std::nullopt;
+    }
+
+    auto policy = utils::Realtime::ParsePolicy(config->AudioScheduling);
+    if (!policy || (*policy != SCHED_OTHER && (config->AudioPriority < sched_get_priority_min(*policy) || config->AudioPriority > sched_get_priority_max(*policy))))
+    {
+        std::cerr << "Invalid scheduling, expected audio-scheduling other, fifo or rr and audio-priority within the range of the policy ( 1..99 ).\n";
+        return std::nullopt;
+    }
+
+    if (!utils::Realtime::ParseCpus(config->AudioCpus) || !utils::Realtime::ParseCpus(config->MainloopCpus))
+    {
+        std::cerr << "Invalid audio-cpus or mainloop-cpus, expected a list of cores, e.g. 2,3 or 2-5.\n";
+        return std::nullopt;
+    }
+
+    if (config->HttpWorkersMax == 0)
+    {
+        std::cerr << "Invalid http-workers-max, expected a positive value.\n";
+        return std::nullopt;
+    }
+
+    if (config->DecodeWait < 0)
+    {
+        std::cerr << "Invalid decode-wait, expected a non-negative value.\n";
+        return std::nullopt;
+    }
+
+    for (const auto& ingest : config->RtpIngests)
+    {
+        if (ingest.Port == 0)
+        {
+            std::cerr << "Invalid rtp ingest of " << ingest.Channel << ", expected a non-zero rtp-port.\n";
+            return std::nullopt;
+        }
+    }
+
+    return config;
+}
+
+auto WebServer::CreateBlending(const Config& config) noexcept -> audio::BlendConfig
+{
+    return audio::BlendConfig {
+        .Mode = config.BlendMode == "ducking" ? audio::BM_Ducking : audio::BM_Exclusive,
+        .DuckDepth = config.DuckDepth,
+        .DuckAttack = config.DuckAttack,
+        .DuckRelease = config.DuckRelease
+    };
+}
+
+auto WebServer::CreateJitter(const Config& config) noexcept -> audio::JitterConfig
+{
+    return audio::JitterConfig {
+        .TargetLatency = config.JitterTarget,
+        .MaxLatency = config.JitterMax
+    };
+}
+
+auto WebServer::CreateRelay(const Config& config) noexcept -> std::shared_ptr<relay::Driver>
+{
+    if (config.PowerRelay == "serial") return relay::SerialDriver::Create(config.PowerPort);
+    if (config.PowerRelay == "memory") return relay::MemoryDriver::Create();
+    return nullptr;
+}
+
+auto WebServer::CreateOutput(const Config& config) noexcept -> std::shared_ptr<audio::Backend>
+{
+    if (config.AudioBackend == "sdl") return audio::SdlBackend::Create(config.AudioDevice);
+    if (config.AudioBackend == "null") return audio::NullBackend::Create();
+    if (config.AudioBackend == "file") return audio::FileBackend::Create(config.AudioFile);
+#ifdef ML_WITH_ALSA
+    if (config.AudioBackend == "alsa") return audio::AlsaBackend::Create(config.AudioDevice.value_or("default"), config.AudioPeriod, config.AudioBuffer);
+#endif
+    return nullptr;
+}
+
 auto WebServer::Response(int status, const std::string &text) noexcept -> httplib::Response 
 {
     auto r = httplib::Response {};
@@ -178,6 +941,49 @@ auto WebServer::Response(int status, const std::string &text) noexcept -> httpli
     return r;
 }
 
+template <typename T>
+auto WebServer::ParseNumber(const std::string& text, T& value) noexcept -> bool
+{
+    if (text.empty())
+    {
+        return true;
+    }
+
+    T parsed {};
+    auto [end, err] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+    if (err != std::errc {} || end != text.data() + text.size() || parsed <= 0)
+    {
+        return false;
+    }
+
+    value = parsed;
+    return true;
+}
+
+auto WebServer::ParseFlag(const std::string& text, bool& value) noexcept -> bool
+{
+    if (text.empty())
+    {
+        return true;
+    }
+
+    // The same spellings as the booleans of the config
+    auto is = [&](std::initializer_list<std::string_view> names) { return std::ranges::find(names, text) != names.end(); };
+    if (is({ "1", "true", "yes", "on" }))
+    {
+        value = true;
+        return true;
+    }
+
+    if (is({ "0", "false", "no", "off" }))
+    {
+        value = false;
+        return true;
+    }
+
+    return false;
+}
+
 auto WebServer::LongPolling(const std::future<void>& f) noexcept -> httplib::Response
 {
     f.wait();
@@ -191,9 +997,17 @@ auto WebServer::BindError(speaker::ActionError error) noexcept -> httplib::Respo
     if (error == speaker::AE_ChannelInactive) return Response(400, "400 Channel Inactive");
     if (error == speaker::AE_IncompatibleTrack) return Response(400, "400 Incompatible Track");
     if (error == speaker::AE_ChannelNotFound) return Response(404, "404 Channel Not Found");
+    if (error == speaker::AE_ChannelExists) return Response(409, "409 Channel Exists");
     std::unreachable();
 }
 
+auto WebServer::BindRejection(const Rejection& rejection) noexcept -> httplib::Response
+{
+    auto r = rejection.Reason == RR_Throttled ? Response(429, "429 Too Many Requests") : Response(503, "503 Overloaded");
+    r.set_header("Retry-After", std::to_string(std::max<time_t>((rejection.RetryAfter + 999) / 1000, 1)));
+    return r;
+}
+
 auto WebServer::BindState(speaker::ChannelState state) noexcept -> httplib::Response
 {
     if (state == speaker::CS_Closed) return Response(200, "Closed");
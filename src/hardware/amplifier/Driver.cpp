@@ -17,6 +17,21 @@ auto Driver::Enqueue(uint channel, const audio::Track& track) -> std::expected<s
     });
 }
 
+auto Driver::Stream(uint channel, const SDL_AudioSpec& format, const std::optional<audio::JitterConfig>& jitter) -> std::expected<std::shared_ptr<audio::LiveStream>, ActionError>
+{
+    std::lock_guard _ { DeviceStateLock_ };
+    return ActionWrapper(channel).and_then([&]() -> std::expected<std::shared_ptr<audio::LiveStream>, ActionError>
+    {
+        auto stream = DoStream(channel, format, jitter);
+        if (!stream)
+        {
+            return std::unexpected { AE_IncompatibleTrack };
+        }
+
+        return stream;
+    });
+}
+
 auto Driver::Skip(uint channel) noexcept -> std::expected<void, ActionError>
 {
     std::lock_guard _ { DeviceStateLock_ };
@@ -46,6 +61,39 @@ auto Driver::DurationLeft(uint channel) const noexcept -> std::expected<time_t,
     });
 }
 
+auto Driver::QueueLeft(uint channel) const noexcept -> std::expected<std::pair<size_t, time_t>, ActionError>
+{
+    std::lock_guard _ { DeviceStateLock_ };
+    return ActionWrapper(channel).and_then([&]() -> std::expected<std::pair<size_t, time_t>, ActionError>
+    {
+        return DoQueueLeft(channel);
+    });
+}
+
+void Driver::SetGain(uint channel, double db) noexcept
+{
+    std::lock_guard _ { DeviceStateLock_ };
+    DoSetGain(channel, db);
+}
+
+auto Driver::Gain(uint channel) const noexcept -> double
+{
+    std::lock_guard _ { DeviceStateLock_ };
+    return DoGain(channel);
+}
+
+void Driver::SetPreemption(uint channel, audio::PreemptPolicy policy) noexcept
+{
+    std::lock_guard _ { DeviceStateLock_ };
+    DoSetPreemption(channel, policy);
+}
+
+auto Driver::Preemption(uint channel) const noexcept -> audio::PreemptPolicy
+{
+    std::lock_guard _ { DeviceStateLock_ };
+    return DoPreemption(channel);
+}
+
 auto Driver::StartUp(bool urgently) noexcept -> std::future<void>
 {
     std::lock_guard _ { DeviceStateLock_ };
@@ -70,6 +118,7 @@ auto Driver::ShutDown(bool urgently) noexcept -> std::future<void>
 
 auto Driver::Open(uint channel) noexcept -> bool
 {
+    std::lock_guard _ { DeviceStateLock_ };
     if (!OpenedChannels_[channel])
     {
         DoOpen(channel);
@@ -82,6 +131,7 @@ auto Driver::Open(uint channel) noexcept -> bool
 
 auto Driver::Close(uint channel) noexcept -> bool
 {
+    std::lock_guard _ { DeviceStateLock_ };
     if (OpenedChannels_[channel])
     {
         DoClose(channel);
@@ -94,14 +144,43 @@ auto Driver::Close(uint channel) noexcept -> bool
 
 auto Driver::Opened(uint channel) const noexcept -> bool
 {
+    std::lock_guard _ { DeviceStateLock_ };
     return OpenedChannels_[channel];
 }
 
 auto Driver::Channels() const noexcept -> size_t
 {
+    std::lock_guard _ { DeviceStateLock_ };
     return Channels_;
 }
 
+void Driver::Remap(const std::vector<std::optional<uint>>& mapping) noexcept
+{
+    std::lock_guard _ { DeviceStateLock_ };
+    {
+        std::vector<bool> kept(Channels_);
+        for (const auto& source : mapping)
+        {
+            if (source) kept[*source] = true;
+        }
+
+        for (uint i = 0; i < Channels_; ++i)
+        {
+            if (!kept[i]) Close(i);
+        }
+
+        std::vector<bool> opened(mapping.size());
+        for (uint i = 0; i < mapping.size(); ++i)
+        {
+            opened[i] = mapping[i] && OpenedChannels_[*mapping[i]];
+        }
+
+        DoRemap(mapping);
+        OpenedChannels_ = std::move(opened);
+        Channels_ = mapping.size();
+    }
+}
+
 auto Driver::Ready() const noexcept -> bool
 {
     return Working_;
@@ -109,11 +188,12 @@ auto Driver::Ready() const noexcept -> bool
 
 auto Driver::StartupDuration(bool urgently) const noexcept -> time_t
 {
-    return urgently ? UrgentStartupDuration_ : StartupDuration_;
+    return DoStartupDuration(urgently);
 }
 
 auto Driver::ShutdownDuration(bool urgently) const noexcept -> time_t
 {
+    std::lock_guard _ { DeviceStateLock_ };
     return urgently ? UrgentShutdownDuration_ : ShutdownDuration_;
 }
 
@@ -122,46 +202,61 @@ Driver::Driver(const Config& config) noexcept
       UrgentStartupDuration_(config.UrgentStartupDuration), UrgentShutdownDuration_(config.UrgentShutdownDuration),
       TickInterval_(config.TickInterval), Channels_(config.Channels)
 {
-    OpenedChannels_ = std::vector<std::atomic<bool>>(config.Channels);
-    Mainloop_ = std::jthread { [&](const auto& token)
+    OpenedChannels_ = std::vector<bool>(config.Channels);
+    StateChangeStart_ = utils::Time::Now();
+    Mainloop_ = utils::Time::Schedule([this]
     {
-        Mainloop(token);
-    }};
+        return Mainloop();
+    });
 }
 
-void Driver::Mainloop(const std::stop_token& token) noexcept
+void Driver::Reconfigure(const Config& config) noexcept
 {
-    auto startTime = utils::Time::Now();
-    while (!token.stop_requested())
+    std::lock_guard _ { DeviceStateLock_ };
     {
-        std::unique_lock _ { DeviceStateLock_ };
-        auto time = utils::Time::Now();
+        StartupDuration_ = config.StartupDuration;
+        ShutdownDuration_ = config.ShutdownDuration;
+        UrgentStartupDuration_ = config.UrgentStartupDuration;
+        UrgentShutdownDuration_ = config.UrgentShutdownDuration;
+        TickInterval_ = config.TickInterval;
+    }
+}
 
-        // Resolve StartUp/ShutDown calls when the device is already active/inactive.
-        FulfillListeners(Working_ ? ActivationListeners_ : DeactivationListeners_);
+auto Driver::DoStartupDuration(bool urgently) const noexcept -> time_t
+{
+    std::lock_guard _ { DeviceStateLock_ };
+    return urgently ? UrgentStartupDuration_ : StartupDuration_;
+}
 
-        if (Working_ != DesiredWorking_)
+auto Driver::Mainloop() noexcept -> time_t
+{
+    utils::Realtime::Enter(utils::TR_Mainloop);
+    std::lock_guard _ { DeviceStateLock_ };
+    auto time = utils::Time::Now();
+
+    // Resolve StartUp/ShutDown calls when the device is already active/inactive.
+    FulfillListeners(Working_ ? ActivationListeners_ : DeactivationListeners_);
+
+    if (Working_ != DesiredWorking_)
+    {
+        if (DesiredWorking_ && DoActivation(time, time - StateChangeStart_, UrgentStateChange_))
         {
-            if (DesiredWorking_ && DoActivation(time, time - startTime, UrgentStateChange_))
-            {
-                Working_ = true;
-                FulfillListeners(ActivationListeners_);
-            }
-
-            if (!DesiredWorking_ && DoDeactivation(time, time - startTime, UrgentStateChange_))
-            {
-                Working_ = false;
-                FulfillListeners(DeactivationListeners_);
-            }
+            Working_ = true;
+            FulfillListeners(ActivationListeners_);
         }
-        else
+
+        if (!DesiredWorking_ && DoDeactivation(time, time - StateChangeStart_, UrgentStateChange_))
         {
-            startTime = time;
+            Working_ = false;
+            FulfillListeners(DeactivationListeners_);
         }
-
-        _.unlock();
-        std::this_thread::sleep_for(std::chrono::milliseconds { TickInterval_ });
     }
+    else
+    {
+        StateChangeStart_ = time;
+    }
+
+    return TickInterval_;
 }
 
 auto Driver::ActionWrapper(uint channel) const noexcept -> std::expected<void, ActionError>
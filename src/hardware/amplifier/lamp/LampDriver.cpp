@@ -4,13 +4,18 @@ using namespace ml::amplifier;
 
 auto LampDriver::Create(const LampConfig& cfg) noexcept -> std::shared_ptr<LampDriver>
 {
-    auto relay = relay::Driver::Create(cfg.PowerPort);
-    if (!relay)
+    if (!cfg.PowerRelay || !cfg.AudioOutput || !cfg.AudioPool)
     {
         return nullptr;
     }
 
-    auto mixer = audio::ChannelsMixer::Create(cfg.Channels, cfg.AudioDevice);
+    auto thermal = ThermalModel::Create(cfg.Thermal, cfg.WarmingDuration, cfg.CoolingDuration, cfg.ThermalThreshold);
+    if (!thermal)
+    {
+        return nullptr;
+    }
+
+    auto mixer = audio::ChannelsMixer::Create(cfg.Channels, cfg.AudioOutput, cfg.AudioFormat, cfg.AudioPool, cfg.Blending);
     if (!mixer)
     {
         return nullptr;
@@ -21,22 +26,67 @@ auto LampDriver::Create(const LampConfig& cfg) noexcept -> std::shared_ptr<LampD
         .UrgentStartupDuration = 0,
         .ShutdownDuration = 0,
         .UrgentShutdownDuration = 0,
-        .TickInterval = 20,
+        .TickInterval = cfg.TickInterval,
         .Channels = cfg.Channels
     }};
 
-    driver->PowerRelay_ = relay;
+    driver->PowerRelay_ = cfg.PowerRelay;
     driver->Mixer_ = mixer;
-    driver->CoolingDuration_ = cfg.CoolingDuration;
+    driver->Thermal_ = thermal;
 
     return std::shared_ptr<LampDriver>(driver);
 }
 
+auto LampDriver::Reconfigure(const LampConfig& cfg) noexcept -> bool
+{
+    bool applied = true;
+
+    std::lock_guard _ { DeviceStateLock_ };
+    {
+        Driver::Reconfigure(Config {
+            .StartupDuration = cfg.WarmingDuration,
+            .UrgentStartupDuration = 0,
+            .ShutdownDuration = 0,
+            .UrgentShutdownDuration = 0,
+            .TickInterval = cfg.TickInterval,
+            .Channels = (uint)Channels()
+        });
+
+        applied &= Thermal_->Reconfigure(cfg.Thermal, cfg.WarmingDuration, cfg.CoolingDuration, cfg.ThermalThreshold, utils::Time::Now());
+
+        if (cfg.PowerRelay && cfg.PowerRelay != PowerRelay_)
+        {
+            PowerRelay_->Closed() ? cfg.PowerRelay->Close() : cfg.PowerRelay->Open();
+            PowerRelay_ = cfg.PowerRelay;
+        }
+
+        Mixer_->SetBlending(cfg.Blending);
+
+        if (cfg.AudioOutput)
+        {
+            applied &= Mixer_->Rebind(cfg.AudioOutput);
+        }
+
+        return applied;
+    }
+}
+
+auto LampDriver::Spec() const noexcept -> SDL_AudioSpec
+{
+    return Mixer_->Spec();
+}
+
 auto LampDriver::DoEnqueue(uint channel, const ml::audio::Track& track) -> std::optional<std::future<void>>
 {
     return Mixer_->Enqueue(channel, track);
 }
 
+auto LampDriver::DoStream(uint channel, const SDL_AudioSpec& format, const std::optional<ml::audio::JitterConfig>& jitter)
+    -> std::shared_ptr<ml::audio::LiveStream>
+{
+    return Mixer_->Stream(channel, format, jitter);
+}
+
 void LampDriver::DoSkip(uint channel) noexcept
 {
     Mixer_->Skip(channel);
@@ -52,6 +102,31 @@ auto LampDriver::DoDurationLeft(uint channel) const noexcept -> time_t
     return Mixer_->DurationLeft(channel);
 }
 
+auto LampDriver::DoQueueLeft(uint channel) const noexcept -> std::pair<size_t, time_t>
+{
+    return Mixer_->QueueLeft(channel);
+}
+
+void LampDriver::DoSetGain(uint channel, double db) noexcept
+{
+    Mixer_->SetGain(channel, db);
+}
+
+auto LampDriver::DoGain(uint channel) const noexcept -> double
+{
+    return Mixer_->Gain(channel);
+}
+
+void LampDriver::DoSetPreemption(uint channel, ml::audio::PreemptPolicy policy) noexcept
+{
+    Mixer_->SetPreemption(channel, policy);
+}
+
+auto LampDriver::DoPreemption(uint channel) const noexcept -> ml::audio::PreemptPolicy
+{
+    return Mixer_->Preemption(channel);
+}
+
 void LampDriver::DoOpen(uint channel) noexcept
 {
     Mixer_->Enable(channel);
@@ -63,16 +138,36 @@ void LampDriver::DoClose(uint channel) noexcept
     Mixer_->Clear(channel);
 }
 
+void LampDriver::DoRemap(const std::vector<std::optional<uint>>& mapping) noexcept
+{
+    Mixer_->Remap(mapping);
+}
+
 bool LampDriver::DoActivation(time_t time, time_t elapsed, bool urgently) noexcept
 {
-    PowerRelay_->Close();
-    return elapsed >= StartupDuration(urgently) || (time - DeactivatedAt_ < CoolingDuration_);
+    if (!PowerRelay_->Closed())
+    {
+        PowerRelay_->Close();
+        Thermal_->PowerOn(time);
+    }
+
+    return (urgently && elapsed >= Driver::DoStartupDuration(true)) || Thermal_->Remaining(time) == 0;
 }
 
 bool LampDriver::DoDeactivation(time_t time, time_t elapsed, bool urgently) noexcept
 {
     Mixer_->ClearAll();
-    PowerRelay_->Open();
-    DeactivatedAt_ = time;
+
+    if (PowerRelay_->Closed())
+    {
+        PowerRelay_->Open();
+        Thermal_->PowerOff(time);
+    }
+
     return true;
 }
+
+auto LampDriver::DoStartupDuration(bool urgently) const noexcept -> time_t
+{
+    return urgently ? Driver::DoStartupDuration(true) : Thermal_->Remaining(utils::Time::Now());
+}
@@ -0,0 +1,111 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/amplifier/lamp/ThermalModel.h"
+
+#include <algorithm>
+#include <cmath>
+using namespace ml::amplifier;
+
+auto ThermalModel::Create(ThermalCurve curve, time_t warming, time_t cooling, double threshold) noexcept
+    -> std::shared_ptr<ThermalModel>
+{
+    if (threshold <= 0 || threshold >= 1)
+    {
+        return nullptr;
+    }
+
+    auto model = std::make_shared<ThermalModel>();
+    model->Curve_ = curve;
+    model->WarmingDuration_ = warming;
+    model->CoolingDuration_ = cooling;
+    model->Threshold_ = threshold;
+
+    return model;
+}
+
+void ThermalModel::PowerOn(time_t time) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        Level_ = LevelAt(time);
+        Powered_ = true;
+        Since_ = time;
+    }
+}
+
+void ThermalModel::PowerOff(time_t time) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        Level_ = LevelAt(time);
+        Powered_ = false;
+        Since_ = time;
+    }
+}
+
+auto ThermalModel::Reconfigure(ThermalCurve curve, time_t warming, time_t cooling, double threshold, time_t time) noexcept
+    -> bool
+{
+    if (threshold <= 0 || threshold >= 1)
+    {
+        return false;
+    }
+
+    std::lock_guard _ { Lock_ };
+    {
+        // The binary curve counts the warm-up from the power-on, so keep its history unless the curve changes
+        if (curve != Curve_)
+        {
+            Level_ = LevelAt(time);
+            Since_ = time;
+        }
+
+        Curve_ = curve;
+        WarmingDuration_ = warming;
+        CoolingDuration_ = cooling;
+        Threshold_ = threshold;
+        return true;
+    }
+}
+
+auto ThermalModel::Remaining(time_t time) const noexcept -> time_t
+{
+    std::lock_guard _ { Lock_ };
+    {
+        double level = LevelAt(time);
+        if (level >= Threshold_ || WarmingDuration_ <= 0)
+        {
+            return 0;
+        }
+
+        if (Curve_ == TC_Binary)
+        {
+            return Powered_ ? std::max<time_t>(WarmingDuration_ - (time - Since_), 0) : WarmingDuration_;
+        }
+
+        // Invert the heating curve: 1 - level(t) = (1 - level) * exp(-t / tau)
+        double tau = WarmingDuration_ / -std::log(1 - Threshold_);
+        return (time_t)std::ceil(tau * std::log((1 - level) / (1 - Threshold_)));
+    }
+}
+
+auto ThermalModel::LevelAt(time_t time) const noexcept -> double
+{
+    auto elapsed = (double)std::max<time_t>(time - Since_, 0);
+
+    if (Curve_ == TC_Binary)
+    {
+        if (Powered_) return Level_ >= 1 || elapsed >= (double)WarmingDuration_ ? 1 : 0;
+        return Level_ >= 1 && elapsed < (double)CoolingDuration_ ? 1 : 0;
+    }
+
+    if (Powered_)
+    {
+        if (WarmingDuration_ <= 0) return 1;
+        double tau = WarmingDuration_ / -std::log(1 - Threshold_);
+        return 1 - (1 - Level_) * std::exp(-elapsed / tau);
+    }
+
+    if (CoolingDuration_ <= 0) return elapsed > 0 ? 0 : Level_;
+    double tau = CoolingDuration_ / -std::log(Threshold_);
+    return Level_ * std::exp(-elapsed / tau);
+}
@@ -2,33 +2,78 @@
 #include "hardware/audio/ChannelsMixer.h"
 using namespace ml::audio;
 
-auto ChannelsMixer::Create(uint channels, const std::optional<std::string> &audioDevice)
-    -> std::shared_ptr<ChannelsMixer>
+namespace
 {
+    constexpr size_t BlockSize = 256; // samples summed at once, so the sum stays in L1 while all the channels are added
+    constexpr size_t WordBits = 64;
+
+    auto ToLinear(double db) noexcept -> float
+    {
+        return (float)std::pow(10.0, db / 20);
+    }
+}
+
+auto ChannelsMixer::Create(uint channels, const std::shared_ptr<Backend>& output, const SDL_AudioSpec& format, const std::shared_ptr<PagePool>& pool,
+    const BlendConfig& blending) -> std::shared_ptr<ChannelsMixer>
+{
+    // Create the mixer first ( because we need its address in audio-supplier callback )
+    auto mixer = std::make_shared<ChannelsMixer>();
+
+    // Request the canonical format, the tracks are decoded right into it
+    SDL_AudioSpec desired = {};
+    desired.freq = format.freq;
+    desired.format = format.format;
+    desired.channels = format.channels;
+    desired.samples = 4096;
+    desired.callback = &ChannelsMixer::AudioSupplier;
+    desired.userdata = mixer.get();
+
+    auto spec = output->Open(desired);
+    if (!spec)
+    {
+        return nullptr;
+    }
+
     auto players = std::vector<std::shared_ptr<Player>>(channels);
     for (auto& player : players)
     {
-        player = Player::Create(audioDevice);
-        if (!player)
-        {
-            return nullptr;
-        }
-
+        player = Player::Create(*spec, pool);
         player->Resume();
     }
 
-    auto player = std::make_shared<ChannelsMixer>();
-    player->Channels_ = players;
-    player->EnabledChannels_.resize(channels, false);
-    player->MutedChannels_.resize(channels, false);
+    mixer->Output_ = output;
+    mixer->Pool_ = pool;
+    mixer->Spec_ = *spec;
+    mixer->Channels_ = players;
+    mixer->EnabledChannels_.resize((channels + WordBits - 1) / WordBits, 0);
+    mixer->MutedChannels_.resize(channels, false);
+    mixer->Gains_.resize(channels, 0);
+    mixer->Policies_.resize(channels, PP_Mute);
+    mixer->Lanes_.resize(channels);
+    mixer->Blending_ = blending;
+
+    for (auto& lane : mixer->Lanes_)
+    {
+        lane.Rendered.resize(spec->size);
+    }
+
+    mixer->SelectChannel(); // reset everything to the initial state
+    output->Start();
 
-    player->SelectChannel(); // reset everything to the initial state
+    return mixer;
+}
 
-    return player;
+ChannelsMixer::~ChannelsMixer()
+{
+    if (Output_)
+    {
+        Output_->Close();
+    }
 }
 
 void ChannelsMixer::Pause() noexcept
 {
+    std::lock_guard _ { ChannelsStatesLock_ };
     for (auto& channel : Channels_)
     {
         channel->Pause();
@@ -37,6 +82,7 @@ void ChannelsMixer::Pause() noexcept
 
 void ChannelsMixer::Resume() noexcept
 {
+    std::lock_guard _ { ChannelsStatesLock_ };
     for (auto& channel : Channels_)
     {
         channel->Resume();
@@ -45,6 +91,7 @@ void ChannelsMixer::Resume() noexcept
 
 void ChannelsMixer::ClearAll() noexcept
 {
+    std::lock_guard _ { ChannelsStatesLock_ };
     for (auto& channel : Channels_)
     {
         channel->Clear();
@@ -53,17 +100,24 @@ void ChannelsMixer::ClearAll() noexcept
 
 auto ChannelsMixer::Enqueue(uint channel, const Track& audio) noexcept -> std::optional<std::future<void>>
 {
-    return Channels_[channel]->Enqueue(audio);
+    // Resampling is slow, so it's done outside the lock to not block the output
+    return Channel(channel)->Enqueue(audio);
+}
+
+auto ChannelsMixer::Stream(uint channel, const SDL_AudioSpec& format, const std::optional<JitterConfig>& jitter) noexcept
+    -> std::shared_ptr<LiveStream>
+{
+    return LiveStream::Create(Channel(channel), format, jitter);
 }
 
 void ChannelsMixer::Clear(uint channel) noexcept
 {
-    Channels_[channel]->Clear();
+    Channel(channel)->Clear();
 }
 
 void ChannelsMixer::Skip(uint channel) noexcept
 {
-    Channels_[channel]->Skip();
+    Channel(channel)->Skip();
 }
 
 void ChannelsMixer::Enable(uint channel) noexcept
@@ -78,12 +132,12 @@ void ChannelsMixer::Disable(uint channel) noexcept
 
 void ChannelsMixer::Pause(uint channel) noexcept
 {
-    Channels_[channel]->Pause();
+    Channel(channel)->Pause();
 }
 
 void ChannelsMixer::Resume(uint channel) noexcept
 {
-    Channels_[channel]->Resume();
+    Channel(channel)->Resume();
 }
 
 void ChannelsMixer::Mute(uint channel) noexcept
@@ -96,29 +150,72 @@ void ChannelsMixer::Unmute(uint channel) noexcept
     UpdateChannel(channel, std::nullopt, false);
 }
 
+void ChannelsMixer::SetGain(uint channel, double db) noexcept
+{
+    std::lock_guard _ { ChannelsStatesLock_ };
+    Gains_[channel] = db;
+}
+
+auto ChannelsMixer::Gain(uint channel) const noexcept -> double
+{
+    std::lock_guard _ { ChannelsStatesLock_ };
+    return Gains_[channel];
+}
+
+void ChannelsMixer::SetPreemption(uint channel, PreemptPolicy policy) noexcept
+{
+    std::lock_guard _ { ChannelsStatesLock_ };
+    {
+        Policies_[channel] = policy;
+        Apply(channel);
+    }
+}
+
+auto ChannelsMixer::Preemption(uint channel) const noexcept -> PreemptPolicy
+{
+    std::lock_guard _ { ChannelsStatesLock_ };
+    return Policies_[channel];
+}
+
+void ChannelsMixer::SetBlending(const BlendConfig& blending) noexcept
+{
+    std::lock_guard _ { ChannelsStatesLock_ };
+    {
+        Blending_ = blending;
+        SelectChannel();
+    }
+}
+
 auto ChannelsMixer::Enabled(uint channel) const noexcept -> bool
 {
     std::lock_guard _ { ChannelsStatesLock_ };
-    return EnabledChannels_[channel];
+    return IsEnabled(channel);
 }
 
 auto ChannelsMixer::Paused(uint channel) const noexcept -> bool
 {
-    return Channels_[channel]->Paused();
+    return Channel(channel)->Paused();
 }
 
 auto ChannelsMixer::Muted(uint channel) const noexcept -> bool
 {
-    return Channels_[channel]->Muted();
+    return Channel(channel)->Muted();
 }
 
 auto ChannelsMixer::DurationLeft(uint channel) const noexcept -> time_t
 {
-    return Channels_[channel]->DurationLeft();
+    return Channel(channel)->DurationLeft();
+}
+
+auto ChannelsMixer::QueueLeft(uint channel) const noexcept -> std::pair<size_t, time_t>
+{
+    return Channel(channel)->QueueLeft();
 }
 
 auto ChannelsMixer::DurationLeft() const noexcept -> time_t
 {
+    std::lock_guard _ { ChannelsStatesLock_ };
+
     time_t longest = 0;
     for (const auto& channel : Channels_)
     {
@@ -132,47 +229,352 @@ auto ChannelsMixer::CountEnabled() const noexcept -> size_t
 {
     std::lock_guard _ { ChannelsStatesLock_ };
     {
-        return std::count(EnabledChannels_.begin(), EnabledChannels_.end(), true);
+        size_t count = 0;
+        for (auto word : EnabledChannels_) count += std::popcount(word);
+        return count;
     }
 }
 
 auto ChannelsMixer::Channels() const noexcept -> size_t
 {
+    std::lock_guard _ { ChannelsStatesLock_ };
     return Channels_.size();
 }
 
-void ChannelsMixer::UpdateChannel(size_t channel, std::optional<bool> enabled, std::optional<bool> muted) noexcept
+auto ChannelsMixer::Spec() const noexcept -> SDL_AudioSpec
 {
     std::lock_guard _ { ChannelsStatesLock_ };
+    return Spec_;
+}
+
+void ChannelsMixer::Remap(const std::vector<std::optional<uint>>& mapping) noexcept
+{
+    auto players = std::vector<std::shared_ptr<Player>>(mapping.size());
+    std::vector<uint64_t> enabled((mapping.size() + WordBits - 1) / WordBits);
+    std::vector<bool> muted(mapping.size());
+    std::vector<double> gains(mapping.size());
+    std::vector<PreemptPolicy> policies(mapping.size(), PP_Mute);
+    std::vector<Lane> lanes(mapping.size());
+
+    // Swapped out players are cleared after the lock is released, the live streams may still hold them
+    auto dropped = std::vector<std::shared_ptr<Player>> {};
+
+    // The new channels are allocated before the lock is taken, so the output never waits for the allocator
+    for (size_t i = 0; i < mapping.size(); ++i)
     {
-        if (enabled) EnabledChannels_[channel] = *enabled;
-        if (muted) MutedChannels_[channel] = *muted;
+        if (!mapping[i])
+        {
+            players[i] = Player::Create(Spec_, Pool_);
+            players[i]->Resume();
+            lanes[i].Rendered.resize(Spec_.size);
+        }
+    }
+
+    std::unique_lock lock { ChannelsStatesLock_ };
+    {
+        // The kept channels are only moved, their lanes are already sized
+        for (size_t i = 0; i < mapping.size(); ++i)
+        {
+            if (mapping[i])
+            {
+                players[i] = Channels_[*mapping[i]];
+                enabled[i / WordBits] |= (uint64_t)IsEnabled(*mapping[i]) << i % WordBits;
+                muted[i] = MutedChannels_[*mapping[i]];
+                gains[i] = Gains_[*mapping[i]];
+                policies[i] = Policies_[*mapping[i]];
+                lanes[i] = std::move(Lanes_[*mapping[i]]);
+            }
+        }
+
+        dropped = std::exchange(Channels_, std::move(players));
+        std::erase_if(dropped, [&](const auto& player) { return std::ranges::find(Channels_, player) != Channels_.end(); });
+
+        EnabledChannels_ = std::move(enabled);
+        MutedChannels_ = std::move(muted);
+        Gains_ = std::move(gains);
+        Policies_ = std::move(policies);
+        Lanes_ = std::move(lanes);
 
         SelectChannel();
     }
+    lock.unlock();
+
+    // Resolves the listeners of the dropped queues and makes the feeds of their live streams fail
+    for (auto& player : dropped)
+    {
+        player->Clear();
+    }
 }
 
-void ChannelsMixer::SelectChannel() noexcept
+auto ChannelsMixer::Rebind(const std::shared_ptr<Backend>& output) noexcept -> bool
+{
+    if (output == Output_)
+    {
+        return true;
+    }
+
+    // The queues are already converted to the current spec, so the new output must accept it as is
+    SDL_AudioSpec desired = Spec_;
+    desired.callback = &ChannelsMixer::AudioSupplier;
+    desired.userdata = this;
+
+    auto spec = output->Open(desired);
+    if (!spec || !Utils::SameFormat(*spec, Spec_))
+    {
+        if (spec) output->Close();
+        return false;
+    }
+
+    Output_->Close();
+
+    std::lock_guard _ { ChannelsStatesLock_ };
+    {
+        Output_ = output;
+        Spec_ = *spec;
+        LastSupply_ = {};
+    }
+
+    output->Start();
+    return true;
+}
+
+auto ChannelsMixer::Channel(uint channel) const noexcept -> std::shared_ptr<Player>
 {
     std::lock_guard _ { ChannelsStatesLock_ };
+    return Channels_[channel];
+}
+
+void ChannelsMixer::AudioSupplier(void* userdata, uint8_t* stream, int len) noexcept
+{
+    static auto& underruns = utils::Metrics::Counter("audio_underruns");
+    auto* self = (ChannelsMixer*)userdata;
+
+    // The thread is owned by the backend, so it takes its scheduling here
+    utils::Realtime::Enter(utils::TR_Audio);
+    std::lock_guard _ { self->ChannelsStatesLock_ };
+
+    // Each call consumes one buffer of the device, so if the gap is longer than two buffers the device starved
+    auto now = std::chrono::steady_clock::now();
+    auto buffer = std::chrono::microseconds { 1'000'000ll * self->Spec_.samples / self->Spec_.freq };
+
+    if (self->LastSupply_ != std::chrono::steady_clock::time_point {} && now - self->LastSupply_ > 2*buffer)
     {
-        // Mute all the channels except the first enabled one
-        bool found = false;
-        for (size_t i : std::views::iota(0ull, Channels_.size()) | std::views::reverse)
+        ++underruns;
+    }
+
+    self->LastSupply_ = now;
+
+    // Empty the buffer ( required by SDL docs )
+    SDL_memset(stream, self->Spec_.silence, len);
+    self->Blend(stream, len);
+}
+
+void ChannelsMixer::Blend(uint8_t* stream, size_t len) noexcept
+{
+    // Render each channel separately, the buffers grow only when the output asks for more than it has promised
+    bool any = false;
+    for (size_t i = 0; i < Channels_.size(); ++i)
+    {
+        auto& lane = Lanes_[i];
+        if (lane.Rendered.size() < len)
         {
-            if (EnabledChannels_[i] && !found)
+            lane.Rendered.resize(len);
+        }
+
+        SDL_memset(lane.Rendered.data(), Spec_.silence, len);
+        lane.Active = Channels_[i]->Supply(lane.Rendered.data(), (int)len) > 0;
+        any |= lane.Active;
+    }
+
+    if (!any)
+    {
+        return;
+    }
+
+    // Walk down from the highest priority, each active channel ducks everything below it
+    size_t samples = len / (SDL_AUDIO_BITSIZE(Spec_.format) / 8);
+    size_t frames = samples / std::max<uint8_t>(Spec_.channels, 1);
+    bool ducked = false;
+
+    for (size_t i : std::views::iota(0ull, Channels_.size()) | std::views::reverse)
+    {
+        auto& lane = Lanes_[i];
+        auto target = ToLinear(Gains_[i] - (ducked ? Blending_.DuckDepth : 0));
+
+        // The silent channel jumps to its target, there is nothing to click
+        lane.Step = lane.Active ? (Ramp(lane.Level, target, frames) - lane.Level) / (float)samples : 0;
+        lane.Level = lane.Active ? lane.Level : target;
+
+        ducked |= lane.Active && Blending_.Mode == BM_Ducking;
+    }
+
+    switch (Spec_.format)
+    {
+        case AUDIO_U8: MixAs<uint8_t>(stream, len); break;
+        case AUDIO_S16SYS: MixAs<int16_t>(stream, len); break;
+        case AUDIO_S32SYS: MixAs<int32_t>(stream, len); break;
+        case AUDIO_F32SYS: MixAs<float>(stream, len); break;
+
+        default:
+            // Exotic formats are mixed by SDL without the ramps
+            for (auto& lane : Lanes_)
             {
-                if (!MutedChannels_[i])
+                if (lane.Active)
                 {
-                    Channels_[i]->Unmute();
+                    lane.Level += lane.Step * (float)samples;
+                    auto volume = (int)std::clamp(lane.Level * SDL_MIX_MAXVOLUME, 0.f, (float)SDL_MIX_MAXVOLUME);
+                    SDL_MixAudioFormat(stream, lane.Rendered.data(), Spec_.format, (Uint32)len, volume);
                 }
+            }
+    }
+}
 
-                found = true;
+template <typename T>
+void ChannelsMixer::MixAs(uint8_t* stream, size_t len) noexcept
+{
+    auto* out = (T*)stream;
+    size_t samples = len / sizeof(T);
+    float sum[BlockSize];
+
+    // The lone channel at the unity gain is copied as is, so it stays bit-exact
+    auto active = std::ranges::count_if(Lanes_, [](const auto& lane) { return lane.Active; });
+    auto lone = std::ranges::find_if(Lanes_, [](const auto& lane) { return lane.Active; });
+
+    if (active == 1 && lone->Level == 1 && lone->Step == 0)
+    {
+        std::memcpy(stream, lone->Rendered.data(), len);
+        return;
+    }
+
+    // One pass over the output, the block of the sum is kept hot while every active channel is added into it.
+    // The inner loops are plain float arithmetics over the contiguous arrays, so they are vectorized by the compiler.
+    for (size_t base = 0; base < samples; base += BlockSize)
+    {
+        size_t count = std::min(BlockSize, samples - base);
+        std::fill_n(sum, count, 0.f);
+
+        for (const auto& lane : Lanes_)
+        {
+            if (!lane.Active)
+            {
+                continue;
             }
-            else
+
+            const auto* __restrict in = (const T*)lane.Rendered.data() + base;
+            float level = lane.Level + lane.Step * (float)base;
+            float step = lane.Step;
+
+            // The index is signed, so its conversion to float is vectorized as well
+            for (int i = 0; i < (int)count; ++i)
             {
-                Channels_[i]->Mute();
+                sum[i] += Utils::ToFloat(in[i]) * (level + step * (float)i);
             }
         }
+
+        for (int i = 0; i < (int)count; ++i)
+        {
+            out[base + i] = Utils::FromFloat<T>(sum[i]);
+        }
+    }
+
+    for (auto& lane : Lanes_)
+    {
+        lane.Level += lane.Active ? lane.Step * (float)samples : 0;
     }
 }
+
+auto ChannelsMixer::Ramp(float level, float target, size_t frames) const noexcept -> float
+{
+    // The full scale ( 0..1 ) is passed in the attack time when fading out and in the release time when fading in
+    auto duration = target < level ? Blending_.DuckAttack : Blending_.DuckRelease;
+    if (duration <= 0)
+    {
+        return target;
+    }
+
+    auto delta = (float)frames * 1000 / ((float)duration * (float)Spec_.freq);
+    return target < level ? std::max(target, level - delta) : std::min(target, level + delta);
+}
+
+void ChannelsMixer::UpdateChannel(size_t channel, std::optional<bool> enabled, std::optional<bool> muted) noexcept
+{
+    std::lock_guard _ { ChannelsStatesLock_ };
+    {
+        if (enabled)
+        {
+            auto& word = EnabledChannels_[channel / WordBits];
+            auto bit = (uint64_t)1 << channel % WordBits;
+            word = *enabled ? word | bit : word & ~bit;
+        }
+
+        if (muted) MutedChannels_[channel] = *muted;
+        Reselect(channel);
+    }
+}
+
+auto ChannelsMixer::IsEnabled(size_t channel) const noexcept -> bool
+{
+    return EnabledChannels_[channel / WordBits] >> channel % WordBits & 1;
+}
+
+auto ChannelsMixer::HighestEnabled() const noexcept -> std::optional<size_t>
+{
+    for (size_t i : std::views::iota(0ull, EnabledChannels_.size()) | std::views::reverse)
+    {
+        if (EnabledChannels_[i])
+        {
+            return i * WordBits + WordBits - 1 - std::countl_zero(EnabledChannels_[i]);
+        }
+    }
+
+    return std::nullopt;
+}
+
+void ChannelsMixer::Reselect(size_t changed) noexcept
+{
+    auto selected = HighestEnabled();
+    auto previous = std::exchange(Selected_, selected);
+
+    // In the exclusive mode the audibility depends on the selected channel, so only the channels between the old and the new one change.
+    // The muted ones in the middle stay muted, only the paused ones are preempted or restored.
+    if (Blending_.Mode == BM_Exclusive && selected != previous)
+    {
+        size_t low = selected && previous ? std::min(*selected, *previous) : 0;
+        size_t high = std::max(selected.value_or(0), previous.value_or(0));
+
+        for (size_t i = low; i <= high; ++i)
+        {
+            if (i == selected || i == previous || Policies_[i] == PP_Pause)
+            {
+                Apply(i);
+            }
+        }
+    }
+
+    Apply(changed);
+}
+
+void ChannelsMixer::SelectChannel() noexcept
+{
+    std::lock_guard _ { ChannelsStatesLock_ };
+    {
+        Selected_ = HighestEnabled();
+        for (size_t i = 0; i < Channels_.size(); ++i)
+        {
+            Apply(i);
+        }
+    }
+}
+
+void ChannelsMixer::Apply(size_t channel) noexcept
+{
+    // Ducking mixes all the enabled channels, the levels are handled by the audio callback.
+    // Exclusive mode mutes all the channels except the selected one, the preempted channels below it may be paused instead.
+    auto& player = Channels_[channel];
+    bool exclusive = Blending_.Mode == BM_Exclusive;
+    bool audible = (exclusive ? Selected_ == channel : IsEnabled(channel)) && !MutedChannels_[channel];
+    bool preempted = exclusive && Selected_ && channel < *Selected_ && Policies_[channel] == PP_Pause;
+
+    audible ? player->Unmute() : player->Mute();
+    preempted ? player->Preempt() : player->Restore();
+}
@@ -0,0 +1,215 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/ClipLibrary.h"
+using namespace ml::audio;
+
+namespace
+{
+    constexpr char BundleMagic[8] = { 'M', 'L', 'C', 'L', 'I', 'P', 'S', '2' };
+    constexpr uint64_t Alignment = 64;
+
+    struct BundleHeader
+    {
+        char Magic[8];
+        int32_t Freq;
+        uint16_t Format;
+        uint8_t Channels;
+        uint8_t Reserved;
+        uint64_t Count;
+    };
+
+    struct BundleEntry
+    {
+        char Name[64];
+        uint64_t Offset;
+        uint64_t Size;
+        double Loudness; // NaN for the silent clips
+    };
+}
+
+auto ClipLibrary::Create(const std::string& directory, const SDL_AudioSpec& spec) noexcept -> std::shared_ptr<ClipLibrary>
+{
+    std::error_code ec;
+    std::vector<std::filesystem::path> sources;
+
+    for (const auto& entry : std::filesystem::directory_iterator { directory, ec })
+    {
+        if (entry.path().extension() == ".wav" && entry.path().stem().string().size() < sizeof(BundleEntry::Name))
+        {
+            sources.push_back(entry.path());
+        }
+    }
+
+    if (ec)
+    {
+        return nullptr;
+    }
+
+    std::sort(sources.begin(), sources.end());
+
+    // Reuse the bundle when it's up-to-date, otherwise pack the clips again
+    auto bundle = std::filesystem::path { directory } / "clips.bundle";
+    if (auto library = Load(bundle, spec, sources))
+    {
+        return library;
+    }
+
+    if (!Pack(bundle, spec, sources))
+    {
+        return nullptr;
+    }
+
+    return Load(bundle, spec, sources);
+}
+
+auto ClipLibrary::Find(const std::string& name) const noexcept -> const Track*
+{
+    auto it = Clips_.find(name);
+    return it == Clips_.end() ? nullptr : &it->second;
+}
+
+auto ClipLibrary::Locate(std::span<const uint8_t> samples) const noexcept -> std::optional<std::pair<std::string, size_t>>
+{
+    // The clips are the disjoint views into the bundle, so the samples belong to one of them at most
+    std::less<const uint8_t*> less;
+    for (const auto& [name, clip] : Clips_)
+    {
+        auto buffer = clip.Buffer();
+        if (!less(samples.data(), buffer.data()) && !less(buffer.data() + buffer.size(), samples.data() + samples.size()))
+        {
+            return std::pair { name, (size_t)(samples.data() - buffer.data()) };
+        }
+    }
+
+    return std::nullopt;
+}
+
+auto ClipLibrary::Size() const noexcept -> size_t
+{
+    return Clips_.size();
+}
+
+auto ClipLibrary::Load(const std::filesystem::path& bundle, const SDL_AudioSpec& spec, const std::vector<std::filesystem::path>& sources) noexcept
+    -> std::shared_ptr<ClipLibrary>
+{
+    std::error_code ec;
+    auto packedAt = std::filesystem::last_write_time(bundle, ec);
+    if (ec)
+    {
+        return nullptr;
+    }
+
+    for (const auto& source : sources)
+    {
+        if (std::filesystem::last_write_time(source, ec) > packedAt || ec)
+        {
+            return nullptr;
+        }
+    }
+
+    auto file = utils::MappedFile::Open(bundle);
+    if (!file || file->Size() < sizeof(BundleHeader))
+    {
+        return nullptr;
+    }
+
+    // Validate the format and the list of the clips
+    auto* header = (const BundleHeader*)file->Data();
+    SDL_AudioSpec packed = spec;
+    packed.freq = header->Freq;
+    packed.format = header->Format;
+    packed.channels = header->Channels;
+
+    if (std::memcmp(header->Magic, BundleMagic, sizeof(BundleMagic)) != 0 || !Utils::SameFormat(packed, spec) ||
+        header->Count != sources.size() || file->Size() < sizeof(BundleHeader) + header->Count*sizeof(BundleEntry))
+    {
+        return nullptr;
+    }
+
+    auto library = std::make_shared<ClipLibrary>();
+    library->Bundle_ = file;
+
+    auto* entries = (const BundleEntry*)(file->Data() + sizeof(BundleHeader));
+    for (uint64_t i = 0; i < header->Count; ++i)
+    {
+        const auto& entry = entries[i];
+        bool valid = !entry.Name[sizeof(entry.Name) - 1] && entry.Name == sources[i].stem().string() &&
+            entry.Offset <= file->Size() && entry.Size <= file->Size() - entry.Offset;
+
+        if (!valid)
+        {
+            return nullptr;
+        }
+
+        Track clip { file, { file->Data() + entry.Offset, entry.Size }, packed, true };
+        clip.SetLoudness(std::isnan(entry.Loudness) ? std::nullopt : std::optional { entry.Loudness });
+
+        library->Clips_.emplace(entry.Name, std::move(clip));
+    }
+
+    return library;
+}
+
+auto ClipLibrary::Pack(const std::filesystem::path& bundle, const SDL_AudioSpec& spec, const std::vector<std::filesystem::path>& sources) noexcept
+    -> bool
+{
+    // Write into a temporary file, so the valid bundle is replaced atomically
+    auto temporary = bundle;
+    temporary += ".tmp";
+
+    std::ofstream out { temporary, std::ios::binary | std::ios::trunc };
+    std::error_code ec;
+
+    BundleHeader header {};
+    std::memcpy(header.Magic, BundleMagic, sizeof(BundleMagic));
+    header.Freq = spec.freq;
+    header.Format = spec.format;
+    header.Channels = spec.channels;
+    header.Count = sources.size();
+
+    std::vector<BundleEntry> entries(sources.size());
+    uint64_t offset = sizeof(BundleHeader) + entries.size()*sizeof(BundleEntry);
+    out.seekp((std::streamoff)offset);
+
+    // Clips are converted one by one, so only a single clip is kept in the memory
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        std::ifstream in { sources[i], std::ios::binary };
+        std::vector<char> wav { std::istreambuf_iterator<char> { in }, std::istreambuf_iterator<char> {} };
+
+        auto track = TrackLoader::FromWav(wav);
+        auto adjusted = track ? Utils::Resample(*track, spec) : std::nullopt;
+        if (!adjusted)
+        {
+            out.close();
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+
+        auto padding = (Alignment - offset % Alignment) % Alignment;
+        for (uint64_t p = 0; p < padding; ++p) out.put(0);
+        offset += padding;
+
+        auto name = sources[i].stem().string();
+        std::memcpy(entries[i].Name, name.data(), name.size());
+        entries[i].Offset = offset;
+        entries[i].Size = adjusted->Buffer().size();
+        entries[i].Loudness = Loudness::Measure(*adjusted).value_or(NAN);
+
+        out.write((const char*)adjusted->Buffer().data(), (std::streamsize)adjusted->Buffer().size());
+        offset += adjusted->Buffer().size();
+    }
+
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)entries.data(), (std::streamsize)(entries.size()*sizeof(BundleEntry)));
+    out.close();
+
+    if (!out)
+    {
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+
+    std::filesystem::rename(temporary, bundle, ec);
+    return !ec;
+}
@@ -0,0 +1,428 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/JitterBuffer.h"
+using namespace ml::audio;
+
+namespace
+{
+    constexpr size_t MaxConcealed = 5; // the packets concealed in a row, the rest is silent
+    constexpr float ConcealFade = 0.6f; // the level of each next concealed packet relative to the previous one
+    constexpr size_t CrossfadeFrames = 64;
+    constexpr size_t DrainRatio = 8; // the draining packet is shortened by 1/8
+    constexpr time_t DrainHysteresis = 20;
+    constexpr size_t ConvertFrames = 256; // the source frames pulled into the converter at once
+
+    /** Fills the destination with the source played backwards or forwards, the level ramps from one gain to another. */
+    template <typename T>
+    void Repeat(std::span<uint8_t> dst, std::span<const uint8_t> src, uint8_t channels, bool backwards, float from, float to) noexcept
+    {
+        auto* out = (T*)dst.data();
+        auto* in = (const T*)src.data();
+        int frames = (int)(src.size() / sizeof(T) / channels);
+
+        for (int f = 0; f < frames; ++f)
+        {
+            float gain = from + (to - from) * (float)f / (float)frames;
+            int source = backwards ? frames - 1 - f : f;
+
+            for (int c = 0; c < channels; ++c)
+            {
+                out[f*channels + c] = Utils::FromFloat<T>(Utils::ToFloat(in[source*channels + c]) * gain);
+            }
+        }
+    }
+
+    /** Blends the beginning of the destination from the source into itself. */
+    template <typename T>
+    void Crossfade(std::span<uint8_t> dst, std::span<const uint8_t> src, uint8_t channels, size_t frames) noexcept
+    {
+        auto* out = (T*)dst.data();
+        auto* in = (const T*)src.data();
+        int count = (int)std::min({ frames, dst.size() / sizeof(T) / channels, src.size() / sizeof(T) / channels });
+
+        for (int f = 0; f < count; ++f)
+        {
+            float w = (float)f / (float)count;
+            for (int c = 0; c < channels; ++c)
+            {
+                int i = f*channels + c;
+                out[i] = Utils::FromFloat<T>(Utils::ToFloat(in[i]) * (1 - w) + Utils::ToFloat(out[i]) * w);
+            }
+        }
+    }
+
+    /** Shortens the packet by the given number of frames, the cut is overlapped, so it doesn't click. Returns the new size. */
+    template <typename T>
+    auto Shorten(std::span<uint8_t> packet, uint8_t channels, size_t cut) noexcept -> size_t
+    {
+        auto* samples = (T*)packet.data();
+        int frames = (int)(packet.size() / sizeof(T) / channels);
+        int r = (int)cut;
+        int start = frames - 2*r;
+
+        // The last 2r frames turn into r frames that fade from the first half into the second one
+        for (int f = 0; f < r; ++f)
+        {
+            float w = (float)f / (float)r;
+            for (int c = 0; c < channels; ++c)
+            {
+                int a = (start + f)*channels + c;
+                int b = (start + r + f)*channels + c;
+                samples[a] = Utils::FromFloat<T>(Utils::ToFloat(samples[a]) * (1 - w) + Utils::ToFloat(samples[b]) * w);
+            }
+        }
+
+        return (size_t)(frames - r) * channels * sizeof(T);
+    }
+
+    /** Invokes the functor with the null pointer of the native sample type, returns false for the unsupported formats. */
+    template <typename F>
+    auto Dispatch(SDL_AudioFormat format, F&& f) noexcept -> bool
+    {
+        switch (format)
+        {
+            case AUDIO_U8: f((uint8_t*)nullptr); return true;
+            case AUDIO_S16SYS: f((int16_t*)nullptr); return true;
+            case AUDIO_S32SYS: f((int32_t*)nullptr); return true;
+            case AUDIO_F32SYS: f((float*)nullptr); return true;
+            default: return false;
+        }
+    }
+}
+
+auto JitterBuffer::Create(const SDL_AudioSpec& from, const SDL_AudioSpec& to, const JitterConfig& config) noexcept
+    -> std::shared_ptr<JitterBuffer>
+{
+    size_t frame = SDL_AUDIO_BITSIZE(from.format) / 8 * from.channels;
+    size_t output = SDL_AUDIO_BITSIZE(to.format) / 8 * to.channels;
+    if (!frame || !output || from.freq <= 0 || to.freq <= 0 || config.TargetLatency < 0 || config.MaxLatency < config.TargetLatency)
+    {
+        return nullptr;
+    }
+
+    auto buffer = std::make_shared<JitterBuffer>();
+    buffer->Spec_ = from;
+    buffer->Output_ = to;
+    buffer->Config_ = config;
+    buffer->Frame_ = frame;
+
+    // The packets in the output format are played as is
+    if (!Utils::SameFormat(from, to))
+    {
+        buffer->Converter_ = SDL_NewAudioStream(from.format, from.channels, from.freq, to.format, to.channels, to.freq);
+        if (!buffer->Converter_)
+        {
+            return nullptr;
+        }
+
+        buffer->Scratch_.resize(ConvertFrames * frame);
+        buffer->Discard_.resize(ConvertFrames * output);
+    }
+
+    return buffer;
+}
+
+JitterBuffer::~JitterBuffer()
+{
+    if (Converter_)
+    {
+        SDL_FreeAudioStream(Converter_);
+    }
+}
+
+auto JitterBuffer::Push(uint16_t sequence, std::span<const uint8_t> samples) noexcept -> bool
+{
+    static auto& jitter = utils::Metrics::Distribution("jitter_ms");
+    static auto& late = utils::Metrics::Counter("jitter_late_packets");
+    static auto& dropped = utils::Metrics::Counter("jitter_dropped_packets");
+
+    if (samples.empty() || samples.size() % Frame_)
+    {
+        return false;
+    }
+
+    std::lock_guard _ { Lock_ };
+    {
+        // Extend the sequence number relative to the highest one seen, so the wrapping doesn't reorder the packets
+        uint64_t extended = sequence;
+        if (Highest_)
+        {
+            auto delta = (int16_t)(uint16_t)(sequence - (uint16_t)*Highest_);
+            extended = *Highest_ + delta;
+        }
+        else
+        {
+            extended += 1 << 16; // leaves room for the packets reordered before the first one
+        }
+
+        if ((Next_ && extended < *Next_) || Packets_.contains(extended))
+        {
+            ++late;
+            return false;
+        }
+
+        // The transit time changes by the jitter, the packets are assumed to be of the same duration
+        double duration = (double)Utils::EstimateBufferDuration(samples.size(), Spec_);
+        double transit = (double)utils::Time::Now() - (double)extended * duration;
+        if (Transit_)
+        {
+            Jitter_ += (std::abs(transit - *Transit_) - Jitter_) / 16;
+            jitter.Record((int64_t)Jitter_);
+        }
+
+        Transit_ = transit;
+        Highest_ = std::max(Highest_.value_or(extended), extended);
+        Buffered_ += samples.size();
+        Packets_.emplace(extended, std::vector<uint8_t> { samples.begin(), samples.end() });
+
+        // The oldest packets give way once the maximum latency is buffered, they are skipped rather than concealed
+        while (Packets_.size() > 1 && Utils::EstimateBufferDuration(Buffered_, Spec_) > Config_.MaxLatency)
+        {
+            auto oldest = Packets_.begin();
+            if (Next_)
+            {
+                Next_ = std::max(*Next_, oldest->first + 1);
+            }
+
+            Buffered_ -= oldest->second.size();
+            Packets_.erase(oldest);
+            ++dropped;
+        }
+
+        // Everything Pull needs is allocated here, so the output never touches the heap
+        Released_.clear();
+        Released_.reserve(Packets_.size());
+        Current_.reserve(samples.size());
+        Source_.reserve(samples.size());
+        Tail_.reserve(samples.size());
+
+        return true;
+    }
+}
+
+auto JitterBuffer::Pull(uint8_t* stream, size_t len) noexcept -> size_t
+{
+    std::lock_guard _ { Lock_ };
+    {
+        if (!Converter_)
+        {
+            return PullSource(stream, len);
+        }
+
+        // The converter hands out only the whole frames, it's refilled from the packets until the request is met
+        size_t output = SDL_AUDIO_BITSIZE(Output_.format) / 8 * Output_.channels;
+        len -= len % output;
+
+        size_t done = 0;
+        while (done < len)
+        {
+            if (SDL_AudioStreamAvailable(Converter_) > 0)
+            {
+                size_t chunk = stream ? len - done : std::min(len - done, Discard_.size());
+                int size = SDL_AudioStreamGet(Converter_, stream ? stream + done : Discard_.data(), (int)chunk);
+                if (size <= 0)
+                {
+                    break;
+                }
+
+                done += size;
+                continue;
+            }
+
+            size_t pulled = PullSource(Scratch_.data(), Scratch_.size());
+            if (pulled)
+            {
+                if (SDL_AudioStreamPut(Converter_, Scratch_.data(), (int)pulled) != 0)
+                {
+                    break;
+                }
+
+                continue;
+            }
+
+            // The converter holds back a few frames for the resampling, they're released once the stream is played out
+            if (!Ended_ || Flushed_ || !Packets_.empty() || Offset_ != Current_.size())
+            {
+                break;
+            }
+
+            Flushed_ = true;
+            SDL_AudioStreamFlush(Converter_);
+        }
+
+        return done;
+    }
+}
+
+void JitterBuffer::End() noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        Ended_ = true;
+    }
+}
+
+auto JitterBuffer::Drained() const noexcept -> bool
+{
+    std::lock_guard _ { Lock_ };
+    {
+        bool converted = !Converter_ || (Flushed_ && SDL_AudioStreamAvailable(Converter_) == 0);
+        return Ended_ && Packets_.empty() && Offset_ == Current_.size() && converted;
+    }
+}
+
+auto JitterBuffer::Buffered() const noexcept -> time_t
+{
+    std::lock_guard _ { Lock_ };
+    {
+        auto converted = Converter_ ? Utils::EstimateBufferDuration((size_t)SDL_AudioStreamAvailable(Converter_), Output_) : 0;
+        return Utils::EstimateBufferDuration(Buffered_ + Current_.size() - Offset_, Spec_) + converted;
+    }
+}
+
+auto JitterBuffer::Target() const noexcept -> time_t
+{
+    std::lock_guard _ { Lock_ };
+    {
+        // Three times the jitter covers most of the delays ( as the jitter is the mean deviation )
+        return std::clamp((time_t)(3*Jitter_), Config_.TargetLatency, Config_.MaxLatency);
+    }
+}
+
+auto JitterBuffer::PullSource(uint8_t* stream, size_t len) noexcept -> size_t
+{
+    // Wait for the target latency before the start and after running dry
+    if (!Playing_)
+    {
+        if (Packets_.empty() || (!Ended_ && Buffered() < Target()))
+        {
+            return 0;
+        }
+
+        Playing_ = true;
+    }
+
+    size_t done = 0;
+    while (done < len)
+    {
+        if (Offset_ == Current_.size() && !NextPacket())
+        {
+            break;
+        }
+
+        size_t chunk = std::min(Current_.size() - Offset_, len - done);
+        if (stream)
+        {
+            std::memcpy(stream + done, Current_.data() + Offset_, chunk);
+        }
+
+        Offset_ += chunk;
+        done += chunk;
+    }
+
+    return done;
+}
+
+auto JitterBuffer::NextPacket() noexcept -> bool
+{
+    static auto& delay = utils::Metrics::Distribution("jitter_delay_ms");
+    static auto& lost = utils::Metrics::Counter("jitter_lost_packets");
+    static auto& underruns = utils::Metrics::Counter("jitter_underruns");
+
+    // The played packet is kept for the concealment, the concealed one is just overwritten
+    if (!Concealed_)
+    {
+        std::swap(Source_, Current_);
+    }
+
+    Offset_ = 0;
+
+    if (Packets_.empty())
+    {
+        if (Ended_)
+        {
+            Current_.clear();
+            return false;
+        }
+
+        // Bridge the short underrun, then wait for the target latency again
+        underruns += Concealed_ ? 0 : 1;
+        if (Concealed_ < MaxConcealed && !Source_.empty())
+        {
+            Conceal();
+            return true;
+        }
+
+        Current_.clear();
+        Playing_ = false;
+        return false;
+    }
+
+    // The sequence restarts from the first packet after a gap longer than the buffer could ever cover
+    auto first = Packets_.begin();
+    if (!Next_ || first->first - *Next_ > (uint64_t)Config_.MaxLatency / std::max<time_t>(Utils::EstimateBufferDuration(first->second.size(), Spec_), 1))
+    {
+        Next_ = first->first;
+    }
+
+    if (first->first != *Next_)
+    {
+        ++lost;
+        ++*Next_;
+
+        Conceal();
+        return true;
+    }
+
+    delay.Record(Buffered());
+
+    // The packet is copied into the reserved buffer, the node is freed by the producer
+    auto node = Packets_.extract(first);
+    Buffered_ -= node.mapped().size();
+    Current_.assign(node.mapped().begin(), node.mapped().end());
+    Released_.push_back(std::move(node));
+    ++*Next_;
+
+    // Drain the excess delay, the packet is played a bit faster
+    if (Buffered() > Target() + DrainHysteresis)
+    {
+        size_t frames = Current_.size() / Frame_;
+        Dispatch(Spec_.format, [&]<typename T>(T*)
+        {
+            Current_.resize(Shorten<T>(Current_, Spec_.channels, frames / DrainRatio));
+        });
+    }
+
+    // Continue the concealment into the packet instead of jumping to it
+    if (Concealed_ && !Source_.empty())
+    {
+        Tail_.resize(Source_.size());
+        Dispatch(Spec_.format, [&]<typename T>(T*)
+        {
+            float level = Concealed_ < MaxConcealed ? std::pow(ConcealFade, (float)Concealed_) : 0;
+            Repeat<T>(Tail_, Source_, Spec_.channels, Concealed_ % 2 == 0, level, level);
+            Crossfade<T>(Current_, Tail_, Spec_.channels, CrossfadeFrames);
+        });
+    }
+
+    Concealed_ = 0;
+    return true;
+}
+
+void JitterBuffer::Conceal() noexcept
+{
+    // Every second packet is played backwards, so both of its ends meet the same samples
+    Current_.resize(Source_.size());
+    bool concealed = Concealed_ < MaxConcealed && Dispatch(Spec_.format, [&]<typename T>(T*)
+    {
+        float from = std::pow(ConcealFade, (float)Concealed_);
+        float to = Concealed_ + 1 < MaxConcealed ? from * ConcealFade : 0;
+        Repeat<T>(Current_, Source_, Spec_.channels, Concealed_ % 2 == 0, from, to);
+    });
+
+    if (!concealed)
+    {
+        std::memset(Current_.data(), Spec_.format == AUDIO_U8 ? 0x80 : 0, Current_.size());
+    }
+
+    ++Concealed_;
+}
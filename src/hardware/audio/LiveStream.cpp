@@ -0,0 +1,180 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/LiveStream.h"
+using namespace ml::audio;
+
+auto LiveStream::Create(const std::shared_ptr<Player>& player, const SDL_AudioSpec& from, const std::optional<JitterConfig>& jitter) noexcept
+    -> std::shared_ptr<LiveStream>
+{
+    if (!player || from.channels == 0 || from.freq <= 0 || SDL_AUDIO_BITSIZE(from.format) == 0)
+    {
+        return nullptr;
+    }
+
+    auto stream = std::make_shared<LiveStream>();
+    stream->From_ = from;
+    stream->To_ = player->Spec();
+
+    // The samples in the player' format are queued as is, the jitter buffer converts the packets itself once they are reordered
+    if (!jitter && !Utils::SameFormat(from, stream->To_))
+    {
+        stream->Converter_ = SDL_NewAudioStream (
+            from.format, from.channels, from.freq,
+            stream->To_.format, stream->To_.channels, stream->To_.freq
+        );
+
+        if (!stream->Converter_)
+        {
+            return nullptr;
+        }
+    }
+
+    std::shared_ptr<JitterBuffer> buffer;
+    if (jitter && !(buffer = JitterBuffer::Create(from, stream->To_, *jitter)))
+    {
+        return nullptr;
+    }
+
+    auto [id, listener] = player->BeginStream(buffer);
+    stream->Player_ = player;
+    stream->Id_ = id;
+    stream->Listener_ = std::move(listener);
+
+    return stream;
+}
+
+LiveStream::~LiveStream()
+{
+    if (Listener_)
+    {
+        Player_->EndStream(Id_);
+    }
+
+    if (Converter_)
+    {
+        SDL_FreeAudioStream(Converter_);
+    }
+}
+
+auto LiveStream::Feed(std::span<const uint8_t> samples, std::optional<uint16_t> sequence) noexcept -> bool
+{
+    static auto& queueLatency = utils::Metrics::Distribution("stream_queue_latency_ms");
+    static auto& e2eLatency = utils::Metrics::Distribution("stream_e2e_latency_ms");
+
+    std::lock_guard _ { Lock_ };
+    {
+        if (!Listener_)
+        {
+            return false;
+        }
+
+        // Only the whole frames are pushed as a single packet, the rest waits for the next portion.
+        // The samples are copied only when the previous portion has left an incomplete frame.
+        size_t frame = SDL_AUDIO_BITSIZE(From_.format) / 8 * From_.channels;
+        auto packet = samples;
+
+        if (!Partial_.empty())
+        {
+            Partial_.insert(Partial_.end(), samples.begin(), samples.end());
+            packet = Partial_;
+        }
+
+        size_t whole = packet.size() / frame * frame;
+        bool pushed = !whole || Push(packet.first(whole), sequence);
+        Fed_ += whole;
+
+        std::vector<uint8_t> rest { packet.begin() + (long)whole, packet.end() };
+        Partial_.swap(rest);
+
+        if (!pushed)
+        {
+            return false;
+        }
+
+        if (!whole)
+        {
+            return true;
+        }
+
+        // The last fed sample is played once everything queued before it is played
+        auto left = Player_->DurationLeft();
+        queueLatency.Record(left);
+
+        if (CaptureTime_)
+        {
+            auto captured = *CaptureTime_ + Utils::EstimateBufferDuration(Fed_, From_);
+            e2eLatency.Record(utils::Time::Now() + left - captured);
+        }
+
+        return true;
+    }
+}
+
+void LiveStream::SetCaptureTime(time_t time) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        CaptureTime_ = time;
+    }
+}
+
+auto LiveStream::End() noexcept -> std::future<void>
+{
+    std::lock_guard _ { Lock_ };
+    {
+        if (!Listener_)
+        {
+            return {};
+        }
+
+        // Push the samples still held by the converter
+        if (Converter_)
+        {
+            SDL_AudioStreamFlush(Converter_);
+            Push({}, std::nullopt);
+        }
+
+        Player_->EndStream(Id_);
+
+        auto listener = std::move(*Listener_);
+        Listener_.reset();
+
+        return listener;
+    }
+}
+
+auto LiveStream::Push(std::span<const uint8_t> samples, std::optional<uint16_t> sequence) noexcept -> bool
+{
+    auto chunk = samples;
+    if (Converter_)
+    {
+        if (!samples.empty() && SDL_AudioStreamPut(Converter_, samples.data(), (int)samples.size()) != 0)
+        {
+            return false;
+        }
+
+        // The converter hands out only the whole frames of the player' format
+        Converted_.resize(SDL_AudioStreamAvailable(Converter_));
+        int size = SDL_AudioStreamGet(Converter_, Converted_.data(), (int)Converted_.size());
+        if (size < 0)
+        {
+            return false;
+        }
+
+        chunk = { Converted_.data(), (size_t)size };
+    }
+
+    if (chunk.empty())
+    {
+        return true;
+    }
+
+    // Only the fed chunk takes a sequence number, so the jitter buffer never sees a gap that wasn't lost
+    uint16_t number = sequence.value_or(Sequence_);
+    if (!Player_->Feed(Id_, chunk, number))
+    {
+        return false;
+    }
+
+    Sequence_ = (uint16_t)(number + 1);
+    return true;
+}
@@ -0,0 +1,202 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/Loudness.h"
+using namespace ml::audio;
+
+namespace
+{
+    constexpr size_t Lanes = 8; // the channels are the lanes of the filter, the unused ones stay silent
+    constexpr double AbsoluteGate = -70;
+    constexpr double RelativeGate = -10;
+
+    struct Biquad
+    {
+        double B0, B1, B2, A1, A2;
+    };
+
+    /** The K-weighting filter ( the high shelf and the high pass ) with its state for all the channels. */
+    class KWeighting
+    {
+        Biquad Shelf_ {}, Pass_ {};
+        std::array<double, Lanes> Weights_ {};
+        std::array<double, Lanes> S1_ {}, S2_ {}, P1_ {}, P2_ {};
+        std::array<double, Lanes> Energy_ {};
+
+    public:
+        KWeighting(int freq, uint8_t channels) noexcept
+        {
+            // The coefficients of BS.1770 are given for 48kHz, so they are derived for any rate from the analog prototypes
+            double k = std::tan(M_PI * 1681.974450955533 / freq);
+            double q = 0.7071752369554196;
+            double vh = std::pow(10.0, 3.999843853973347 / 20);
+            double vb = std::pow(vh, 0.4996667741545416);
+            double a0 = 1 + k/q + k*k;
+            Shelf_ = { (vh + vb*k/q + k*k) / a0, 2*(k*k - vh) / a0, (vh - vb*k/q + k*k) / a0, 2*(k*k - 1) / a0, (1 - k/q + k*k) / a0 };
+
+            k = std::tan(M_PI * 38.13547087602444 / freq);
+            q = 0.5003270373238773;
+            a0 = 1 + k/q + k*k;
+            Pass_ = { 1, -2, 1, 2*(k*k - 1) / a0, (1 - k/q + k*k) / a0 };
+
+            // The surround channels of 5.1 are louder, LFE isn't counted at all
+            for (size_t c = 0; c < channels; ++c)
+            {
+                Weights_[c] = channels == 6 ? std::array { 1.0, 1.0, 1.0, 0.0, 1.41, 1.41 }[c] : 1.0;
+            }
+        }
+
+        /** Filters the frame and accumulates its energy. The loops run over the lanes, so they are vectorized. */
+        void Push(const std::array<double, Lanes>& frame) noexcept
+        {
+            std::array<double, Lanes> shelved {}, passed {};
+            for (size_t c = 0; c < Lanes; ++c)
+            {
+                shelved[c] = Shelf_.B0*frame[c] + S1_[c];
+                S1_[c] = Shelf_.B1*frame[c] - Shelf_.A1*shelved[c] + S2_[c];
+                S2_[c] = Shelf_.B2*frame[c] - Shelf_.A2*shelved[c];
+            }
+
+            for (size_t c = 0; c < Lanes; ++c)
+            {
+                passed[c] = Pass_.B0*shelved[c] + P1_[c];
+                P1_[c] = Pass_.B1*shelved[c] - Pass_.A1*passed[c] + P2_[c];
+                P2_[c] = Pass_.B2*shelved[c] - Pass_.A2*passed[c];
+                Energy_[c] += passed[c]*passed[c];
+            }
+        }
+
+        /** Returns the weighted energy accumulated since the last call and resets it. */
+        auto Take() noexcept -> double
+        {
+            double sum = 0;
+            for (size_t c = 0; c < Lanes; ++c)
+            {
+                sum += Weights_[c] * Energy_[c];
+                Energy_[c] = 0;
+            }
+
+            return sum;
+        }
+    };
+
+    /** Filters the samples, returns the mean square of every 100ms segment. */
+    template <typename T>
+    auto Segments(std::span<const uint8_t> buffer, const SDL_AudioSpec& spec) noexcept -> std::vector<double>
+    {
+        KWeighting filter { spec.freq, spec.channels };
+        std::vector<double> segments;
+
+        auto* samples = (const T*)buffer.data();
+        size_t frames = buffer.size() / sizeof(T) / spec.channels;
+        size_t segment = std::max(spec.freq / 10, 1);
+
+        std::array<double, Lanes> frame {};
+        for (size_t f = 0; f < frames; ++f)
+        {
+            for (size_t c = 0; c < spec.channels; ++c)
+            {
+                frame[c] = Utils::ToFloat(samples[f*spec.channels + c]);
+            }
+
+            filter.Push(frame);
+            if ((f + 1) % segment == 0)
+            {
+                segments.push_back(filter.Take() / (double)segment);
+            }
+        }
+
+        // The track shorter than a block is measured as a whole
+        if (segments.size() < 4 && frames)
+        {
+            double total = filter.Take();
+            for (auto s : segments) total += s * (double)segment;
+            return { total / (double)frames, total / (double)frames, total / (double)frames, total / (double)frames };
+        }
+
+        return segments;
+    }
+
+    auto ToLufs(double meanSquare) noexcept -> double
+    {
+        return -0.691 + 10*std::log10(meanSquare);
+    }
+}
+
+auto Loudness::Measure(const Track& track) noexcept -> std::optional<double>
+{
+    const auto& spec = track.Spec();
+    if (spec.channels == 0 || spec.channels > Lanes || spec.freq <= 0)
+    {
+        return std::nullopt;
+    }
+
+    std::vector<double> segments;
+    switch (spec.format)
+    {
+        case AUDIO_U8: segments = Segments<uint8_t>(track.Buffer(), spec); break;
+        case AUDIO_S16SYS: segments = Segments<int16_t>(track.Buffer(), spec); break;
+        case AUDIO_S32SYS: segments = Segments<int32_t>(track.Buffer(), spec); break;
+        case AUDIO_F32SYS: segments = Segments<float>(track.Buffer(), spec); break;
+
+        default:
+        {
+            // Exotic formats are measured in float
+            SDL_AudioSpec native = spec;
+            native.format = AUDIO_F32SYS;
+
+            auto converted = Utils::Convert(track.Buffer(), spec, native);
+            if (!converted)
+            {
+                return std::nullopt;
+            }
+
+            segments = Segments<float>(*converted, native);
+        }
+    }
+
+    // The blocks of 400ms overlap by 75%, so each of them is 4 consecutive segments
+    std::vector<double> blocks;
+    for (size_t i = 0; i + 4 <= segments.size(); ++i)
+    {
+        double block = (segments[i] + segments[i + 1] + segments[i + 2] + segments[i + 3]) / 4;
+        if (block > 0 && ToLufs(block) > AbsoluteGate)
+        {
+            blocks.push_back(block);
+        }
+    }
+
+    if (blocks.empty())
+    {
+        return std::nullopt;
+    }
+
+    // Gate the blocks that are much quieter than the rest
+    double mean = 0;
+    for (auto block : blocks) mean += block;
+    double threshold = ToLufs(mean / (double)blocks.size()) + RelativeGate;
+
+    double gated = 0;
+    size_t count = 0;
+    for (auto block : blocks)
+    {
+        if (ToLufs(block) > threshold)
+        {
+            gated += block;
+            ++count;
+        }
+    }
+
+    return count ? std::optional { ToLufs(gated / (double)count) } : std::nullopt;
+}
+
+void Loudness::Normalize(Track& track, double target, double maxGain) noexcept
+{
+    if (!track.Loudness())
+    {
+        track.SetLoudness(Measure(track));
+    }
+
+    if (auto loudness = track.Loudness())
+    {
+        track.SetGain((float)std::pow(10.0, std::min(target - *loudness, maxGain) / 20));
+    }
+}
@@ -0,0 +1,173 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/PagePool.h"
+using namespace ml::audio;
+
+namespace
+{
+    constexpr size_t HugePageSize = 2*1024*1024;
+    constexpr uint64_t IndexMask = 0xFFFFFFFF;
+}
+
+auto PagePool::Create(size_t pageSize, uint32_t pages, bool hugepages, bool locked) noexcept -> std::shared_ptr<PagePool>
+{
+    static auto& total = utils::Metrics::Gauge("audio_pool_pages");
+
+    if (pageSize < sizeof(uint8_t*) || pages == 0 || pages > SIZE_MAX / pageSize)
+    {
+        return nullptr;
+    }
+
+    // Prefer the huge pages, but fall back to the regular ones ( the kernel may still merge them )
+    size_t size = pageSize * pages;
+    void* memory = MAP_FAILED;
+    size_t mapped = 0;
+    int populate = locked ? MAP_POPULATE : 0;
+
+    if (hugepages)
+    {
+        mapped = (size + HugePageSize - 1) / HugePageSize * HugePageSize;
+        memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+    }
+
+    if (memory == MAP_FAILED)
+    {
+        mapped = size;
+        memory = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | populate, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        if (hugepages)
+        {
+            madvise(memory, mapped, MADV_HUGEPAGE);
+        }
+    }
+
+    // Already populated, so the pages stay resident even when the lock is over the limit
+    if (locked)
+    {
+        mlock(memory, mapped);
+    }
+
+    auto pool = std::make_shared<PagePool>();
+    pool->Memory_ = (uint8_t*)memory;
+    pool->Mapped_ = mapped;
+    pool->PageSize_ = pageSize;
+    pool->Pages_ = pages;
+
+    // Chain all the pages into the free list
+    pool->Next_ = std::make_unique<std::atomic<uint32_t>[]>(pages);
+    for (uint32_t i = 0; i < pages; ++i)
+    {
+        pool->Next_[i] = i + 1 < pages ? i + 2 : 0;
+    }
+
+    pool->Head_ = 1;
+    total += pages;
+
+    return pool;
+}
+
+PagePool::~PagePool()
+{
+    static auto& total = utils::Metrics::Gauge("audio_pool_pages");
+
+    munmap(Memory_, Mapped_);
+    Free(Retired_.load());
+    total -= Pages_;
+}
+
+auto PagePool::Acquire() noexcept -> uint8_t*
+{
+    static auto& used = utils::Metrics::Gauge("audio_pool_pages_used");
+    static auto& overflows = utils::Metrics::Counter("audio_pool_overflows");
+
+    // The whole retired list is taken at once, so the concurrent producers never share it
+    auto* retired = Retired_.load(std::memory_order_relaxed) ? Retired_.exchange(nullptr, std::memory_order_acquire) : nullptr;
+
+    auto head = Head_.load(std::memory_order_acquire);
+    while (head & IndexMask)
+    {
+        auto index = (uint32_t)(head & IndexMask);
+        uint64_t desired = ((head >> 32) + 1) << 32 | Next_[index - 1].load(std::memory_order_relaxed);
+
+        if (Head_.compare_exchange_weak(head, desired, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            Free(retired);
+            ++used;
+            return Memory_ + (index - 1) * PageSize_;
+        }
+    }
+
+    // The pool is still exhausted, a retired page is reused before a new one is allocated
+    if (retired)
+    {
+        uint8_t* rest;
+        std::memcpy(&rest, retired, sizeof(rest));
+        Free(rest);
+
+        ++used;
+        return retired;
+    }
+
+    auto* page = new (std::nothrow) uint8_t[PageSize_];
+    if (page)
+    {
+        ++overflows;
+        ++used;
+    }
+
+    return page;
+}
+
+void PagePool::Release(uint8_t* page) noexcept
+{
+    static auto& used = utils::Metrics::Gauge("audio_pool_pages_used");
+    --used;
+
+    // The heap page is freed by a producer, so the audio thread never calls the allocator
+    if (!Owns(page))
+    {
+        auto* head = Retired_.load(std::memory_order_relaxed);
+        do
+        {
+            std::memcpy(page, &head, sizeof(head));
+        }
+        while (!Retired_.compare_exchange_weak(head, page, std::memory_order_release, std::memory_order_relaxed));
+
+        return;
+    }
+
+    auto index = (uint32_t)((page - Memory_) / PageSize_) + 1;
+    auto head = Head_.load(std::memory_order_relaxed);
+    uint64_t desired;
+
+    do
+    {
+        Next_[index - 1].store((uint32_t)(head & IndexMask), std::memory_order_relaxed);
+        desired = ((head >> 32) + 1) << 32 | index;
+    }
+    while (!Head_.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+}
+
+auto PagePool::PageSize() const noexcept -> size_t
+{
+    return PageSize_;
+}
+
+auto PagePool::Owns(const uint8_t* page) const noexcept -> bool
+{
+    return page >= Memory_ && page < Memory_ + PageSize_ * Pages_;
+}
+
+void PagePool::Free(uint8_t* pages) noexcept
+{
+    while (pages)
+    {
+        uint8_t* next;
+        std::memcpy(&next, pages, sizeof(next));
+        delete[] pages;
+        pages = next;
+    }
+}
@@ -2,90 +2,284 @@
 #include "hardware/audio/Player.h"
 using namespace ml::audio;
 
-auto Player::Create(const std::optional<std::string>& device) -> std::shared_ptr<Player>
+namespace
 {
-    SDL_Init(SDL_INIT_AUDIO);
+    constexpr time_t MaxStreamBacklog = 10000; // the unplayed audio of a live stream, the feeds beyond it fail
+}
 
-    // Create the dummy player ( because we need its address in audio-supplier callback )
-    auto* player = new Player {};
+auto Player::Create(const SDL_AudioSpec& spec, const std::shared_ptr<PagePool>& pool) -> std::shared_ptr<Player>
+{
+    auto player = std::make_shared<Player>();
+    player->Spec_ = spec;
+    player->Pool_ = pool;
+    player->Paused_ = true;
 
-    // Select the device ( if given )
-    const char* name = device ? device->c_str() : nullptr;
+    return player;
+}
 
-    // Make default specs
-    SDL_AudioSpec spec = {};
-    spec.freq = 44100;
-    spec.samples = 4096;
-    spec.callback = &Player::AudioSupplier;
-    spec.userdata = player;
+Player::~Player()
+{
+    Clear();
+}
 
-    // Create the output
-    SDL_AudioDeviceID out = SDL_OpenAudioDevice(name, 0, &spec, &spec, SDL_AUDIO_ALLOW_ANY_CHANGE);
+auto Player::Supply(uint8_t* stream, int len) noexcept -> size_t
+{
+    static auto& firstSampleDelay = utils::Metrics::Distribution("audio_first_sample_delay_ms");
+    std::unique_lock lock { BufferLock_ };
 
-    if (!out)
+    // If the player is paused or preempted - do nothing, the queue keeps its position
+    if (Paused_ || Preempted_)
     {
-        delete player;
-        return nullptr;
+        return 0;
     }
 
-    // Unpause the device ( we are omitting the bug in SDL library )
-    SDL_PauseAudioDevice(out, false);
+    // Feed audio data into the stream
+    size_t remaining = len;
+    uint8_t* dst = stream;
 
-    player->Spec_ = spec;
-    player->Out_ = out;
-    player->Paused_ = true;
+    while (remaining && !Buffer_.empty())
+    {
+        auto& front = Buffer_.front();
 
-    return std::shared_ptr<Player> {
-        player
-    };
-}
+        // The jitter buffer plays at its own pace, the next entry starts once it's drained
+        if (front.Jitter)
+        {
+            size_t chunk = front.Jitter->Pull(Muted_ ? nullptr : dst, remaining);
+            if (chunk && !front.Idx && !Muted_)
+            {
+                firstSampleDelay.Record(utils::Time::Now() - front.EnqueuedAt);
+            }
+
+            // The jitter buffer isn't counted into the buffer length, so the entry is only as large as its played part
+            front.Size += chunk;
+            front.Idx += chunk;
+            remaining -= chunk;
+            dst += Muted_ ? 0 : chunk;
+
+            if (!Finished(front))
+            {
+                break;
+            }
+
+            DropFinished();
+            continue;
+        }
 
-Player::~Player()
-{
-    Clear();
-    SDL_CloseAudioDevice(Out_);
+        // The live stream waits for more samples
+        if (front.Idx == front.Size)
+        {
+            break;
+        }
+
+        // The live stream has moved to the next page since the current one was played out
+        if (front.Offset == front.Segments[front.Segment].size())
+        {
+            NextSegment(front);
+        }
+
+        auto segment = front.Segments[front.Segment];
+        long chunk = (long)std::min(segment.size() - front.Offset, remaining);
+
+        // Event if the channel is muted we need to take
+        if (!Muted_)
+        {
+            if (!front.Idx)
+            {
+                firstSampleDelay.Record(utils::Time::Now() - front.EnqueuedAt);
+            }
+
+            std::memcpy(dst, segment.data() + front.Offset, chunk);
+            if (front.Gain != 1)
+            {
+                Utils::Scale({ dst, (size_t)chunk }, Spec_.format, front.Gain);
+            }
+
+            dst += chunk;
+        }
+
+        front.Offset += chunk;
+        front.Idx += chunk;
+        remaining -= chunk;
+        BufferLength_ -= chunk;
+
+        // The played page goes back to the pool right away, so only the unplayed audio is kept.
+        // The last page is kept till the end, the live stream may still write into it.
+        if (front.Offset == segment.size() && front.Segment + 1 < front.Segments.size())
+        {
+            NextSegment(front);
+        }
+
+        // If the track ended - invoke the listener
+        DropFinished();
+    }
+
+    return dst - stream;
 }
 
 auto Player::Enqueue(const Track& audio) noexcept -> std::optional<std::future<void>>
 {
-    // Open the audio device ( for this audio )
+    Entry entry {};
+    entry.EnqueuedAt = utils::Time::Now();
+    entry.Gain = audio.Gain();
+
+    // The persistent track in the right format is referenced as is, anything else is converted into the pages.
+    // Both happen outside the lock, so the output isn't blocked.
+    if (audio.Persistent() && Utils::SameFormat(audio.Spec(), Spec_))
+    {
+        entry.Owner = audio.Owner();
+        entry.Segments = { audio.Buffer() };
+        entry.Size = audio.Buffer().size();
+    }
+    else if (!Fill(audio, entry))
+    {
+        return std::nullopt;
+    }
+
+    auto listener = entry.Listener.get_future();
+    if (!entry.Size)
+    {
+        entry.Listener.set_value(); // nothing to play
+        return listener;
+    }
+
     std::lock_guard _ { BufferLock_ };
     {
-        // Resample the track in order
-        auto adjusted = Utils::Resample(audio, Spec_);
-        if (!adjusted)
+        // Add new track to the queue
+        BufferLength_ += entry.Size;
+        Buffer_.push_back(std::move(entry));
+
+        return listener;
+    }
+}
+
+void Player::Clear() noexcept
+{
+    // Detach the queue under the lock, but release its pages outside, so the output isn't blocked
+    std::deque<Entry> dropped;
+    std::unique_lock lock { BufferLock_ };
+    {
+        dropped.swap(Buffer_);
+        BufferLength_ = 0;
+    }
+    lock.unlock();
+
+    for (auto& entry : dropped)
+    {
+        Release(entry);
+        entry.Listener.set_value();
+    }
+}
+
+void Player::Skip() noexcept
+{
+    std::optional<Entry> dropped;
+    std::unique_lock lock { BufferLock_ };
+    {
+        if (!Buffer_.empty())
         {
-            return std::nullopt;
+            auto& front = Buffer_.front();
+            BufferLength_ -= front.Size - front.Idx;
+
+            dropped = std::move(front);
+            Buffer_.pop_front();
         }
+    }
+    lock.unlock();
 
-        // Add new track to the queue
-        Buffer_.emplace_back(adjusted->Buffer(), std::promise<void> {}, 0);
-        BufferLength_ += adjusted->Buffer().size();
+    if (dropped)
+    {
+        Release(*dropped);
+        dropped->Listener.set_value();
+    }
+}
+
+auto Player::BeginStream(const std::shared_ptr<JitterBuffer>& jitter) noexcept -> std::pair<uint64_t, std::future<void>>
+{
+    Entry entry {};
+    entry.EnqueuedAt = utils::Time::Now();
+    entry.Pooled = true;
+    entry.Open = true;
+    entry.Jitter = jitter;
+
+    auto listener = entry.Listener.get_future();
 
-        return Buffer_.back().Listener.get_future();
+    std::lock_guard _ { BufferLock_ };
+    {
+        entry.Stream = NextStream_++;
+        Buffer_.push_back(std::move(entry));
+
+        return { Buffer_.back().Stream, std::move(listener) };
     }
 }
 
-void Player::Clear() noexcept
+auto Player::Feed(uint64_t stream, std::span<const uint8_t> samples, uint16_t sequence) noexcept -> bool
 {
+    static auto& overflows = utils::Metrics::Counter("stream_backlog_overflows");
+    size_t capacity = PageCapacity();
+
     std::lock_guard _ { BufferLock_ };
     {
-        while (!Buffer_.empty())
+        auto* entry = FindStream(stream);
+        if (!entry || !capacity)
         {
-            BufferLength_ -= Buffer_.front().Data.size() - Buffer_.front().Idx;
-            Buffer_.front().Listener.set_value();
-            Buffer_.pop_front();
+            return false;
+        }
+
+        // The late packets are dropped by the jitter buffer, the stream goes on
+        if (entry->Jitter)
+        {
+            entry->Jitter->Push(sequence, samples);
+            return true;
+        }
+
+        // The stream that isn't played ( paused or preempted channel ) stops taking the pages at some point
+        if (Utils::EstimateBufferDuration(entry->Size - entry->Idx + samples.size(), Spec_) > MaxStreamBacklog)
+        {
+            ++overflows;
+            return false;
         }
+
+        // Fill up the last page, then continue in the new ones
+        while (!samples.empty())
+        {
+            if (entry->Segments.empty() || entry->Segments.back().size() == capacity)
+            {
+                auto* page = Pool_->Acquire();
+                if (!page)
+                {
+                    return false;
+                }
+
+                entry->Segments.emplace_back(page, 0);
+            }
+
+            auto& last = entry->Segments.back();
+            size_t size = std::min(capacity - last.size(), samples.size());
+            std::memcpy((uint8_t*)last.data() + last.size(), samples.data(), size);
+
+            last = { last.data(), last.size() + size };
+            samples = samples.subspan(size);
+            entry->Size += size;
+            BufferLength_ += size;
+        }
+
+        return true;
     }
 }
 
-void Player::Skip() noexcept
+void Player::EndStream(uint64_t stream) noexcept
 {
     std::lock_guard _ { BufferLock_ };
     {
-        if (!Buffer_.empty())
+        if (auto* entry = FindStream(stream))
         {
-            DropFirstEntry();
+            if (entry->Jitter)
+            {
+                entry->Jitter->End();
+            }
+
+            entry->Open = false;
+            DropFinished();
         }
     }
 }
@@ -100,6 +294,21 @@ void Player::Resume() noexcept
     Paused_ = false;
 }
 
+void Player::Preempt() noexcept
+{
+    Preempted_ = true;
+}
+
+void Player::Restore() noexcept
+{
+    Preempted_ = false;
+}
+
+auto Player::Preempted() const noexcept -> bool
+{
+    return Preempted_;
+}
+
 void Player::Mute() noexcept
 {
     Muted_ = true;
@@ -120,62 +329,217 @@ auto Player::Muted() const noexcept -> bool
     return Muted_;
 }
 
+auto Player::Spec() const noexcept -> SDL_AudioSpec
+{
+    return Spec_;
+}
+
 auto Player::DurationLeft() const noexcept -> time_t
 {
     std::lock_guard _ { BufferLock_ };
-    return Utils::EstimateBufferDuration(BufferLength_, Spec_);
+    {
+        time_t left = Utils::EstimateBufferDuration(BufferLength_, Spec_);
+        for (const auto& entry : Buffer_)
+        {
+            left += entry.Jitter ? entry.Jitter->Buffered() : 0;
+        }
+
+        return left;
+    }
 }
 
-void Player::AudioSupplier(void* userdata, uint8_t* stream, int len) noexcept
+auto Player::QueueLeft() const noexcept -> std::pair<size_t, time_t>
 {
-    auto* self = (Player*)userdata;
-    std::unique_lock lock { self->BufferLock_ };
+    std::lock_guard _ { BufferLock_ };
+    {
+        // The streams are left out, so their backlog doesn't shift the position within the tracks
+        size_t tracks = 0;
+        for (const auto& entry : Buffer_)
+        {
+            tracks += entry.Stream ? 0 : entry.Size - entry.Idx;
+        }
 
-    // Empty the buffer ( required by SDL docs )
-    SDL_memset(stream, 0, len);
+        return { Buffer_.size(), Utils::EstimateBufferDuration(tracks, Spec_) };
+    }
+}
 
-    // If the device is paused - do nothing
-    if (self->Paused_)
+auto Player::Fill(const Track& audio, Entry& entry) noexcept -> bool
+{
+    size_t capacity = PageCapacity();
+    if (!capacity)
     {
-        return;
+        return false;
     }
 
-    // Feed audio data into the stream
-    size_t remaining = std::min(self->BufferLength_, (size_t)len);
-    uint8_t* dst = stream;
+    entry.Pooled = true;
 
-    while (remaining)
+    uint8_t* page = nullptr;
+    size_t filled = 0;
+
+    auto commit = [&]()
     {
-        auto& front = self->Buffer_.front();
-        long chunk = (long)std::min(front.Data.size() - front.Idx, remaining);
+        entry.Segments.emplace_back(page, filled);
+        entry.Size += filled;
+        page = nullptr;
+    };
 
-        // Event if the channel is muted we need to take
-        if (!self->Muted_)
+    // Moves the bytes from the source into the pages, the source returns how much it has written
+    auto pump = [&](const auto& source) -> bool
+    {
+        while (true)
         {
-            SDL_memcpy(dst, &front.Data[front.Idx], chunk);
-            dst += chunk;
+            if (!page)
+            {
+                page = Pool_->Acquire();
+                filled = 0;
+
+                if (!page)
+                {
+                    return false;
+                }
+            }
+
+            auto written = source(page + filled, capacity - filled);
+            if (written <= 0)
+            {
+                return true;
+            }
+
+            filled += written;
+            if (filled == capacity)
+            {
+                commit();
+            }
         }
+    };
 
-        front.Idx += chunk;
-        remaining -= chunk;
-        self->BufferLength_ -= chunk;
+    bool pumped;
+    if (Utils::SameFormat(audio.Spec(), Spec_))
+    {
+        // Just copy the samples
+        auto samples = audio.Buffer();
+        pumped = pump([&](uint8_t* dst, size_t size) -> long
+        {
+            size = std::min(size, samples.size());
+            std::memcpy(dst, samples.data(), size);
+            samples = samples.subspan(size);
+            return (long)size;
+        });
+    }
+    else
+    {
+        // Convert the samples right into the pages, feeding the stream by parts keeps its internal buffer small
+        const auto& from = audio.Spec();
+        auto* stream = SDL_NewAudioStream(from.format, from.channels, from.freq, Spec_.format, Spec_.channels, Spec_.freq);
+        if (!stream)
+        {
+            return false;
+        }
 
-        // If the page ended - invoke the listener
-        if (front.Idx == front.Data.size())
+        auto samples = audio.Buffer();
+        auto drain = [&](uint8_t* dst, size_t size) -> long
         {
-            self->DropFirstEntry();
+            return SDL_AudioStreamGet(stream, dst, (int)std::min<size_t>(size, SDL_AudioStreamAvailable(stream)));
+        };
+
+        pumped = true;
+        while (pumped && !samples.empty())
+        {
+            auto part = samples.first(std::min<size_t>(samples.size(), capacity));
+            samples = samples.subspan(part.size());
+
+            pumped = SDL_AudioStreamPut(stream, part.data(), (int)part.size()) == 0 && pump(drain);
         }
+
+        pumped = pumped && SDL_AudioStreamFlush(stream) == 0 && pump(drain);
+        SDL_FreeAudioStream(stream);
     }
 
-    lock.unlock();
+    // Keep the last partially filled page
+    if (page && filled)
+    {
+        commit();
+    }
+    else if (page)
+    {
+        Pool_->Release(page);
+    }
+
+    if (!pumped)
+    {
+        Release(entry);
+        return false;
+    }
 
-    //std::cout << remaining << ' ' << self->Buffer_.size() << ' ' << self->BufferLength_
-    //                   << " muted=" << self->Muted_ << "\n"; // TODO: Remove debug
+    return true;
+}
+
+void Player::Release(Entry& entry) noexcept
+{
+    // The pages before the current one are already released by the playback
+    if (entry.Pooled)
+    {
+        for (size_t i = entry.Segment; i < entry.Segments.size(); ++i)
+        {
+            Pool_->Release((uint8_t*)entry.Segments[i].data());
+        }
+    }
+
+    entry.Segments.clear();
+    entry.Segment = 0;
 }
 
 void Player::DropFirstEntry() noexcept
 {
-    BufferLength_ -= Buffer_.front().Data.size() - Buffer_.front().Idx;
-    Buffer_.front().Listener.set_value();
+    auto& front = Buffer_.front();
+    BufferLength_ -= front.Size - front.Idx;
+    Release(front);
+
+    front.Listener.set_value();
     Buffer_.pop_front();
-}
\ No newline at end of file
+}
+
+void Player::DropFinished() noexcept
+{
+    while (!Buffer_.empty() && Finished(Buffer_.front()))
+    {
+        DropFirstEntry();
+    }
+}
+
+auto Player::Finished(const Entry& entry) noexcept -> bool
+{
+    return !entry.Open && (entry.Jitter ? entry.Jitter->Drained() : entry.Idx == entry.Size);
+}
+
+void Player::NextSegment(Entry& entry) noexcept
+{
+    if (entry.Pooled)
+    {
+        Pool_->Release((uint8_t*)entry.Segments[entry.Segment].data());
+    }
+
+    entry.Segment++;
+    entry.Offset = 0;
+}
+
+auto Player::FindStream(uint64_t stream) noexcept -> Entry*
+{
+    // The streams are usually at the end of the queue
+    for (auto& entry : std::views::reverse(Buffer_))
+    {
+        if (entry.Stream == stream)
+        {
+            return entry.Open ? &entry : nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+auto Player::PageCapacity() const noexcept -> size_t
+{
+    // Pages hold only the whole frames
+    size_t frame = SDL_AUDIO_BITSIZE(Spec_.format) / 8 * std::max<uint8_t>(Spec_.channels, 1);
+    return Pool_->PageSize() / frame * frame;
+}
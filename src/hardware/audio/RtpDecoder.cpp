@@ -0,0 +1,155 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/RtpDecoder.h"
+using namespace ml::audio;
+
+namespace
+{
+    constexpr size_t HeaderSize = 12;
+    constexpr size_t MaxOpusFrames = 5760; // 120ms at 48kHz, the longest opus packet
+
+    constexpr auto MuLawTable = []
+    {
+        std::array<int16_t, 256> table {};
+        for (int i = 0; i < 256; ++i)
+        {
+            int u = ~i & 0xFF;
+            int t = (((u & 0x0F) << 3) + 0x84) << ((u & 0x70) >> 4);
+            table[i] = (int16_t)((u & 0x80) ? 0x84 - t : t - 0x84);
+        }
+
+        return table;
+    }();
+
+    constexpr auto ALawTable = []
+    {
+        std::array<int16_t, 256> table {};
+        for (int i = 0; i < 256; ++i)
+        {
+            int a = i ^ 0x55;
+            int segment = (a & 0x70) >> 4;
+            int t = (a & 0x0F) << 4;
+            t = segment == 0 ? t + 8 : (t + 0x108) << (segment - 1);
+            table[i] = (int16_t)((a & 0x80) ? t : -t);
+        }
+
+        return table;
+    }();
+}
+
+auto RtpDecoder::Create(const std::string& encoding, int rate, uint8_t channels) noexcept -> std::shared_ptr<RtpDecoder>
+{
+    if (rate <= 0 || channels == 0)
+    {
+        return nullptr;
+    }
+
+    auto decoder = std::make_shared<RtpDecoder>();
+    decoder->Encoding_ = encoding;
+    decoder->Spec_ = { .freq = rate, .format = AUDIO_S16SYS, .channels = channels };
+
+    if (encoding == "l16")
+    {
+        decoder->Spec_.format = AUDIO_S16MSB;
+        return decoder;
+    }
+
+    if (encoding == "pcmu" || encoding == "pcma")
+    {
+        return decoder;
+    }
+
+#ifdef ML_WITH_OPUS
+    if (encoding == "opus" && channels <= 2)
+    {
+        int error = 0;
+        decoder->Opus_ = opus_decoder_create(rate, channels, &error);
+        decoder->Decoded_.resize(MaxOpusFrames * channels * sizeof(int16_t));
+        return error == OPUS_OK ? decoder : nullptr;
+    }
+#endif
+
+    return nullptr;
+}
+
+RtpDecoder::~RtpDecoder()
+{
+#ifdef ML_WITH_OPUS
+    if (Opus_)
+    {
+        opus_decoder_destroy(Opus_);
+    }
+#endif
+}
+
+auto RtpDecoder::Parse(std::span<const uint8_t> datagram) noexcept -> std::optional<RtpPacket>
+{
+    if (datagram.size() < HeaderSize || datagram[0] >> 6 != 2)
+    {
+        return std::nullopt;
+    }
+
+    RtpPacket packet;
+    packet.Marker = datagram[1] & 0x80;
+    packet.Type = datagram[1] & 0x7F;
+    packet.Sequence = (uint16_t)(datagram[2] << 8 | datagram[3]);
+    packet.Timestamp = (uint32_t)datagram[4] << 24 | (uint32_t)datagram[5] << 16 | (uint32_t)datagram[6] << 8 | datagram[7];
+    packet.Ssrc = (uint32_t)datagram[8] << 24 | (uint32_t)datagram[9] << 16 | (uint32_t)datagram[10] << 8 | datagram[11];
+
+    // Skip the contributing sources and the extension, cut off the padding
+    size_t offset = HeaderSize + (datagram[0] & 0x0F) * 4;
+    if ((datagram[0] & 0x10) && offset + 4 <= datagram.size())
+    {
+        offset += 4 + (datagram[offset + 2] << 8 | datagram[offset + 3]) * 4;
+    }
+
+    size_t end = datagram.size();
+    if (datagram[0] & 0x20)
+    {
+        end -= std::min<size_t>(datagram.back(), end);
+    }
+
+    if (offset > end)
+    {
+        return std::nullopt;
+    }
+
+    packet.Payload = datagram.subspan(offset, end - offset);
+    return packet;
+}
+
+auto RtpDecoder::Decode(std::span<const uint8_t> payload) noexcept -> std::span<const uint8_t>
+{
+    if (Encoding_ == "l16")
+    {
+        return payload;
+    }
+
+    if (Encoding_ == "pcmu" || Encoding_ == "pcma")
+    {
+        const auto& table = Encoding_ == "pcmu" ? MuLawTable : ALawTable;
+        Decoded_.resize(payload.size() * sizeof(int16_t));
+
+        auto* samples = (int16_t*)Decoded_.data();
+        for (size_t i = 0; i < payload.size(); ++i)
+        {
+            samples[i] = table[payload[i]];
+        }
+
+        return Decoded_;
+    }
+
+#ifdef ML_WITH_OPUS
+    if (Opus_)
+    {
+        int frames = opus_decode(Opus_, payload.data(), (opus_int32)payload.size(), (opus_int16*)Decoded_.data(), MaxOpusFrames, 0);
+        return frames > 0 ? std::span<const uint8_t> { Decoded_.data(), (size_t)frames * Spec_.channels * sizeof(int16_t) } : std::span<const uint8_t> {};
+    }
+#endif
+
+    return {};
+}
+
+auto RtpDecoder::Spec() const noexcept -> SDL_AudioSpec
+{
+    return Spec_;
+}
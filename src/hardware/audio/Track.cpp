@@ -3,14 +3,60 @@
 using namespace ml::audio;
 
 Track::Track(std::vector<uint8_t> buffer, SDL_AudioSpec spec) noexcept
-    : Buffer_(std::move(buffer)), Spec_(spec) {}
+    : Spec_(spec)
+{
+    auto owner = std::make_shared<const std::vector<uint8_t>>(std::move(buffer));
+    Buffer_ = *owner;
+    Owner_ = std::move(owner);
+}
 
-auto Track::Buffer() const noexcept -> const std::vector<uint8_t>&
+Track::Track(std::shared_ptr<const void> owner, std::span<const uint8_t> buffer, SDL_AudioSpec spec, bool persistent) noexcept
+    : Owner_(std::move(owner)), Buffer_(buffer), Spec_(spec), Persistent_(persistent) {}
+
+auto Track::Buffer() const noexcept -> std::span<const uint8_t>
 {
     return Buffer_;
 }
 
+auto Track::Owner() const noexcept -> const std::shared_ptr<const void>&
+{
+    return Owner_;
+}
+
 auto Track::Spec() const noexcept -> const SDL_AudioSpec&
 {
     return Spec_;
-}
\ No newline at end of file
+}
+
+auto Track::Persistent() const noexcept -> bool
+{
+    return Persistent_;
+}
+
+auto Track::Loudness() const noexcept -> std::optional<double>
+{
+    return Loudness_;
+}
+
+auto Track::Gain() const noexcept -> float
+{
+    return Gain_;
+}
+
+auto Track::Slice(size_t offset, size_t size) const noexcept -> Track
+{
+    auto track = *this;
+    track.Buffer_ = Buffer_.subspan(std::min(offset, Buffer_.size())).first(std::min(size, Buffer_.size() - std::min(offset, Buffer_.size())));
+
+    return track;
+}
+
+void Track::SetLoudness(std::optional<double> loudness) noexcept
+{
+    Loudness_ = loudness;
+}
+
+void Track::SetGain(float gain) noexcept
+{
+    Gain_ = gain;
+}
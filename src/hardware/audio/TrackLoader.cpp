@@ -2,14 +2,14 @@
 #include "hardware/audio/TrackLoader.h"
 using namespace ml::audio;
 
-auto TrackLoader::FromWav(const std::vector<char> &wav) noexcept -> std::optional<Track>
+auto TrackLoader::FromWav(std::span<const char> wav) noexcept -> std::optional<Track>
 {
     // Try to parse the audio
     SDL_AudioSpec wavSpec;
     Uint32 wavLength;
     uint8_t* wavBuffer;
 
-    auto* rw = SDL_RWFromConstMem(&wav[0], wav.size());
+    auto* rw = SDL_RWFromConstMem(wav.data(), (int)wav.size());
     auto* r = SDL_LoadWAV_RW(rw, 1, &wavSpec, &wavBuffer, &wavLength);
 
     if (!r)
@@ -17,10 +17,20 @@ auto TrackLoader::FromWav(const std::vector<char> &wav) noexcept -> std::optiona
         return std::nullopt;
     }
 
-    // Move the buffer and specs into the audio object
-    Track audio {{wavBuffer, wavBuffer + wavLength }, wavSpec };
-
-    delete wavBuffer;
-    return audio;
+    // The track takes over the buffer, it is freed with the last copy of the track
+    auto owner = std::shared_ptr<uint8_t> { wavBuffer, SDL_FreeWAV };
+    return Track { std::move(owner), { wavBuffer, wavLength }, wavSpec };
 }
 
+auto TrackLoader::FromPcm(std::string pcm, const SDL_AudioSpec& spec) noexcept -> std::optional<Track>
+{
+    size_t frame = SDL_AUDIO_BITSIZE(spec.format) / 8 * spec.channels;
+    if (spec.freq <= 0 || frame == 0 || pcm.size() % frame != 0)
+    {
+        return std::nullopt;
+    }
+
+    // The track takes over the samples, they are freed with the last copy of the track
+    auto owner = std::make_shared<const std::string>(std::move(pcm));
+    return Track { owner, { (const uint8_t*)owner->data(), owner->size() }, spec, true };
+}
@@ -2,6 +2,80 @@
 #include "hardware/audio/Utils.h"
 using namespace ml::audio;
 
+namespace
+{
+    template <typename T>
+    void ScaleAs(std::span<uint8_t> samples, float gain) noexcept
+    {
+        auto* data = (T*)samples.data();
+        int count = (int)(samples.size() / sizeof(T));
+
+        for (int i = 0; i < count; ++i)
+        {
+            data[i] = Utils::FromFloat<T>(Utils::ToFloat(data[i]) * gain);
+        }
+    }
+
+    constexpr int ScanBlock = 64; // samples tested at once, the count of the loud ones is a vectorized reduction
+
+    /** Counts the samples of the block louder than the threshold. */
+    template <typename T>
+    auto CountLoud(const T* samples, int count, float threshold) noexcept -> int
+    {
+        int loud = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            loud += std::fabs(Utils::ToFloat(samples[i])) > threshold;
+        }
+
+        return loud;
+    }
+
+    /** Returns the range [first, last) of the samples from the first loud one to the last loud one. */
+    template <typename T>
+    auto LoudRange(std::span<const uint8_t> buffer, float threshold) noexcept -> std::pair<size_t, size_t>
+    {
+        auto* samples = (const T*)buffer.data();
+        size_t count = buffer.size() / sizeof(T);
+
+        // Skip the silent blocks, then find the sample inside the block
+        size_t first = 0;
+        while (first < count && !CountLoud(samples + first, (int)std::min<size_t>(ScanBlock, count - first), threshold))
+        {
+            first += ScanBlock;
+        }
+
+        while (first < count && std::fabs(Utils::ToFloat(samples[first])) <= threshold)
+        {
+            ++first;
+        }
+
+        if (first >= count)
+        {
+            return { 0, 0 };
+        }
+
+        size_t last = count;
+        while (last > first)
+        {
+            size_t size = std::min<size_t>(ScanBlock, last - first);
+            if (CountLoud(samples + last - size, (int)size, threshold))
+            {
+                break;
+            }
+
+            last -= size;
+        }
+
+        while (last > first && std::fabs(Utils::ToFloat(samples[last - 1])) <= threshold)
+        {
+            --last;
+        }
+
+        return { first, last };
+    }
+}
+
 auto Utils::EstimateBufferDuration(size_t bufferLength, SDL_AudioSpec spec) noexcept -> time_t
 {
     int sampleSize = SDL_AUDIO_BITSIZE(spec.format) / 8;
@@ -11,13 +85,34 @@ auto Utils::EstimateBufferDuration(size_t bufferLength, SDL_AudioSpec spec) noex
     return (1000*samplesPerChannel) / spec.freq;
 }
 
+auto Utils::SameFormat(const SDL_AudioSpec& a, const SDL_AudioSpec& b) noexcept -> bool
+{
+    return a.freq == b.freq && a.format == b.format && a.channels == b.channels;
+}
+
 auto Utils::Resample(const Track &original, SDL_AudioSpec spec) noexcept -> std::optional<Track>
+{
+    auto converted = Convert(original.Buffer(), original.Spec(), spec);
+    if (!converted)
+    {
+        return std::nullopt;
+    }
+
+    // The samples are the same sound, so the measurement and the gain still hold
+    auto track = Track { std::move(*converted), spec };
+    track.SetLoudness(original.Loudness());
+    track.SetGain(original.Gain());
+
+    return track;
+}
+
+auto Utils::Convert(std::span<const uint8_t> samples, const SDL_AudioSpec& from, const SDL_AudioSpec& to) noexcept
+    -> std::optional<std::vector<uint8_t>>
 {
     // Create a new stream
-    SDL_AudioSpec orig = original.Spec();
     auto* stream = SDL_NewAudioStream (
-        orig.format, orig.channels, orig.freq,
-        spec.format, spec.channels, spec.freq
+        from.format, from.channels, from.freq,
+        to.format, to.channels, to.freq
     );
 
     if (!stream)
@@ -26,13 +121,58 @@ auto Utils::Resample(const Track &original, SDL_AudioSpec spec) noexcept -> std:
     }
 
     // Convert all the data
-    uint64_t bytes = sizeof(original.Buffer()[0])*original.Buffer().size();
-    SDL_AudioStreamPut(stream, &original.Buffer()[0], (int)bytes);
+    SDL_AudioStreamPut(stream, samples.data(), (int)samples.size());
+    SDL_AudioStreamFlush(stream);
 
     std::vector<uint8_t> converted(SDL_AudioStreamAvailable(stream));
-    SDL_AudioStreamGet(stream, &converted[0], (int)converted.size());
+    SDL_AudioStreamGet(stream, converted.data(), (int)converted.size());
 
-    // Free the stream and create the new track
+    // Free the stream
     SDL_FreeAudioStream(stream);
-    return Track { converted, spec };
+    return converted;
+}
+
+auto Utils::ParseFormat(std::string_view name) noexcept -> std::optional<SDL_AudioFormat>
+{
+    if (name == "s16") return AUDIO_S16LSB;
+    if (name == "s32") return AUDIO_S32LSB;
+    if (name == "f32") return AUDIO_F32LSB;
+    if (name == "u8") return AUDIO_U8;
+    return std::nullopt;
+}
+
+auto Utils::TrimSilence(const Track& track, double threshold) noexcept -> Track
+{
+    auto level = (float)std::pow(10.0, threshold / 20);
+    std::pair<size_t, size_t> range;
+
+    switch (track.Spec().format)
+    {
+        case AUDIO_U8: range = LoudRange<uint8_t>(track.Buffer(), level); break;
+        case AUDIO_S16SYS: range = LoudRange<int16_t>(track.Buffer(), level); break;
+        case AUDIO_S32SYS: range = LoudRange<int32_t>(track.Buffer(), level); break;
+        case AUDIO_F32SYS: range = LoudRange<float>(track.Buffer(), level); break;
+        default: return track;
+    }
+
+    // Keep the whole frames around the loud samples
+    size_t sample = SDL_AUDIO_BITSIZE(track.Spec().format) / 8;
+    size_t frame = sample * std::max<uint8_t>(track.Spec().channels, 1);
+
+    size_t begin = range.first * sample / frame * frame;
+    size_t end = std::min(track.Buffer().size(), (range.second * sample + frame - 1) / frame * frame);
+
+    return track.Slice(begin, end - begin);
+}
+
+auto Utils::Scale(std::span<uint8_t> samples, SDL_AudioFormat format, float gain) noexcept -> bool
+{
+    switch (format)
+    {
+        case AUDIO_U8: ScaleAs<uint8_t>(samples, gain); return true;
+        case AUDIO_S16SYS: ScaleAs<int16_t>(samples, gain); return true;
+        case AUDIO_S32SYS: ScaleAs<int32_t>(samples, gain); return true;
+        case AUDIO_F32SYS: ScaleAs<float>(samples, gain); return true;
+        default: return false;
+    }
 }
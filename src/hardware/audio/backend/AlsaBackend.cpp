@@ -0,0 +1,201 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/backend/AlsaBackend.h"
+using namespace ml::audio;
+
+auto AlsaBackend::Create(const std::string& device, size_t period, size_t buffer) noexcept -> std::shared_ptr<AlsaBackend>
+{
+    if (!period || buffer < 2*period)
+    {
+        return nullptr;
+    }
+
+    auto backend = std::make_shared<AlsaBackend>();
+    backend->Device_ = device;
+    backend->Period_ = period;
+    backend->Buffer_ = buffer;
+
+    return backend;
+}
+
+AlsaBackend::~AlsaBackend()
+{
+    Close();
+}
+
+auto AlsaBackend::Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec>
+{
+    SDL_AudioSpec spec = desired;
+    spec.freq = spec.freq ? spec.freq : 44100;
+    spec.format = BindFormat(spec.format) != SND_PCM_FORMAT_UNKNOWN ? spec.format : AUDIO_S16LSB; // s16le by default
+    spec.channels = spec.channels ? spec.channels : 2;
+
+    if (snd_pcm_open(&Pcm_, Device_.c_str(), SND_PCM_STREAM_PLAYBACK, 0) < 0)
+    {
+        Pcm_ = nullptr;
+        return std::nullopt;
+    }
+
+    // Negotiate the hardware params ( on fail the device is closed )
+    auto r = [&]()
+    {
+        snd_pcm_hw_params_t* hw;
+        if (snd_pcm_hw_params_malloc(&hw) < 0)
+        {
+            return false;
+        }
+
+        std::unique_ptr<snd_pcm_hw_params_t, void(*)(snd_pcm_hw_params_t*)> hwHolder { hw, &snd_pcm_hw_params_free };
+
+        auto rate = (unsigned int)spec.freq;
+        if (snd_pcm_hw_params_any(Pcm_, hw) < 0 ||
+            snd_pcm_hw_params_set_access(Pcm_, hw, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0 ||
+            snd_pcm_hw_params_set_format(Pcm_, hw, BindFormat(spec.format)) < 0 ||
+            snd_pcm_hw_params_set_channels(Pcm_, hw, spec.channels) < 0 ||
+            snd_pcm_hw_params_set_rate_near(Pcm_, hw, &rate, nullptr) < 0 ||
+            snd_pcm_hw_params_set_period_size_near(Pcm_, hw, &Period_, nullptr) < 0 ||
+            snd_pcm_hw_params_set_buffer_size_near(Pcm_, hw, &Buffer_) < 0 ||
+            snd_pcm_hw_params(Pcm_, hw) < 0)
+        {
+            return false;
+        }
+
+        spec.freq = (int)rate;
+
+        // Start once the whole buffer is filled, wake up on each period
+        snd_pcm_sw_params_t* sw;
+        if (snd_pcm_sw_params_malloc(&sw) < 0)
+        {
+            return false;
+        }
+
+        std::unique_ptr<snd_pcm_sw_params_t, void(*)(snd_pcm_sw_params_t*)> swHolder { sw, &snd_pcm_sw_params_free };
+
+        return snd_pcm_sw_params_current(Pcm_, sw) >= 0 &&
+               snd_pcm_sw_params_set_start_threshold(Pcm_, sw, Buffer_ - Buffer_ % Period_) >= 0 &&
+               snd_pcm_sw_params_set_avail_min(Pcm_, sw, Period_) >= 0 &&
+               snd_pcm_sw_params(Pcm_, sw) >= 0 &&
+               snd_pcm_prepare(Pcm_) >= 0;
+    }();
+
+    if (!r)
+    {
+        snd_pcm_close(Pcm_);
+        Pcm_ = nullptr;
+        return std::nullopt;
+    }
+
+    spec.samples = Period_;
+    spec.silence = spec.format == AUDIO_U8 ? 0x80 : 0;
+    spec.size = spec.samples * spec.channels * SDL_AUDIO_BITSIZE(spec.format) / 8;
+    Spec_ = spec;
+
+    return spec;
+}
+
+void AlsaBackend::Start() noexcept
+{
+    if (Pcm_ && !Transfer_.joinable())
+    {
+        Transfer_ = std::jthread { [this](const std::stop_token& token) { Transfer(token); } };
+    }
+}
+
+void AlsaBackend::Close() noexcept
+{
+    if (Transfer_.joinable())
+    {
+        Transfer_.request_stop();
+        Transfer_.join();
+    }
+
+    if (Pcm_)
+    {
+        snd_pcm_drop(Pcm_);
+        snd_pcm_close(Pcm_);
+        Pcm_ = nullptr;
+    }
+}
+
+void AlsaBackend::Transfer(const std::stop_token& token) noexcept
+{
+    static auto& latency = utils::Metrics::Gauge("audio_output_latency_us");
+    size_t frameSize = Spec_.channels * SDL_AUDIO_BITSIZE(Spec_.format) / 8;
+
+    while (!token.stop_requested())
+    {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(Pcm_);
+        if (avail < 0)
+        {
+            Recover((int)avail);
+            continue;
+        }
+
+        // Wait until there is a room for the whole period
+        if ((snd_pcm_uframes_t)avail < Period_)
+        {
+            if (snd_pcm_state(Pcm_) == SND_PCM_STATE_PREPARED)
+            {
+                snd_pcm_start(Pcm_); // the buffer isn't a multiple of the period, so the threshold is never hit
+            }
+
+            if (int err = snd_pcm_wait(Pcm_, 100); err < 0)
+            {
+                Recover(err);
+            }
+
+            continue;
+        }
+
+        // Render straight into the ring buffer ( may be split by the wrap-around )
+        const snd_pcm_channel_area_t* areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = Period_;
+
+        if (int err = snd_pcm_mmap_begin(Pcm_, &areas, &offset, &frames); err < 0)
+        {
+            Recover(err);
+            continue;
+        }
+
+        auto* dst = (uint8_t*)areas[0].addr + areas[0].first/8 + offset*areas[0].step/8;
+        Spec_.callback(Spec_.userdata, dst, (int)(frames*frameSize));
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(Pcm_, offset, frames);
+        if (committed < 0 || (snd_pcm_uframes_t)committed != frames)
+        {
+            Recover(committed < 0 ? (int)committed : -EPIPE);
+            continue;
+        }
+
+        // Report the current latency
+        snd_pcm_sframes_t delay;
+        if (snd_pcm_delay(Pcm_, &delay) == 0)
+        {
+            latency = delay * 1'000'000 / Spec_.freq;
+        }
+    }
+}
+
+void AlsaBackend::Recover(int error) noexcept
+{
+    static auto& xruns = utils::Metrics::Counter("audio_xruns");
+    if (error == -EPIPE)
+    {
+        ++xruns;
+    }
+
+    // Prepares the device again, the playback restarts once the buffer is refilled
+    if (snd_pcm_recover(Pcm_, error, 1) < 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds { 10 });
+    }
+}
+
+auto AlsaBackend::BindFormat(SDL_AudioFormat format) noexcept -> snd_pcm_format_t
+{
+    if (format == AUDIO_S16LSB) return SND_PCM_FORMAT_S16_LE;
+    if (format == AUDIO_S32LSB) return SND_PCM_FORMAT_S32_LE;
+    if (format == AUDIO_F32LSB) return SND_PCM_FORMAT_FLOAT_LE;
+    if (format == AUDIO_U8) return SND_PCM_FORMAT_U8;
+    return SND_PCM_FORMAT_UNKNOWN;
+}
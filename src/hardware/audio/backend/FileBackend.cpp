@@ -0,0 +1,88 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/backend/FileBackend.h"
+using namespace ml::audio;
+
+auto FileBackend::Create(const std::string& path) noexcept -> std::shared_ptr<FileBackend>
+{
+    auto backend = std::make_shared<FileBackend>();
+    backend->File_.open(path, std::ios::binary | std::ios::trunc);
+
+    if (!backend->File_)
+    {
+        return nullptr;
+    }
+
+    return backend;
+}
+
+FileBackend::~FileBackend()
+{
+    Close();
+}
+
+auto FileBackend::Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec>
+{
+    // Wav stores the samples in little-endian, so the big-endian formats aren't allowed
+    SDL_AudioSpec adjusted = desired;
+    if (SDL_AUDIO_ISBIGENDIAN(adjusted.format))
+    {
+        adjusted.format = AUDIO_S16LSB;
+    }
+
+    auto spec = NullBackend::Open(adjusted);
+    if (!spec)
+    {
+        return std::nullopt;
+    }
+
+    Spec_ = *spec;
+    WriteHeader(); // reserve the space, sizes are patched on close
+
+    return spec;
+}
+
+void FileBackend::Close() noexcept
+{
+    NullBackend::Close();
+
+    if (File_.is_open())
+    {
+        WriteHeader();
+        File_.close();
+    }
+}
+
+void FileBackend::Consume(const uint8_t* data, size_t len) noexcept
+{
+    // The sizes in the header are 32-bit, so the file is kept within them in whole frames
+    size_t frame = Spec_.channels * SDL_AUDIO_BITSIZE(Spec_.format) / 8;
+    size_t room = (UINT32_MAX - 36 - Written_) / frame * frame;
+
+    len = std::min(len, room);
+    File_.write((const char*)data, (std::streamsize)len);
+    Written_ += len;
+}
+
+void FileBackend::WriteHeader() noexcept
+{
+    auto u16 = [&](uint16_t v) { File_.put(char(v & 0xFF)).put(char(v >> 8)); };
+    auto u32 = [&](uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); };
+
+    uint16_t bits = SDL_AUDIO_BITSIZE(Spec_.format);
+    uint16_t align = Spec_.channels * bits / 8;
+
+    File_.seekp(0);
+    File_.write("RIFF", 4); u32(36 + Written_);
+    File_.write("WAVE", 4);
+
+    File_.write("fmt ", 4); u32(16);
+    u16(SDL_AUDIO_ISFLOAT(Spec_.format) ? 3 : 1); // PCM or IEEE float
+    u16(Spec_.channels);
+    u32(Spec_.freq);
+    u32(Spec_.freq * align);
+    u16(align);
+    u16(bits);
+
+    File_.write("data", 4); u32(Written_);
+    File_.seekp(0, std::ios::end);
+}
@@ -0,0 +1,99 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/backend/NullBackend.h"
+using namespace ml::audio;
+
+auto NullBackend::Create() noexcept -> std::shared_ptr<NullBackend>
+{
+    return std::shared_ptr<NullBackend> {
+        new NullBackend {}
+    };
+}
+
+NullBackend::~NullBackend()
+{
+    Close();
+}
+
+auto NullBackend::Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec>
+{
+    // Pin everything that isn't specified
+    SDL_AudioSpec spec = desired;
+    spec.freq = spec.freq ? spec.freq : 44100;
+    spec.format = spec.format ? spec.format : AUDIO_S16LSB;
+    spec.channels = spec.channels ? spec.channels : 2;
+    spec.samples = spec.samples ? spec.samples : 4096;
+    spec.silence = spec.format == AUDIO_U8 ? 0x80 : 0;
+    spec.size = spec.samples * spec.channels * SDL_AUDIO_BITSIZE(spec.format) / 8;
+
+    if (!spec.callback)
+    {
+        return std::nullopt;
+    }
+
+    Spec_ = spec;
+    Period_.resize(spec.size);
+
+    return spec;
+}
+
+void NullBackend::Start() noexcept
+{
+    if (Clock_.joinable() || SimulatedClock_.Active())
+    {
+        return;
+    }
+
+    if (utils::Time::Simulated())
+    {
+        SimulatedClock_ = utils::Time::Schedule([this, startTime = utils::Time::Now(), period = int64_t {}] mutable
+        {
+            return SimulatedTick(startTime, period);
+        });
+
+        return;
+    }
+
+    Clock_ = std::jthread { [this](const std::stop_token& token) { Clock(token); } };
+}
+
+void NullBackend::Close() noexcept
+{
+    if (Clock_.joinable())
+    {
+        Clock_.request_stop();
+        Clock_.join();
+    }
+
+    SimulatedClock_.Stop();
+}
+
+void NullBackend::Consume(const uint8_t* data, size_t len) noexcept
+{
+}
+
+void NullBackend::Clock(const std::stop_token& token) noexcept
+{
+    using namespace std::chrono;
+
+    // The deadlines are derived from the number of consumed samples, so the clock never drifts
+    auto startTime = steady_clock::now();
+    for (int64_t period = 1; !token.stop_requested(); ++period)
+    {
+        Spec_.callback(Spec_.userdata, Period_.data(), (int)Period_.size());
+        Consume(Period_.data(), Period_.size());
+
+        // Whole seconds and the remainder are scaled apart, so the nanoseconds never overflow
+        int64_t samples = period * Spec_.samples;
+        std::this_thread::sleep_until(startTime + seconds { samples / Spec_.freq } + nanoseconds { samples % Spec_.freq * 1'000'000'000 / Spec_.freq });
+    }
+}
+
+auto NullBackend::SimulatedTick(time_t startTime, int64_t& period) noexcept -> time_t
+{
+    Spec_.callback(Spec_.userdata, Period_.data(), (int)Period_.size());
+    Consume(Period_.data(), Period_.size());
+
+    // Same drift-free deadlines as the real clock, but on the virtual one
+    ++period;
+    return startTime + period * Spec_.samples * 1000 / Spec_.freq - utils::Time::Now();
+}
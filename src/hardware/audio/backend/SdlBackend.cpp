@@ -0,0 +1,53 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/audio/backend/SdlBackend.h"
+using namespace ml::audio;
+
+auto SdlBackend::Create(const std::optional<std::string>& device) noexcept -> std::shared_ptr<SdlBackend>
+{
+    if (SDL_InitSubSystem(SDL_INIT_AUDIO) != 0)
+    {
+        return nullptr;
+    }
+
+    auto backend = std::make_shared<SdlBackend>();
+    backend->Device_ = device;
+
+    return backend;
+}
+
+SdlBackend::~SdlBackend()
+{
+    Close();
+}
+
+auto SdlBackend::Open(const SDL_AudioSpec& desired) noexcept -> std::optional<SDL_AudioSpec>
+{
+    // Select the device ( if given )
+    const char* name = Device_ ? Device_->c_str() : nullptr;
+
+    // Create the output, it stays paused until the start.
+    // The format is pinned ( SDL converts it for the device if needed ), so the callback gets exactly the requested layout.
+    SDL_AudioSpec obtained = {};
+    Out_ = SDL_OpenAudioDevice(name, 0, &desired, &obtained, SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+
+    if (!Out_)
+    {
+        return std::nullopt;
+    }
+
+    return obtained;
+}
+
+void SdlBackend::Start() noexcept
+{
+    SDL_PauseAudioDevice(Out_, false);
+}
+
+void SdlBackend::Close() noexcept
+{
+    if (Out_)
+    {
+        SDL_CloseAudioDevice(Out_);
+        Out_ = 0;
+    }
+}
@@ -0,0 +1,36 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/relay/memory/MemoryDriver.h"
+using namespace ml::relay;
+
+auto MemoryDriver::Create() noexcept -> std::shared_ptr<MemoryDriver>
+{
+    return std::make_shared<MemoryDriver>();
+}
+
+void MemoryDriver::Close() noexcept
+{
+    if (!Enabled_.exchange(true))
+    {
+        ++Switches_;
+    }
+}
+
+void MemoryDriver::Open() noexcept
+{
+    Enabled_ = false;
+}
+
+auto MemoryDriver::Closed() const noexcept -> bool
+{
+    return Enabled_;
+}
+
+auto MemoryDriver::Path() const noexcept -> std::string_view
+{
+    return "memory";
+}
+
+auto MemoryDriver::Switches() const noexcept -> size_t
+{
+    return Switches_;
+}
@@ -1,10 +1,10 @@
 // Created by Tube Lab. Part of the meloun project.
-#include "hardware/relay/Driver.h"
+#include "hardware/relay/serial/SerialDriver.h"
 
 #include <memory>
 using namespace ml::relay;
 
-auto Driver::Create(const std::string& port) noexcept -> std::shared_ptr<Driver>
+auto SerialDriver::Create(const std::string& port) noexcept -> std::shared_ptr<SerialDriver>
 {
     int fd = open (port.c_str(), O_RDWR | O_NOCTTY | O_SYNC);
     if (fd < 0)
@@ -59,7 +59,7 @@ auto Driver::Create(const std::string& port) noexcept -> std::shared_ptr<Driver>
     }
 
     // Return the created driver
-    auto driver = std::make_shared<Driver>();
+    auto driver = std::make_shared<SerialDriver>();
     driver->PortFd_ = fd;
     driver->Port_ = port;
     driver->Open(); // enforce the safe state
@@ -67,39 +67,39 @@ auto Driver::Create(const std::string& port) noexcept -> std::shared_ptr<Driver>
     return driver;
 }
 
-Driver::~Driver()
+SerialDriver::~SerialDriver()
 {
-    Close();
+    Open();
 
-    close(PortFd_);
     flock(PortFd_, LOCK_UN);
+    close(PortFd_);
 }
 
-void Driver::Close() noexcept
+void SerialDriver::Close() noexcept
 {
     // set dtr line high
     UpdatePort(TIOCM_DTR, 0);
     Enabled_ = true;
 }
 
-void Driver::Open() noexcept
+void SerialDriver::Open() noexcept
 {
     // set dtr line low
     UpdatePort(0, TIOCM_DTR);
     Enabled_ = false;
 }
 
-auto Driver::Closed() const noexcept -> bool
+auto SerialDriver::Closed() const noexcept -> bool
 {
     return Enabled_;
 }
 
-auto Driver::Path() const noexcept -> std::string_view
+auto SerialDriver::Path() const noexcept -> std::string_view
 {
     return Port_;
 }
 
-void Driver::UpdatePort(int add, int remove) noexcept
+void SerialDriver::UpdatePort(int add, int remove) noexcept
 {
     std::lock_guard _ { UpdateLock_ };
     {
@@ -5,18 +5,29 @@ using namespace ml::speaker;
 auto Driver::Create(const Config& config) noexcept -> std::shared_ptr<Driver>
 {
     // Convert channels list into the map of states
-    std::map<std::string, uint> channelsMap;
+    std::unordered_map<std::string, uint> channelsMap;
+    auto channels = std::vector<Channel>(config.Channels.size());
+
     for (uint i = 0; i < config.Channels.size(); ++i)
     {
         channelsMap[config.Channels[i]] = i;
+        channels[i].Name = config.Channels[i];
     }
 
     // Create the driver
     auto driver = std::make_shared<Driver>();
     driver->Amplifier_ = config.Amplifier;
     driver->ChannelsMap_ = channelsMap;
-    driver->Channels_ = std::vector<Channel>(config.Channels.size());
-    driver->Mainloop_ = std::jthread { [&](const auto& token) { driver->Mainloop(token); } };
+    driver->Channels_ = std::move(channels);
+    driver->Predictor_ = config.DemandPredictor;
+    driver->Journal_ = config.QueueJournal;
+
+    if (driver->Journal_)
+    {
+        driver->Restore(utils::Time::Now());
+    }
+
+    driver->Mainloop_ = utils::Time::Schedule([raw = driver.get()] { return raw->Mainloop(); });
 
     return driver;
 }
@@ -67,6 +78,25 @@ auto Driver::Activate(const std::string& channel, bool urgently) noexcept -> Res
         // Cancel the pending deactivation
         FulfillListeners(Channels_[index].DeactivationListeners);
 
+        // Learn the demand and take the amplifier over from the pre-warming
+        if (Predictor_)
+        {
+            auto time = utils::Time::Now();
+            Predictor_->Observe(index, time);
+
+            if (PrewarmingUntil_)
+            {
+                static auto& hits = utils::Metrics::Counter("prewarm_hits");
+                static auto& saved = utils::Metrics::Counter("prewarm_saved_ms");
+
+                // The activation would have cost the whole warm-up predicted when the pre-warming started
+                saved += urgently ? 0 : std::max<time_t>(PrewarmingCost_ - Amplifier_->StartupDuration(false), 0);
+                ++hits;
+
+                PrewarmingUntil_ = std::nullopt;
+            }
+        }
+
         // If the amplifier is working -> immediately return the result
         if (Amplifier_->Ready())
         {
@@ -117,16 +147,41 @@ auto Driver::Enqueue(const std::string& channel, const audio::Track& audio) noex
     return MapToIndex(channel).and_then([&](uint index) -> Result<std::future<void>>
     {
         auto result = Amplifier_->Enqueue(index, audio);
+        if (result && Journal_)
+        {
+            Journal_->Append(channel, audio);
+        }
+
         return result ? Result<std::future<void>> { std::move(result.value()) } : std::unexpected { BindDriverError(result.error()) };
     });
 }
 
+auto Driver::Stream(const std::string& channel, const SDL_AudioSpec& format, const std::optional<audio::JitterConfig>& jitter) noexcept -> Result<std::shared_ptr<audio::LiveStream>>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    return MapToIndex(channel).and_then([&](uint index) -> Result<std::shared_ptr<audio::LiveStream>>
+    {
+        auto result = Amplifier_->Stream(index, format, jitter);
+        if (result && Journal_)
+        {
+            Journal_->AppendStream(channel);
+        }
+
+        return result ? Result<std::shared_ptr<audio::LiveStream>> { std::move(result.value()) } : std::unexpected { BindDriverError(result.error()) };
+    });
+}
+
 auto Driver::Clear(const std::string& channel) noexcept -> Result<>
 {
     std::lock_guard _ { ChannelsLock_ };
     return MapToIndex(channel).and_then([&](uint index) -> Result<>
     {
         auto result = Amplifier_->Clear(index);
+        if (result && Journal_)
+        {
+            Journal_->Clear(channel);
+        }
+
         return result ? Result<> {} : std::unexpected { BindDriverError(result.error()) };
     });
 }
@@ -137,6 +192,11 @@ auto Driver::Skip(const std::string& channel) noexcept -> Result<>
     return MapToIndex(channel).and_then([&](uint index) -> Result<>
     {
         auto result = Amplifier_->Skip(index);
+        if (result && Journal_)
+        {
+            Journal_->Skip(channel);
+        }
+
         return result ? Result<> {} : std::unexpected { BindDriverError(result.error()) };
     });
 }
@@ -151,6 +211,44 @@ auto Driver::DurationLeft(const std::string& channel) const noexcept -> Result<t
     });
 }
 
+auto Driver::SetGain(const std::string& channel, double db) noexcept -> Result<>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    return MapToIndex(channel).and_then([&](uint index) -> Result<>
+    {
+        Amplifier_->SetGain(index, db);
+        return {};
+    });
+}
+
+auto Driver::Gain(const std::string& channel) const noexcept -> Result<double>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    return MapToIndex(channel).and_then([&](uint index) -> Result<double>
+    {
+        return Amplifier_->Gain(index);
+    });
+}
+
+auto Driver::SetPreemption(const std::string& channel, audio::PreemptPolicy policy) noexcept -> Result<>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    return MapToIndex(channel).and_then([&](uint index) -> Result<>
+    {
+        Amplifier_->SetPreemption(index, policy);
+        return {};
+    });
+}
+
+auto Driver::Preemption(const std::string& channel) const noexcept -> Result<audio::PreemptPolicy>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    return MapToIndex(channel).and_then([&](uint index) -> Result<audio::PreemptPolicy>
+    {
+        return Amplifier_->Preemption(index);
+    });
+}
+
 auto Driver::State(const std::string &channel) const noexcept -> Result<ChannelState>
 {
     std::lock_guard _ { ChannelsLock_ };
@@ -190,61 +288,295 @@ auto Driver::Ready() const noexcept -> bool
     return Amplifier_->Ready();
 }
 
-void Driver::Mainloop(const std::stop_token& token) noexcept
+auto Driver::Priority(const std::string& channel) const noexcept -> Result<uint>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    return MapToIndex(channel);
+}
+
+auto Driver::Channels() const noexcept -> std::vector<std::string>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    {
+        std::vector<std::string> names;
+        for (const auto& channel : Channels_)
+        {
+            names.push_back(channel.Name);
+        }
+
+        return names;
+    }
+}
+
+auto Driver::AddChannel(const std::string& channel, uint priority) noexcept -> Result<>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    {
+        if (ChannelsMap_.contains(channel))
+        {
+            return std::unexpected { AE_ChannelExists };
+        }
+
+        auto names = Channels();
+        names.insert(names.begin() + std::min<size_t>(priority, names.size()), channel);
+
+        Remap(names);
+        return {};
+    }
+}
+
+auto Driver::RemoveChannel(const std::string& channel) noexcept -> Result<>
+{
+    std::lock_guard _ { ChannelsLock_ };
+    return MapToIndex(channel).and_then([&](uint index) -> Result<>
+    {
+        auto names = Channels();
+        names.erase(names.begin() + index);
+
+        Remap(names);
+        return {};
+    });
+}
+
+void Driver::Remap(const std::vector<std::string>& channels) noexcept
 {
-    while (!token.stop_requested())
+    std::lock_guard _ { ChannelsLock_ };
     {
-        std::unique_lock _ { ChannelsLock_ };
-        auto time = utils::Time::Now();
+        std::unordered_map<std::string, uint> channelsMap;
+        std::vector<std::optional<uint>> mapping(channels.size());
+        std::vector<Channel> states(channels.size());
+
+        for (uint i = 0; i < channels.size(); ++i)
+        {
+            auto it = ChannelsMap_.find(channels[i]);
+            if (it != ChannelsMap_.end())
+            {
+                mapping[i] = it->second;
+                states[i] = std::move(Channels_[it->second]);
+            }
+
+            states[i].Name = channels[i];
+            channelsMap[channels[i]] = i;
+        }
 
-        // Terminate expired channels
-        for (uint64_t i = 0; i < Channels_.size(); ++i)
+        // Terminate the sessions of the removed channels
+        bool released = false;
+        for (const auto& [name, index] : ChannelsMap_)
         {
-            if (Channels_[i].ExpiresAt && time >= *Channels_[i].ExpiresAt)
+            if (!channelsMap.contains(name))
             {
-                // Cancel the listeners waiting for activation
-                FulfillListeners(Channels_[i].ActivationListeners);
+                released |= Channels_[index].State != CS_Closed && Channels_[index].State != CS_Opened;
+                FulfillListeners(Channels_[index].ActivationListeners);
+                FulfillListeners(Channels_[index].DeactivationListeners);
 
-                // Determine whether the amplifier should shut down
-                if (CountActive() > 1)
+                if (Journal_)
                 {
-                    Amplifier_->Close(i);
-                    Channels_[i].State = CS_Closed;
-                    continue;
+                    Journal_->Save(name, CS_Closed);
+                    Journal_->Clear(name);
                 }
+            }
+        }
+
+        Amplifier_->Remap(mapping);
+        if (Predictor_)
+        {
+            Predictor_->Remap(mapping);
+        }
+
+        ChannelsMap_ = std::move(channelsMap);
+        Channels_ = std::move(states);
+
+        // Nobody else needs the amplifier that the removed channels were using
+        bool busy = std::any_of(Channels_.begin(), Channels_.end(), [](const Channel& ch)
+        {
+            return ch.State != CS_Closed && ch.State != CS_Opened;
+        });
+
+        if (released && !busy)
+        {
+            Amplifier_->ShutDown(false);
+        }
+    }
+}
+
+auto Driver::Mainloop() noexcept -> time_t
+{
+    utils::Realtime::Enter(utils::TR_Mainloop);
+    std::lock_guard _ { ChannelsLock_ };
+    auto time = utils::Time::Now();
 
-                // Actually shut the amplifier down
-                Amplifier_->ShutDown(false);
-                Channels_[i].State = CS_PendingTermination;
-                Channels_[i].ExpiresAt = std::nullopt;
+    // Terminate expired channels
+    for (uint64_t i = 0; i < Channels_.size(); ++i)
+    {
+        if (Channels_[i].ExpiresAt && time >= *Channels_[i].ExpiresAt)
+        {
+            // Cancel the listeners waiting for activation
+            FulfillListeners(Channels_[i].ActivationListeners);
+
+            // Determine whether the amplifier should shut down
+            if (CountActive() > 1)
+            {
+                Amplifier_->Close(i);
+                Channels_[i].State = CS_Closed;
+                continue;
             }
+
+            // Actually shut the amplifier down
+            Amplifier_->ShutDown(false);
+            Channels_[i].State = CS_PendingTermination;
+            Channels_[i].ExpiresAt = std::nullopt;
         }
+    }
 
-        // Update states
-        for (uint i = 0; i < Channels_.size(); ++i)
+    // Update states
+    for (uint i = 0; i < Channels_.size(); ++i)
+    {
+        if (Channels_[i].State == CS_PendingActivation && Amplifier_->Ready())
+        {
+            Channels_[i].State = CS_Active;
+            FulfillListeners(Channels_[i].ActivationListeners);
+        }
+
+        if (Channels_[i].State == CS_PendingTermination && !Amplifier_->Ready())
+        {
+            Amplifier_->Close(i);
+            Channels_[i].State = CS_Closed;
+            FulfillListeners(Channels_[i].DeactivationListeners);
+        }
+
+        if (Channels_[i].State == CS_PendingDeactivation && !Amplifier_->Ready())
+        {
+            Channels_[i].State = CS_Opened;
+            FulfillListeners(Channels_[i].DeactivationListeners);
+        }
+    }
+
+    // Pre-warm the amplifier ahead of the likely demand
+    if (Predictor_)
+    {
+        Prewarm(time);
+    }
+
+    // Keep the journal in sync with the queues
+    if (Journal_)
+    {
+        Persist();
+    }
+
+    return 20;
+}
+
+void Driver::Prewarm(time_t time) noexcept
+{
+    static auto& starts = utils::Metrics::Counter("prewarm_starts");
+    static auto& spent = utils::Metrics::Counter("prewarm_spent_ms");
+
+    auto elapsed = time - PrewarmingTick_;
+    PrewarmingTick_ = time;
+
+    // Never interfere while the channels are using the amplifier
+    bool busy = std::any_of(Channels_.begin(), Channels_.end(), [](const Channel& ch)
+    {
+        return ch.State != CS_Closed && ch.State != CS_Opened;
+    });
+
+    if (busy)
+    {
+        PrewarmingUntil_ = std::nullopt;
+        return;
+    }
+
+    // Keep the amplifier warm until the predicted demand ends or the budget is exhausted
+    if (PrewarmingUntil_)
+    {
+        spent += elapsed;
+        if (!Predictor_->Spend(time, elapsed) || time >= *PrewarmingUntil_)
+        {
+            Amplifier_->ShutDown(false);
+            PrewarmingUntil_ = std::nullopt;
+        }
+
+        return;
+    }
+
+    // Start up in advance, so the amplifier is ready right when the demand comes
+    if (!Amplifier_->Ready() && Predictor_->Budget(time) > 0)
+    {
+        auto until = Predictor_->Forecast(time, Amplifier_->StartupDuration(false));
+        if (until)
+        {
+            PrewarmingCost_ = Amplifier_->StartupDuration(false);
+            Amplifier_->StartUp(false);
+            PrewarmingUntil_ = until;
+            ++starts;
+        }
+    }
+}
+
+void Driver::Restore(time_t time) noexcept
+{
+    for (auto& snapshot : Journal_->Restore())
+    {
+        auto it = ChannelsMap_.find(snapshot.Channel);
+        bool opened = snapshot.State != CS_Closed && snapshot.State != CS_PendingTermination;
+
+        if (it == ChannelsMap_.end() || !opened)
+        {
+            Journal_->Clear(snapshot.Channel);
+            continue;
+        }
+
+        // The session is restored with a fresh lease, so the client has the time to continue prolonging it
+        auto& channel = Channels_[it->second];
+        Amplifier_->Open(it->second);
+        channel.ExpiresAt = time + 1000;
+
+        if (snapshot.State == CS_Active || snapshot.State == CS_PendingActivation)
+        {
+            Amplifier_->StartUp(false);
+            channel.State = CS_PendingActivation;
+            channel.Replay = std::move(snapshot.Tracks);
+        }
+        else
         {
-            if (Channels_[i].State == CS_PendingActivation && Amplifier_->Ready())
+            channel.State = CS_Opened;
+            Journal_->Clear(snapshot.Channel);
+        }
+    }
+}
+
+void Driver::Persist() noexcept
+{
+    for (const auto& [name, index] : ChannelsMap_)
+    {
+        auto& channel = Channels_[index];
+        Journal_->Save(name, channel.State);
+
+        // The restored queue is waiting for the activation of its channel
+        if (!channel.Replay.empty())
+        {
+            if (channel.State == CS_Closed)
             {
-                Channels_[i].State = CS_Active;
-                FulfillListeners(Channels_[i].ActivationListeners);
+                channel.Replay.clear();
+                Journal_->Clear(name);
             }
 
-            if (Channels_[i].State == CS_PendingTermination && !Amplifier_->Ready())
+            if (channel.State != CS_Active)
             {
-                Amplifier_->Close(i);
-                Channels_[i].State = CS_Closed;
-                FulfillListeners(Channels_[i].DeactivationListeners);
+                continue;
             }
 
-            if (Channels_[i].State == CS_PendingDeactivation && !Amplifier_->Ready())
+            for (const auto& track : channel.Replay)
             {
-                Channels_[i].State = CS_Opened;
-                FulfillListeners(Channels_[i].DeactivationListeners);
+                Amplifier_->Enqueue(index, track);
             }
+
+            channel.Replay.clear();
         }
 
-        _.unlock();
-        std::this_thread::sleep_for(std::chrono::milliseconds { 20 });
+        // The queue is gone when the channel is closed or the amplifier is off
+        auto left = Amplifier_->QueueLeft(index);
+        left ? Journal_->Progress(name, left->first, left->second) : Journal_->Clear(name);
     }
 }
 
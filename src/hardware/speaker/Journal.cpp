@@ -0,0 +1,453 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/speaker/Journal.h"
+using namespace ml::speaker;
+using namespace ml::utils;
+
+struct Journal::Slot
+{
+    char Channel[64];
+    uint32_t State;
+    uint32_t Reserved;
+    int64_t Offset;
+};
+
+namespace
+{
+    constexpr char StateMagic[8] = { 'M', 'L', 'J', 'S', 'T', 'A', 'T', '1' };
+    constexpr char TrackMagic[4] = { 'M', 'L', 'J', 'T' };
+    constexpr char ClipMagic[4] = { 'M', 'L', 'J', 'C' };
+    constexpr uint64_t MaxSlots = 256;
+
+    struct StateHeader
+    {
+        char Magic[8];
+        uint64_t Slots;
+    };
+
+    struct TrackHeader
+    {
+        char Magic[4];
+        int32_t Freq;
+        uint16_t Format;
+        uint8_t Channels;
+        uint8_t Reserved;
+        char Channel[64];
+        float Gain; // zero in the tracks written before the gain existed
+        uint64_t Size;
+    };
+
+    struct ClipReference // follows the header instead of the samples
+    {
+        char Clip[64];
+        uint64_t Offset;
+    };
+
+    auto SpecOf(const TrackHeader& header) noexcept -> SDL_AudioSpec
+    {
+        SDL_AudioSpec spec {};
+        spec.freq = header.Freq;
+        spec.format = header.Format;
+        spec.channels = header.Channels;
+
+        return spec;
+    }
+}
+
+auto Journal::Create(const std::string& directory, const std::shared_ptr<audio::ClipLibrary>& clips) noexcept -> std::shared_ptr<Journal>
+{
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        return nullptr;
+    }
+
+    auto state = utils::MappedFile::Create(directory + "/state", sizeof(StateHeader) + MaxSlots*sizeof(Slot));
+    if (!state)
+    {
+        return nullptr;
+    }
+
+    // Start from scratch when the table is missing or written by an incompatible version
+    auto* header = (StateHeader*)state->Data();
+    if (std::memcmp(header->Magic, StateMagic, sizeof(StateMagic)) != 0 || header->Slots != MaxSlots)
+    {
+        std::memset(state->Data(), 0, state->Size());
+        std::memcpy(header->Magic, StateMagic, sizeof(StateMagic));
+        header->Slots = MaxSlots;
+    }
+
+    auto journal = std::make_shared<Journal>();
+    journal->Directory_ = directory;
+    journal->Clips_ = clips;
+    journal->State_ = state;
+    journal->Writer_ = std::jthread { [raw = journal.get()](const std::stop_token& token) { raw->Write(token); } };
+
+    return journal;
+}
+
+auto Journal::Restore() noexcept -> std::vector<Snapshot>
+{
+    std::lock_guard _ { Lock_ };
+
+    // Collect the valid tracks in the order of enqueuing, the referenced clips must still match the journaled part
+    std::vector<std::pair<uint64_t, std::shared_ptr<utils::MappedFile>>> found;
+    std::error_code ec;
+
+    auto resolve = [&](const TrackHeader& header) -> const audio::Track*
+    {
+        auto* reference = (const ClipReference*)((const uint8_t*)&header + sizeof(TrackHeader));
+        auto* clip = Clips_ && !reference->Clip[sizeof(reference->Clip) - 1] ? Clips_->Find(reference->Clip) : nullptr;
+
+        bool matches = clip && audio::Utils::SameFormat(clip->Spec(), SpecOf(header)) &&
+            reference->Offset <= clip->Buffer().size() && header.Size <= clip->Buffer().size() - reference->Offset;
+
+        return matches ? clip : nullptr;
+    };
+
+    for (const auto& entry : std::filesystem::directory_iterator { Directory_, ec })
+    {
+        if (entry.path().extension() != ".pcm")
+        {
+            continue;
+        }
+
+        auto stem = entry.path().stem().string();
+        uint64_t sequence = 0;
+        auto [end, err] = std::from_chars(stem.data(), stem.data() + stem.size(), sequence);
+
+        auto file = utils::MappedFile::Open(entry.path());
+        auto* header = file && file->Size() >= sizeof(TrackHeader) ? (const TrackHeader*)file->Data() : nullptr;
+
+        bool samples = header && std::memcmp(header->Magic, TrackMagic, sizeof(TrackMagic)) == 0 &&
+            header->Size == file->Size() - sizeof(TrackHeader);
+        bool clip = header && std::memcmp(header->Magic, ClipMagic, sizeof(ClipMagic)) == 0 &&
+            file->Size() == sizeof(TrackHeader) + sizeof(ClipReference) && resolve(*header);
+
+        bool valid = err == std::errc {} && end == stem.data() + stem.size() && (samples || clip) &&
+            header->Channel[sizeof(header->Channel) - 1] == 0;
+
+        if (!valid)
+        {
+            std::filesystem::remove(entry.path(), ec);
+            continue;
+        }
+
+        found.emplace_back(sequence, file);
+    }
+
+    std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    Sequence_ = found.empty() ? 0 : found.back().first + 1;
+
+    // Restore the channels states
+    std::vector<Snapshot> snapshots;
+    std::unordered_map<std::string, size_t> indexes;
+
+    auto* slots = (Slot*)(State_->Data() + sizeof(StateHeader));
+    for (uint64_t i = 0; i < MaxSlots; ++i)
+    {
+        if (slots[i].Channel[0] && !slots[i].Channel[sizeof(slots[i].Channel) - 1])
+        {
+            indexes[slots[i].Channel] = snapshots.size();
+            snapshots.push_back({ slots[i].Channel, (ChannelState)slots[i].State, {} });
+        }
+    }
+
+    // Restore the queues, the first track of each channel continues from the saved offset
+    for (const auto& [sequence, file] : found)
+    {
+        auto* header = (const TrackHeader*)file->Data();
+        std::string channel = header->Channel;
+
+        if (!indexes.contains(channel))
+        {
+            indexes[channel] = snapshots.size();
+            snapshots.push_back({ channel, CS_Closed, {} });
+        }
+
+        auto spec = SpecOf(*header);
+        auto& queue = Queues_[channel];
+        auto* slot = queue.empty() ? FindSlot(channel, false) : nullptr;
+        auto offset = slot ? std::max<int64_t>(slot->Offset, 0) : 0;
+
+        size_t frame = SDL_AUDIO_BITSIZE(spec.format) / 8 * std::max<uint8_t>(spec.channels, 1);
+        size_t skip = std::min<size_t>(header->Size, (size_t)(offset * spec.freq / 1000) * frame);
+
+        auto* data = file->Data() + sizeof(TrackHeader);
+        queue.push_back({ sequence, audio::Utils::EstimateBufferDuration(header->Size, spec) });
+
+        // The clip is referenced again, the journaled samples are copied out of the file
+        auto& tracks = snapshots[indexes[channel]].Tracks;
+        if (auto* clip = std::memcmp(header->Magic, ClipMagic, sizeof(ClipMagic)) == 0 ? resolve(*header) : nullptr)
+        {
+            tracks.push_back(clip->Slice(((const ClipReference*)data)->Offset + skip, header->Size - skip));
+        }
+        else
+        {
+            tracks.emplace_back(std::vector<uint8_t>(data + skip, data + header->Size), spec);
+        }
+
+        tracks.back().SetGain(header->Gain > 0 ? header->Gain : 1);
+    }
+
+    return snapshots;
+}
+
+void Journal::Append(const std::string& channel, const audio::Track& track) noexcept
+{
+    // The empty track never reaches the player' queue
+    if (channel.size() >= sizeof(TrackHeader::Channel) || track.Buffer().empty())
+    {
+        return;
+    }
+
+    // The writer outlives the caller, so the samples nobody keeps alive are copied before being queued
+    auto kept = track;
+    if (!track.Owner())
+    {
+        auto buffer = track.Buffer();
+        kept = audio::Track { std::vector<uint8_t>(buffer.begin(), buffer.end()), track.Spec() };
+        kept.SetLoudness(track.Loudness());
+        kept.SetGain(track.Gain());
+    }
+
+    std::lock_guard _ { Lock_ };
+    {
+        // The queue is accounted right away, the track shares its samples with the player until it's written
+        auto sequence = Sequence_++;
+        Queues_[channel].push_back({ sequence, audio::Utils::EstimateBufferDuration(track.Buffer().size(), track.Spec()) });
+        Pending_.push_back({ sequence, channel, std::move(kept) });
+        Wake_.notify_one();
+    }
+}
+
+void Journal::AppendStream(const std::string& channel) noexcept
+{
+    if (channel.size() >= sizeof(TrackHeader::Channel))
+    {
+        return;
+    }
+
+    std::lock_guard _ { Lock_ };
+    {
+        Queues_[channel].push_back({ Sequence_++, 0, true });
+    }
+}
+
+void Journal::Progress(const std::string& channel, size_t entries, time_t left) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        // Whatever isn't left in the queue has been played
+        auto& queue = Queues_[channel];
+        while (queue.size() > entries)
+        {
+            DropFirst(queue);
+        }
+
+        time_t total = 0;
+        for (const auto& record : queue)
+        {
+            total += record.Duration;
+        }
+
+        // Only the first track is being played, the stream in front of it keeps the tracks untouched
+        time_t consumed = queue.empty() ? 0 : std::clamp<time_t>(total - left, 0, queue.front().Duration);
+        if (auto* slot = FindSlot(channel, !queue.empty()))
+        {
+            slot->Offset = consumed;
+        }
+    }
+}
+
+void Journal::Skip(const std::string& channel) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        auto& queue = Queues_[channel];
+        if (!queue.empty())
+        {
+            DropFirst(queue);
+        }
+
+        if (auto* slot = FindSlot(channel, false))
+        {
+            slot->Offset = 0;
+        }
+    }
+}
+
+void Journal::Clear(const std::string& channel) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        auto& queue = Queues_[channel];
+        while (!queue.empty())
+        {
+            DropFirst(queue);
+        }
+
+        auto* slot = FindSlot(channel, false);
+        if (slot && slot->State == CS_Closed)
+        {
+            ReleaseSlot(channel);
+        }
+        else if (slot)
+        {
+            slot->Offset = 0;
+        }
+    }
+}
+
+void Journal::Save(const std::string& channel, ChannelState state) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        // The closed channel is restored as closed anyway, so it needs a slot only while its queue is kept
+        if (state == CS_Closed && Queues_[channel].empty())
+        {
+            ReleaseSlot(channel);
+            return;
+        }
+
+        if (auto* slot = FindSlot(channel))
+        {
+            slot->State = state;
+        }
+    }
+}
+
+auto Journal::FindSlot(const std::string& channel, bool create) noexcept -> Slot*
+{
+    auto* slots = (Slot*)(State_->Data() + sizeof(StateHeader));
+    if (channel.empty() || channel.size() >= sizeof(slots->Channel))
+    {
+        return nullptr;
+    }
+
+    Slot* free = nullptr;
+    for (uint64_t i = 0; i < MaxSlots; ++i)
+    {
+        if (channel == slots[i].Channel)
+        {
+            return &slots[i];
+        }
+
+        if (!free && !slots[i].Channel[0])
+        {
+            free = &slots[i];
+        }
+    }
+
+    if (!create)
+    {
+        return nullptr;
+    }
+
+    // Take a free slot for the new channel
+    if (free)
+    {
+        std::memset(free, 0, sizeof(Slot));
+        std::memcpy(free->Channel, channel.data(), channel.size());
+    }
+    else if (!std::exchange(Exhausted_, true))
+    {
+        Logger::Write(LL_Warning, "The journal has no free slot, the channel isn't persisted", {
+            { "channel", channel }
+        });
+    }
+
+    return free;
+}
+
+void Journal::ReleaseSlot(const std::string& channel) noexcept
+{
+    if (auto* slot = FindSlot(channel, false))
+    {
+        std::memset(slot, 0, sizeof(Slot));
+        Exhausted_ = false;
+    }
+}
+
+auto Journal::TrackPath(uint64_t sequence) const noexcept -> std::filesystem::path
+{
+    return Directory_ / (std::to_string(sequence) + ".pcm");
+}
+
+void Journal::Write(const std::stop_token& token) noexcept
+{
+    // The pending tracks are written even after the stop is requested
+    std::unique_lock lock { Lock_ };
+    while (Wake_.wait(lock, token, [this] { return !Pending_.empty(); }))
+    {
+        auto pending = std::move(Pending_.front());
+        Pending_.pop_front();
+
+        lock.unlock();
+        bool written = WriteTrack(pending);
+        lock.lock();
+
+        // The track played or dropped while it was being written leaves no file behind
+        auto& queue = Queues_[pending.Channel];
+        bool queued = std::ranges::any_of(queue, [&](const auto& record) { return record.Sequence == pending.Sequence; });
+
+        if (!written || !queued)
+        {
+            std::error_code ec;
+            std::filesystem::remove(TrackPath(pending.Sequence), ec);
+        }
+    }
+}
+
+auto Journal::WriteTrack(const Pending& pending) const noexcept -> bool
+{
+    const auto& track = pending.Track;
+
+    // The part of a clip is written as the reference, so playing a clip never copies it to the disk
+    auto clip = Clips_ && track.Persistent() ? Clips_->Locate(track.Buffer()) : std::nullopt;
+    ClipReference reference {};
+
+    if (clip && clip->first.size() < sizeof(reference.Clip))
+    {
+        std::memcpy(reference.Clip, clip->first.data(), clip->first.size());
+        reference.Offset = clip->second;
+    }
+    else
+    {
+        clip.reset();
+    }
+
+    TrackHeader header {};
+    std::memcpy(header.Magic, clip ? ClipMagic : TrackMagic, sizeof(TrackMagic));
+    std::memcpy(header.Channel, pending.Channel.data(), pending.Channel.size());
+    header.Freq = track.Spec().freq;
+    header.Format = track.Spec().format;
+    header.Channels = track.Spec().channels;
+    header.Gain = track.Gain();
+    header.Size = track.Buffer().size();
+
+    std::ofstream file { TrackPath(pending.Sequence), std::ios::binary | std::ios::trunc };
+    file.write((const char*)&header, sizeof(header));
+    clip ? file.write((const char*)&reference, sizeof(reference)) :
+        file.write((const char*)track.Buffer().data(), (std::streamsize)track.Buffer().size());
+    file.close();
+
+    return (bool)file;
+}
+
+void Journal::DropFirst(std::deque<Record>& queue) noexcept
+{
+    // The track that is still pending is never written
+    auto record = queue.front();
+    queue.pop_front();
+
+    if (record.Stream)
+    {
+        return;
+    }
+
+    std::erase_if(Pending_, [&](const auto& pending) { return pending.Sequence == record.Sequence; });
+
+    std::error_code ec;
+    std::filesystem::remove(TrackPath(record.Sequence), ec);
+}
@@ -0,0 +1,145 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "hardware/speaker/Predictor.h"
+
+#include <algorithm>
+#include <cmath>
+using namespace ml::speaker;
+
+namespace
+{
+    constexpr time_t DayDuration = 24*60*60*1000;
+}
+
+auto Predictor::Create(const PredictorConfig& config) noexcept -> std::shared_ptr<Predictor>
+{
+    if (config.SlotDuration <= 0 || config.Decay <= 0 || config.Decay >= 1)
+    {
+        return nullptr;
+    }
+
+    auto slots = (size_t)((DayDuration + config.SlotDuration - 1) / config.SlotDuration);
+
+    auto predictor = std::make_shared<Predictor>();
+    predictor->Config_ = config;
+    predictor->Slots_ = std::vector<std::vector<Slot>>(config.Channels, std::vector<Slot>(slots));
+
+    return predictor;
+}
+
+void Predictor::Observe(uint channel, time_t time) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        auto local = LocalTime(time);
+        auto day = local / DayDuration;
+        auto& slot = Slots_[channel][(local % DayDuration) / Config_.SlotDuration];
+
+        // Count each day only once, so the score stays the probability
+        if (slot.Day != day)
+        {
+            slot.Score = (slot.Day < 0 ? 0 : slot.Score * std::pow(Config_.Decay, (double)(day - slot.Day))) + 1;
+            slot.Day = day;
+        }
+    }
+}
+
+auto Predictor::Forecast(time_t time, time_t lead) const noexcept -> std::optional<time_t>
+{
+    std::lock_guard _ { Lock_ };
+    {
+        auto local = LocalTime(time);
+        auto offset = time - local; // converts back to the timestamp
+
+        for (auto at : { local, local + lead })
+        {
+            auto index = (at % DayDuration) / Config_.SlotDuration;
+            auto end = (at / Config_.SlotDuration + 1) * Config_.SlotDuration;
+
+            for (const auto& channel : Slots_)
+            {
+                const auto& slot = channel[index];
+                bool served = slot.Day == at / DayDuration;
+
+                if (!served && Probability(slot, at / DayDuration) >= Config_.Threshold)
+                {
+                    return end + offset;
+                }
+            }
+        }
+
+        return std::nullopt;
+    }
+}
+
+auto Predictor::Spend(time_t time, time_t duration) noexcept -> bool
+{
+    std::lock_guard _ { Lock_ };
+    {
+        auto day = LocalTime(time) / DayDuration;
+        if (day != BudgetDay_)
+        {
+            BudgetDay_ = day;
+            Spent_ = 0;
+        }
+
+        Spent_ += duration;
+        return Spent_ < Limit();
+    }
+}
+
+auto Predictor::Budget(time_t time) const noexcept -> time_t
+{
+    std::lock_guard _ { Lock_ };
+    {
+        auto spent = LocalTime(time) / DayDuration == BudgetDay_ ? Spent_ : 0;
+        return std::max<time_t>(Limit() - spent, 0);
+    }
+}
+
+void Predictor::Remap(const std::vector<std::optional<uint>>& mapping) noexcept
+{
+    std::lock_guard _ { Lock_ };
+    {
+        auto slots = (size_t)((DayDuration + Config_.SlotDuration - 1) / Config_.SlotDuration);
+        auto history = std::vector<std::vector<Slot>>(mapping.size());
+
+        for (size_t i = 0; i < mapping.size(); ++i)
+        {
+            history[i] = mapping[i] ? std::move(Slots_[*mapping[i]]) : std::vector<Slot>(slots);
+        }
+
+        Slots_ = std::move(history);
+        Config_.Channels = (uint)mapping.size();
+    }
+}
+
+auto Predictor::Probability(const Slot& slot, int64_t day) const noexcept -> double
+{
+    if (slot.Day < 0)
+    {
+        return 0;
+    }
+
+    // The score of a slot that is hit every day converges to 1 / (1 - decay)
+    return slot.Score * std::pow(Config_.Decay, (double)(day - slot.Day)) * (1 - Config_.Decay);
+}
+
+auto Predictor::Limit() const noexcept -> time_t
+{
+    time_t limit = Config_.LampBudget;
+    if (Config_.EnergyBudget > 0 && Config_.AmplifierPower > 0)
+    {
+        limit = std::min(limit, (time_t)(Config_.EnergyBudget / Config_.AmplifierPower * 60*60*1000));
+    }
+
+    return limit;
+}
+
+auto Predictor::LocalTime(time_t time) noexcept -> time_t
+{
+    time_t seconds = time / 1000;
+    tm local {};
+    localtime_r(&seconds, &local);
+
+    return time + local.tm_gmtoff*1000;
+}
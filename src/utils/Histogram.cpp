@@ -0,0 +1,80 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "utils/Histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+using namespace ml::utils;
+
+void Histogram::Record(int64_t value) noexcept
+{
+    value = std::max<int64_t>(value, 0);
+
+    Counts_[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+    Count_.fetch_add(1, std::memory_order_relaxed);
+    Sum_.fetch_add(value, std::memory_order_relaxed);
+
+    int64_t max = Max_.load(std::memory_order_relaxed);
+    while (value > max && !Max_.compare_exchange_weak(max, value, std::memory_order_relaxed));
+}
+
+auto Histogram::Percentile(double fraction) const noexcept -> int64_t
+{
+    auto target = (uint64_t)std::ceil(fraction * (double)Count());
+    if (!target)
+    {
+        return 0;
+    }
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < Buckets; ++i)
+    {
+        seen += Counts_[i].load(std::memory_order_relaxed);
+        if (seen >= target)
+        {
+            return std::min(ValueOf(i), Max());
+        }
+    }
+
+    return Max();
+}
+
+auto Histogram::Count() const noexcept -> uint64_t
+{
+    return Count_.load(std::memory_order_relaxed);
+}
+
+auto Histogram::Mean() const noexcept -> int64_t
+{
+    auto count = Count();
+    return count ? Sum_.load(std::memory_order_relaxed) / (int64_t)count : 0;
+}
+
+auto Histogram::Max() const noexcept -> int64_t
+{
+    return Max_.load(std::memory_order_relaxed);
+}
+
+auto Histogram::BucketOf(int64_t value) noexcept -> size_t
+{
+    if (value < (int64_t)(2*SubBuckets))
+    {
+        return value;
+    }
+
+    // Keep 5 significant bits, the exponent selects the group of sub-buckets
+    size_t shift = std::bit_width((uint64_t)value) - 6;
+    return 2*SubBuckets + (shift - 1)*SubBuckets + ((value >> shift) - SubBuckets);
+}
+
+auto Histogram::ValueOf(size_t bucket) noexcept -> int64_t
+{
+    if (bucket < 2*SubBuckets)
+    {
+        return (int64_t)bucket;
+    }
+
+    size_t shift = (bucket - 2*SubBuckets) / SubBuckets + 1;
+    int64_t significant = (int64_t)((bucket - 2*SubBuckets) % SubBuckets + SubBuckets);
+    return (significant << shift) + ((int64_t)1 << shift) - 1; // upper bound of the bucket
+}
@@ -0,0 +1,269 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "utils/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <mutex>
+using namespace ml::utils;
+
+namespace
+{
+    constexpr size_t RingSize = 64*1024;
+    constexpr uint64_t IndexMask = 0xFFFFFFFF;
+    constexpr auto DrainInterval = std::chrono::milliseconds { 20 };
+    constexpr const char* LevelNames[] = { "debug", "info", "warning", "error" };
+
+    /** The bytes of the records, written by the thread that has taken the ring and read by the writer. */
+    struct Ring
+    {
+        std::unique_ptr<char[]> Data = std::make_unique<char[]>(RingSize);
+        std::atomic<uint64_t> Written {};
+        std::atomic<uint64_t> Read {};
+    };
+
+    struct State
+    {
+        std::unique_ptr<Ring[]> Rings;
+        std::unique_ptr<std::atomic<uint32_t>[]> Next; ///< The free stack links, index + 1 ( 0 - the end ).
+        uint32_t Count {};
+        std::atomic<uint64_t> Head {}; ///< The ABA tag in the high half, the index + 1 of the free ring in the low one.
+
+        std::atomic<int> Level = LL_Info;
+        int Sink = -1;
+        std::once_flag Started;
+        std::jthread Writer;
+
+        ~State()
+        {
+            // Drain the rest before the rings are gone
+            Writer = {};
+        }
+    };
+
+    auto Instance() noexcept -> State&
+    {
+        static State state;
+        return state;
+    }
+
+    auto Acquire(State& s) noexcept -> uint32_t
+    {
+        auto head = s.Head.load(std::memory_order_acquire);
+        while (head & IndexMask)
+        {
+            auto index = (uint32_t)(head & IndexMask);
+            uint64_t desired = ((head >> 32) + 1) << 32 | s.Next[index - 1].load(std::memory_order_relaxed);
+
+            if (s.Head.compare_exchange_weak(head, desired, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                return index;
+            }
+        }
+
+        return 0;
+    }
+
+    void Release(State& s, uint32_t index) noexcept
+    {
+        auto head = s.Head.load(std::memory_order_relaxed);
+        uint64_t desired;
+
+        do
+        {
+            s.Next[index - 1].store((uint32_t)(head & IndexMask), std::memory_order_relaxed);
+            desired = ((head >> 32) + 1) << 32 | index;
+        }
+        while (!s.Head.compare_exchange_weak(head, desired, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void Escape(std::string& out, std::string_view text) noexcept
+    {
+        for (char c : text)
+        {
+            switch (c)
+            {
+                case '"': out += "\\\""; break;
+                case '\\': out += "\\\\"; break;
+                case '\n': out += "\\n"; break;
+                case '\r': out += "\\r"; break;
+                case '\t': out += "\\t"; break;
+
+                default:
+                    if ((unsigned char)c < 0x20)
+                    {
+                        char code[8];
+                        std::snprintf(code, sizeof(code), "\\u%04x", c);
+                        out += code;
+                    }
+                    else
+                    {
+                        out += c;
+                    }
+            }
+        }
+    }
+
+    void Drain(State& s, std::string& out) noexcept
+    {
+        // Whole records only, the thread publishes the written bytes once the record is copied
+        for (uint32_t i = 0; i < s.Count; ++i)
+        {
+            auto& ring = s.Rings[i];
+            auto read = ring.Read.load(std::memory_order_relaxed);
+            auto written = ring.Written.load(std::memory_order_acquire);
+
+            for (auto at = read; at < written;)
+            {
+                auto offset = at % RingSize;
+                auto size = std::min<uint64_t>(written - at, RingSize - offset);
+                out.append(ring.Data.get() + offset, size);
+                at += size;
+            }
+
+            ring.Read.store(written, std::memory_order_release);
+        }
+
+        // The slow sink blocks only the writer, the rings fill up meanwhile and the new records are dropped
+        for (size_t done = 0; done < out.size();)
+        {
+            auto n = ::write(s.Sink, out.data() + done, out.size() - done);
+            if (n <= 0)
+            {
+                break;
+            }
+
+            done += (size_t)n;
+        }
+
+        out.clear();
+    }
+}
+
+auto Logger::Start(const std::optional<std::string>& path, size_t memory) noexcept -> bool
+{
+    auto& s = Instance();
+    bool opened = true;
+
+    std::call_once(s.Started, [&]
+    {
+        s.Sink = path ? ::open(path->c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644) : STDOUT_FILENO;
+        if (s.Sink < 0)
+        {
+            opened = false;
+            return;
+        }
+
+        s.Count = (uint32_t)std::max<size_t>(memory / RingSize, 1);
+        s.Rings = std::make_unique<Ring[]>(s.Count);
+        s.Next = std::make_unique<std::atomic<uint32_t>[]>(s.Count);
+
+        for (uint32_t i = 0; i < s.Count; ++i)
+        {
+            s.Next[i] = i + 1 < s.Count ? i + 2 : 0;
+        }
+
+        s.Head = 1;
+        s.Writer = std::jthread { [&s](const std::stop_token& token)
+        {
+            std::string out;
+            while (!token.stop_requested())
+            {
+                Drain(s, out);
+                std::this_thread::sleep_for(DrainInterval);
+            }
+
+            Drain(s, out);
+        }};
+    });
+
+    return opened;
+}
+
+void Logger::SetLevel(LogLevel level) noexcept
+{
+    Instance().Level.store(level, std::memory_order_relaxed);
+}
+
+auto Logger::Enabled(LogLevel level) noexcept -> bool
+{
+    return level >= Instance().Level.load(std::memory_order_relaxed);
+}
+
+void Logger::Write(LogLevel level, std::string_view message, std::initializer_list<LogField> fields) noexcept
+{
+    static auto& records = Metrics::Counter("log_records");
+    static auto& dropped = Metrics::Counter("log_dropped");
+
+    auto& s = Instance();
+    if (!Enabled(level))
+    {
+        return;
+    }
+
+    // The record is formatted into the buffer of the thread, so it's allocated only while the buffer grows
+    thread_local std::string line;
+    line.clear();
+
+    line += "{\"ts\":" + std::to_string(Time::Now()) + ",\"level\":\"" + LevelNames[level] + "\",\"msg\":\"";
+    Escape(line, message);
+    line += '"';
+
+    for (const auto& field : fields)
+    {
+        line += ",\"";
+        Escape(line, field.Key);
+        line += "\":";
+
+        if (auto* integer = std::get_if<int64_t>(&field.Value)) line += std::to_string(*integer);
+        if (auto* real = std::get_if<double>(&field.Value)) line += std::to_string(*real);
+        if (auto* text = std::get_if<std::string_view>(&field.Value))
+        {
+            line += '"';
+            Escape(line, *text);
+            line += '"';
+        }
+    }
+
+    line += "}\n";
+
+    auto index = s.Count ? Acquire(s) : 0;
+    if (!index)
+    {
+        ++dropped;
+        return;
+    }
+
+    auto& ring = s.Rings[index - 1];
+    auto written = ring.Written.load(std::memory_order_relaxed);
+    auto read = ring.Read.load(std::memory_order_acquire);
+
+    if (RingSize - (written - read) < line.size())
+    {
+        Release(s, index);
+        ++dropped;
+        return;
+    }
+
+    auto offset = written % RingSize;
+    auto first = std::min(line.size(), RingSize - offset);
+    std::memcpy(ring.Data.get() + offset, line.data(), first);
+    std::memcpy(ring.Data.get(), line.data() + first, line.size() - first);
+
+    ring.Written.store(written + line.size(), std::memory_order_release);
+    Release(s, index);
+    ++records;
+}
+
+auto Logger::ParseLevel(std::string_view name) noexcept -> std::optional<LogLevel>
+{
+    for (int i = LL_Debug; i <= LL_Error; ++i)
+    {
+        if (name == LevelNames[i])
+        {
+            return (LogLevel)i;
+        }
+    }
+
+    return std::nullopt;
+}
@@ -0,0 +1,72 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "utils/MappedFile.h"
+using namespace ml::utils;
+
+auto MappedFile::Open(const std::string& path) noexcept -> std::shared_ptr<MappedFile>
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    return Map(fd, (size_t)st.st_size, false);
+}
+
+auto MappedFile::Create(const std::string& path, size_t size) noexcept -> std::shared_ptr<MappedFile>
+{
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) != 0))
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    return Map(fd, size, true);
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(Data_, Size_);
+    close(Fd_);
+}
+
+auto MappedFile::Data() const noexcept -> uint8_t*
+{
+    return Data_;
+}
+
+auto MappedFile::Size() const noexcept -> size_t
+{
+    return Size_;
+}
+
+auto MappedFile::Map(int fd, size_t size, bool writable) noexcept -> std::shared_ptr<MappedFile>
+{
+    void* data = mmap(nullptr, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    auto file = std::make_shared<MappedFile>();
+    file->Fd_ = fd;
+    file->Data_ = (uint8_t*)data;
+    file->Size_ = size;
+
+    return file;
+}
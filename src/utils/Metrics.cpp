@@ -0,0 +1,75 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "utils/Metrics.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+using namespace ml::utils;
+
+namespace
+{
+    struct Registry
+    {
+        std::map<std::string, std::unique_ptr<std::atomic<int64_t>>> Values;
+        std::map<std::string, std::unique_ptr<Histogram>> Distributions;
+        std::mutex Lock;
+    };
+
+    auto Instance() noexcept -> Registry&
+    {
+        static Registry registry;
+        return registry;
+    }
+}
+
+auto Metrics::Counter(const std::string& name) noexcept -> std::atomic<int64_t>&
+{
+    auto& r = Instance();
+    std::lock_guard _ { r.Lock };
+    {
+        auto& value = r.Values[name];
+        if (!value) value = std::make_unique<std::atomic<int64_t>>(0);
+        return *value;
+    }
+}
+
+auto Metrics::Gauge(const std::string& name) noexcept -> std::atomic<int64_t>&
+{
+    return Counter(name);
+}
+
+auto Metrics::Distribution(const std::string& name) noexcept -> Histogram&
+{
+    auto& r = Instance();
+    std::lock_guard _ { r.Lock };
+    {
+        auto& value = r.Distributions[name];
+        if (!value) value = std::make_unique<Histogram>();
+        return *value;
+    }
+}
+
+auto Metrics::Render() noexcept -> std::string
+{
+    auto& r = Instance();
+    std::lock_guard _ { r.Lock };
+    {
+        std::string text;
+        for (const auto& [name, value] : r.Values)
+        {
+            text += name + ' ' + std::to_string(value->load()) + '\n';
+        }
+
+        for (const auto& [name, h] : r.Distributions)
+        {
+            text += name + "_count " + std::to_string(h->Count()) + '\n';
+            text += name + "_mean " + std::to_string(h->Mean()) + '\n';
+            text += name + "_p50 " + std::to_string(h->Percentile(0.5)) + '\n';
+            text += name + "_p99 " + std::to_string(h->Percentile(0.99)) + '\n';
+            text += name + "_p999 " + std::to_string(h->Percentile(0.999)) + '\n';
+            text += name + "_max " + std::to_string(h->Max()) + '\n';
+        }
+
+        return text;
+    }
+}
@@ -0,0 +1,181 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "utils/Realtime.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cerrno>
+using namespace ml::utils;
+
+namespace
+{
+    struct State
+    {
+        RealtimeConfig Config;
+        std::atomic<uint64_t> Generation {};
+        std::mutex Lock;
+    };
+
+    auto Instance() noexcept -> State&
+    {
+        static State state;
+        return state;
+    }
+
+    auto MakeSet(const std::vector<uint>& cpus) noexcept -> cpu_set_t
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+
+        for (auto cpu : cpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+
+        return set;
+    }
+
+    auto Schedule(int policy, int priority) noexcept -> bool
+    {
+        static auto& fallbacks = Metrics::Counter("realtime_fallbacks");
+
+        sched_param param { .sched_priority = priority };
+        auto rc = pthread_setschedparam(pthread_self(), policy, &param);
+
+        // The unprivileged process may still have some real-time priority granted by the limits
+        rlimit limit {};
+        if (rc == EPERM && getrlimit(RLIMIT_RTPRIO, &limit) == 0 && limit.rlim_cur > 0)
+        {
+            param.sched_priority = std::min<int>(priority, (int)limit.rlim_cur);
+            rc = pthread_setschedparam(pthread_self(), policy, &param);
+        }
+
+        if (rc == 0)
+        {
+            return true;
+        }
+
+        // The niceness of the thread is set by its id, RLIMIT_NICE allows the nice of 20 - limit
+        ++fallbacks;
+        if (getrlimit(RLIMIT_NICE, &limit) == 0 && limit.rlim_cur > 0)
+        {
+            setpriority(PRIO_PROCESS, (id_t)gettid(), std::max(20 - (int)std::min<rlim_t>(limit.rlim_cur, 40), -20));
+        }
+
+        Logger::Write(LL_Warning, "The real-time scheduling is denied, the audio thread runs with the regular one", {
+            { "error", (int64_t)rc }
+        });
+
+        return false;
+    }
+}
+
+void Realtime::Configure(const RealtimeConfig& config) noexcept
+{
+    auto& s = Instance();
+    std::lock_guard _ { s.Lock };
+    {
+        s.Config = config;
+        s.Generation.fetch_add(1, std::memory_order_release);
+
+        // The threads started from now on inherit the mask, so they keep off the reserved cores
+        auto reserved = config.AudioCpus;
+        reserved.insert(reserved.end(), config.MainloopCpus.begin(), config.MainloopCpus.end());
+
+        cpu_set_t set;
+        if (reserved.empty() || sched_getaffinity(0, sizeof(set), &set) != 0)
+        {
+            return;
+        }
+
+        auto left = set;
+        for (auto cpu : reserved)
+        {
+            CPU_CLR(cpu, &left);
+        }
+
+        if (CPU_COUNT(&left) > 0)
+        {
+            pthread_setaffinity_np(pthread_self(), sizeof(left), &left);
+        }
+    }
+}
+
+void Realtime::Enter(ThreadRole role) noexcept
+{
+    static auto& realtime = Metrics::Gauge("audio_realtime");
+
+    // Checked on every audio callback, so the applied threads pay only for a single load
+    auto& s = Instance();
+    thread_local uint64_t applied = 0;
+
+    auto generation = s.Generation.load(std::memory_order_acquire);
+    if (applied == generation)
+    {
+        return;
+    }
+
+    applied = generation;
+    std::lock_guard _ { s.Lock };
+    {
+        const auto& cpus = role == TR_Audio ? s.Config.AudioCpus : s.Config.MainloopCpus;
+        if (!cpus.empty())
+        {
+            auto set = MakeSet(cpus);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+
+        if (role == TR_Audio && s.Config.Policy != SCHED_OTHER)
+        {
+            realtime = Schedule(s.Config.Policy, s.Config.Priority) ? 1 : 0;
+        }
+    }
+}
+
+auto Realtime::LockMemory() noexcept -> bool
+{
+    // The pages are locked as they are touched, otherwise the reserved but unused memory ( e.g. thread stacks ) would be populated.
+    // There's no fallback to the populating lock, the audio pool is locked by itself anyway.
+#ifdef MCL_ONFAULT
+    return mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0;
+#else
+    return false;
+#endif
+}
+
+auto Realtime::ParsePolicy(std::string_view name) noexcept -> std::optional<int>
+{
+    if (name == "other") return SCHED_OTHER;
+    if (name == "fifo") return SCHED_FIFO;
+    if (name == "rr") return SCHED_RR;
+    return std::nullopt;
+}
+
+auto Realtime::ParseCpus(std::string_view list) noexcept -> std::optional<std::vector<uint>>
+{
+    std::vector<uint> cpus;
+    while (!list.empty())
+    {
+        auto item = list.substr(0, list.find(','));
+        list.remove_prefix(std::min(item.size() + 1, list.size()));
+
+        // Either a single core or an inclusive range
+        uint first {}, last {};
+        auto dash = item.find('-');
+        auto head = item.substr(0, dash);
+        auto tail = dash == std::string_view::npos ? head : item.substr(dash + 1);
+
+        if (std::from_chars(head.data(), head.data() + head.size(), first).ptr != head.data() + head.size() || head.empty() ||
+            std::from_chars(tail.data(), tail.data() + tail.size(), last).ptr != tail.data() + tail.size() || tail.empty() ||
+            first > last || last >= CPU_SETSIZE)
+        {
+            return std::nullopt;
+        }
+
+        for (auto cpu = first; cpu <= last; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
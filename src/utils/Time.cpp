@@ -1,9 +1,161 @@
 // Created by Tube Lab. Part of the meloun project.
 #include "utils/Time.h"
+
+#include <atomic>
+#include <memory>
+#include <map>
+#include <set>
 using namespace ml::utils;
 
+namespace
+{
+    struct Simulation
+    {
+        std::atomic<bool> Enabled {};
+        std::atomic<time_t> Now {};
+
+        std::map<uint64_t, std::shared_ptr<std::function<time_t()>>> Routines;
+        std::set<std::pair<time_t, uint64_t>> Deadlines; ///< ( deadline, id ), the ids grow, so the earlier scheduled one runs first.
+        uint64_t Scheduled {};
+        std::recursive_mutex Lock;
+    };
+
+    auto Instance() noexcept -> Simulation&
+    {
+        static Simulation simulation;
+        return simulation;
+    }
+}
+
+Routine::Routine(std::jthread thread, uint64_t id) noexcept
+    : Thread_ { std::move(thread) }, Id_ { id }
+{
+}
+
+Routine::Routine(Routine&& other) noexcept
+    : Thread_ { std::move(other.Thread_) }, Id_ { std::exchange(other.Id_, 0) }
+{
+}
+
+auto Routine::operator=(Routine&& other) noexcept -> Routine&
+{
+    Stop();
+    Thread_ = std::move(other.Thread_);
+    Id_ = std::exchange(other.Id_, 0);
+    return *this;
+}
+
+Routine::~Routine()
+{
+    Stop();
+}
+
+void Routine::Stop() noexcept
+{
+    if (Thread_.joinable())
+    {
+        Thread_.request_stop();
+        Thread_.join();
+    }
+
+    if (Id_)
+    {
+        Time::Unschedule(std::exchange(Id_, 0));
+    }
+}
+
+auto Routine::Active() const noexcept -> bool
+{
+    return Thread_.joinable() || Id_;
+}
+
 auto Time::Now() noexcept -> time_t
 {
     using namespace std::chrono;
+
+    auto& s = Instance();
+    if (s.Enabled.load(std::memory_order_relaxed))
+    {
+        return s.Now.load(std::memory_order_relaxed);
+    }
+
     return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
 }
+
+auto Time::Schedule(std::function<time_t()> task) noexcept -> Routine
+{
+    auto& s = Instance();
+    if (s.Enabled)
+    {
+        std::lock_guard _ { s.Lock };
+        {
+            auto id = ++s.Scheduled;
+            s.Routines[id] = std::make_shared<std::function<time_t()>>(std::move(task));
+            s.Deadlines.emplace(s.Now.load(), id);
+
+            return Routine { std::jthread {}, id };
+        }
+    }
+
+    // The wait ends as soon as the stop is requested, so the owner is destroyed without waiting for the next run
+    return Routine { std::jthread { [task = std::move(task)](const std::stop_token& token)
+    {
+        std::mutex lock;
+        std::condition_variable_any stopped;
+
+        while (!token.stop_requested())
+        {
+            auto delay = task();
+
+            std::unique_lock _ { lock };
+            stopped.wait_for(_, token, std::chrono::milliseconds { delay }, [] { return false; });
+        }
+    }}, 0 };
+}
+
+void Time::Simulate(time_t start) noexcept
+{
+    auto& s = Instance();
+    s.Now = start;
+    s.Enabled = true;
+}
+
+auto Time::Simulated() noexcept -> bool
+{
+    return Instance().Enabled;
+}
+
+void Time::Advance(time_t duration) noexcept
+{
+    auto& s = Instance();
+    auto target = s.Now + duration;
+
+    std::unique_lock lock { s.Lock };
+    while (!s.Deadlines.empty() && s.Deadlines.begin()->first <= target)
+    {
+        auto [deadline, id] = *s.Deadlines.begin();
+        s.Deadlines.erase(s.Deadlines.begin());
+        s.Now = std::max(s.Now.load(), deadline);
+
+        // The routine may schedule or stop the routines ( even itself ), so it's kept alive till the run ends
+        auto task = s.Routines[id];
+        auto delay = (*task)();
+
+        if (s.Routines.contains(id))
+        {
+            s.Deadlines.emplace(s.Now + std::max<time_t>(delay, 1), id);
+        }
+    }
+
+    s.Now = target;
+}
+
+void Time::Unschedule(uint64_t id) noexcept
+{
+    auto& s = Instance();
+    std::lock_guard _ { s.Lock };
+    {
+        s.Routines.erase(id);
+        std::erase_if(s.Deadlines, [&](const auto& entry) { return entry.second == id; });
+    }
+}
@@ -0,0 +1,50 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ctime>
+#include <sys/types.h>
+
+namespace ml::tools
+{
+    struct LoadConfig
+    {
+        /** Address of the tested server. */
+        std::string Host = "127.0.0.1";
+
+        /** Port of the tested server. */
+        uint16_t Port = 8080;
+
+        /** The server' API token. */
+        std::string Token = "meloun";
+
+        /** The server' channels sorted by priority, the last one is used for the preemption. */
+        std::vector<std::string> Channels = { "default" };
+
+        /** For how long the load is generated. */
+        time_t Duration = 30000;
+
+        /** The number of clients that keep opening and prolonging the sessions. */
+        uint Heartbeats = 16;
+
+        /** The number of clients that upload the tracks in bursts ( spread over the low-priority channels ). */
+        uint Players = 2;
+
+        /** The number of simultaneous uploads in a single burst. */
+        uint BurstSize = 4;
+
+        /** The duration of the uploaded tracks. */
+        time_t TrackDuration = 500;
+
+        /** The number of clients that constantly poll the states. */
+        uint Pollers = 4;
+
+        /** The delay between two polls of a single poller. */
+        time_t PollInterval = 50;
+
+        /** The delay between two urgent announcements over the highest priority channel ( 0 disables them ). */
+        time_t PreemptInterval = 5000;
+    };
+}
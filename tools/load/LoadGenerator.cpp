@@ -0,0 +1,291 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "LoadGenerator.h"
+
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <iomanip>
+using namespace ml::tools;
+
+auto LoadGenerator::Create(const LoadConfig& config) noexcept -> std::shared_ptr<LoadGenerator>
+{
+    if (config.Channels.empty())
+    {
+        return nullptr;
+    }
+
+    auto generator = std::make_shared<LoadGenerator>();
+    generator->Config_ = config;
+    generator->Track_ = RenderWav(config.TrackDuration);
+
+    return generator;
+}
+
+void LoadGenerator::Run() noexcept
+{
+    auto startTime = utils::Time::Now();
+    {
+        std::vector<std::jthread> clients;
+        for (uint i = 0; i < Config_.Heartbeats; ++i)
+        {
+            clients.emplace_back([this, i](const std::stop_token& token) { Heartbeat(token, i); });
+        }
+
+        for (uint i = 0; i < Config_.Players; ++i)
+        {
+            clients.emplace_back([this, i](const std::stop_token& token) { Player(token, i); });
+        }
+
+        for (uint i = 0; i < Config_.Pollers; ++i)
+        {
+            clients.emplace_back([this, i](const std::stop_token& token) { Poller(token, i); });
+        }
+
+        if (Config_.PreemptInterval)
+        {
+            clients.emplace_back([this](const std::stop_token& token) { Preemption(token); });
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds { Config_.Duration });
+
+        // Stop everything, in-flight long-polls are awaited on join
+        for (auto& client : clients)
+        {
+            client.request_stop();
+        }
+    }
+
+    Elapsed_ = utils::Time::Now() - startTime;
+}
+
+auto LoadGenerator::Report() const noexcept -> std::string
+{
+    std::lock_guard _ { RoutesLock_ };
+
+    uint64_t total = 0;
+    for (const auto& [name, route] : Routes_)
+    {
+        total += route->Latency.Count();
+    }
+
+    std::ostringstream out;
+    double seconds = (double)std::max<time_t>(Elapsed_, 1) / 1000;
+    out << std::fixed << std::setprecision(1);
+    out << "duration " << seconds << " s, requests " << total << ", throughput " << (double)total / seconds << " req/s\n\n";
+
+    // Per-route latencies in milliseconds
+    out << std::left << std::setw(34) << "route" << std::right
+        << std::setw(9) << "count" << std::setw(9) << "rejected" << std::setw(9) << "failed"
+        << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(10) << "p999 ms" << std::setw(10) << "max ms" << '\n';
+
+    for (const auto& [name, route] : Routes_)
+    {
+        const auto& h = route->Latency;
+        out << std::left << std::setw(34) << name << std::right
+            << std::setw(9) << h.Count() << std::setw(9) << route->Rejected << std::setw(9) << route->Failed
+            << std::setw(10) << (double)h.Percentile(0.5) / 1000 << std::setw(10) << (double)h.Percentile(0.99) / 1000
+            << std::setw(10) << (double)h.Percentile(0.999) / 1000 << std::setw(10) << (double)h.Max() / 1000 << '\n';
+    }
+
+    // Server-side view: time-to-first-sample, underruns, etc.
+    auto metrics = Client()->Get("/metrics");
+    out << "\nserver metrics:\n" << (metrics && metrics->status == 200 ? metrics->body : "unavailable\n");
+
+    return out.str();
+}
+
+void LoadGenerator::Heartbeat(const std::stop_token& token, uint id) noexcept
+{
+    std::mt19937 random { id };
+    while (!token.stop_requested())
+    {
+        const auto& channel = Config_.Channels[random() % Config_.Channels.size()];
+        if (Post("POST /:channel/open", "/" + channel + "/open") != 200)
+        {
+            Sleep(token, 200);
+            continue;
+        }
+
+        // Hold the session for a while and let it expire
+        auto session = Session(channel, token);
+        Sleep(token, 1000 + random() % 2000);
+    }
+}
+
+void LoadGenerator::Player(const std::stop_token& token, uint id) noexcept
+{
+    std::mt19937 random { 1000 + id };
+
+    // Keep the highest priority channel for the preemption
+    size_t low = Config_.Channels.size() > 1 ? Config_.Channels.size() - 1 : 1;
+    const auto& channel = Config_.Channels[id % low];
+
+    while (!token.stop_requested())
+    {
+        if (Post("POST /:channel/open", "/" + channel + "/open") != 200)
+        {
+            Sleep(token, 100);
+            continue;
+        }
+
+        auto session = Session(channel, token);
+        if (Post("POST /:channel/activate", "/" + channel + "/activate") != 200)
+        {
+            continue;
+        }
+
+        for (uint burst = 0; burst < 4 && !token.stop_requested(); ++burst)
+        {
+            {
+                std::vector<std::jthread> uploads;
+                for (uint i = 0; i < Config_.BurstSize; ++i)
+                {
+                    uploads.emplace_back([&] { Post("POST /:channel/play", "/" + channel + "/play", Track_); });
+                }
+            }
+
+            Sleep(token, (time_t)(random() % (2*Config_.TrackDuration + 1)));
+        }
+
+        Post("POST /:channel/deactivate", "/" + channel + "/deactivate");
+    }
+}
+
+void LoadGenerator::Preemption(const std::stop_token& token) noexcept
+{
+    const auto& channel = Config_.Channels.back();
+    while (!token.stop_requested())
+    {
+        Sleep(token, Config_.PreemptInterval);
+
+        if (Post("POST /:channel/open", "/" + channel + "/open") != 200)
+        {
+            continue;
+        }
+
+        auto session = Session(channel, token);
+        if (Post("POST /:channel/activate", "/" + channel + "/activate?urgently") == 200)
+        {
+            Post("POST /:channel/play", "/" + channel + "/play", Track_);
+            Post("POST /:channel/deactivate", "/" + channel + "/deactivate?urgently");
+        }
+    }
+}
+
+void LoadGenerator::Poller(const std::stop_token& token, uint id) noexcept
+{
+    for (size_t i = id; !token.stop_requested(); ++i)
+    {
+        const auto& channel = Config_.Channels[i % Config_.Channels.size()];
+        switch (i % 4)
+        {
+            case 0: Get("GET /:channel/state", "/" + channel + "/state"); break;
+            case 1: Get("GET /:channel/duration-left", "/" + channel + "/duration-left"); break;
+            case 2: Get("GET /ready", "/ready"); break;
+            default: Get("GET /duration-left", "/duration-left"); break;
+        }
+
+        Sleep(token, Config_.PollInterval);
+    }
+}
+
+auto LoadGenerator::Session(const std::string& channel, const std::stop_token& token) noexcept -> std::jthread
+{
+    // Sessions expire after 1000(ms), so prolong them well in advance
+    return std::jthread { [this, channel, token](const std::stop_token& own)
+    {
+        while (!own.stop_requested() && !token.stop_requested())
+        {
+            Post("POST /:channel/prolong", "/" + channel + "/prolong");
+            std::this_thread::sleep_for(std::chrono::milliseconds { 300 });
+        }
+    }};
+}
+
+auto LoadGenerator::Post(const std::string& route, const std::string& path, const std::string& body) noexcept -> int
+{
+    thread_local auto client = Client();
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto r = client->Post(path, {}, body, "audio/wav");
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+
+    return Record(route, elapsed.count(), r ? r->status : -1);
+}
+
+auto LoadGenerator::Get(const std::string& route, const std::string& path) noexcept -> int
+{
+    thread_local auto client = Client();
+
+    auto startTime = std::chrono::steady_clock::now();
+    auto r = client->Get(path);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime);
+
+    return Record(route, elapsed.count(), r ? r->status : -1);
+}
+
+auto LoadGenerator::Record(const std::string& route, time_t micros, int status) noexcept -> int
+{
+    Route* stats;
+    {
+        std::lock_guard _ { RoutesLock_ };
+        auto& entry = Routes_[route];
+        if (!entry) entry = std::make_unique<Route>();
+        stats = entry.get();
+    }
+
+    stats->Latency.Record(micros);
+    if (status >= 400 && status < 500) ++stats->Rejected;
+    else if (status != 200) ++stats->Failed;
+
+    return status;
+}
+
+auto LoadGenerator::Client() const noexcept -> std::unique_ptr<httplib::Client>
+{
+    auto client = std::make_unique<httplib::Client>(Config_.Host, Config_.Port);
+    client->set_default_headers({{ "Authorization", Config_.Token }});
+    client->set_keep_alive(true);
+    client->set_read_timeout(300); // long-polls may take the whole warm-up
+
+    return client;
+}
+
+void LoadGenerator::Sleep(const std::stop_token& token, time_t duration) noexcept
+{
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds { duration };
+    while (!token.stop_requested() && std::chrono::steady_clock::now() < until)
+    {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+            until - std::chrono::steady_clock::now(), std::chrono::milliseconds { 20 }));
+    }
+}
+
+auto LoadGenerator::RenderWav(time_t duration) noexcept -> std::string
+{
+    constexpr uint32_t freq = 44100;
+    constexpr uint16_t channels = 2;
+    uint32_t frames = freq * duration / 1000;
+    uint32_t bytes = frames * channels * 2;
+
+    std::string wav;
+    auto u16 = [&](uint16_t v) { wav.push_back(char(v & 0xFF)); wav.push_back(char(v >> 8)); };
+    auto u32 = [&](uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); };
+
+    wav += "RIFF"; u32(36 + bytes); wav += "WAVE";
+    wav += "fmt "; u32(16); u16(1); u16(channels); u32(freq); u32(freq * channels * 2); u16(channels * 2); u16(16);
+    wav += "data"; u32(bytes);
+
+    // 440Hz tone at -12dB
+    for (uint32_t i = 0; i < frames; ++i)
+    {
+        auto sample = (int16_t)(8192 * std::sin(2 * std::numbers::pi * 440 * i / freq));
+        for (uint16_t c = 0; c < channels; ++c)
+        {
+            u16((uint16_t)sample);
+        }
+    }
+
+    return wav;
+}
@@ -0,0 +1,73 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "LoadConfig.h"
+
+#include "utils/CustomConstructor.h"
+#include "utils/Histogram.h"
+#include "utils/Time.h"
+
+#include <httplib.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace ml::tools
+{
+    /**
+     * @brief Drives the real server with a realistic mix of the traffic and measures it.
+     * @safety Fully exception and thread safe.
+     *
+     * Traffic:
+     * - Heartbeats: open the sessions on random channels and prolong them.
+     * - Players: activate the low-priority channels and upload bursts of tracks, waiting for them to be played.
+     * - Preemption: urgent announcements over the highest priority channel.
+     * - Pollers: constantly request channel and speaker states.
+     *
+     * Statuses 4xx are counted as rejections ( e.g. busy channel ), the rest of the non-200 responses as failures.
+     */
+    class LoadGenerator : public utils::CustomConstructor
+    {
+        struct Route
+        {
+            utils::Histogram Latency;
+            std::atomic<uint64_t> Rejected;
+            std::atomic<uint64_t> Failed;
+        };
+
+        LoadConfig Config_;
+        std::string Track_;
+        time_t Elapsed_ {};
+
+        std::map<std::string, std::unique_ptr<Route>> Routes_;
+        mutable std::mutex RoutesLock_;
+
+    public:
+        /** Creates the generator, renders the uploaded track. */
+        static auto Create(const LoadConfig& config) noexcept -> std::shared_ptr<LoadGenerator>;
+
+        /** Generates the load for the configured duration. Blocks. */
+        void Run() noexcept;
+
+        /** Renders the client-side statistics and the server' metrics. */
+        auto Report() const noexcept -> std::string;
+
+    private:
+        void Heartbeat(const std::stop_token& token, uint id) noexcept;
+        void Player(const std::stop_token& token, uint id) noexcept;
+        void Preemption(const std::stop_token& token) noexcept;
+        void Poller(const std::stop_token& token, uint id) noexcept;
+
+        auto Session(const std::string& channel, const std::stop_token& token) noexcept -> std::jthread;
+        auto Post(const std::string& route, const std::string& path, const std::string& body = {}) noexcept -> int;
+        auto Get(const std::string& route, const std::string& path) noexcept -> int;
+        auto Record(const std::string& route, time_t micros, int status) noexcept -> int;
+        auto Client() const noexcept -> std::unique_ptr<httplib::Client>;
+
+        static void Sleep(const std::stop_token& token, time_t duration) noexcept;
+        static auto RenderWav(time_t duration) noexcept -> std::string;
+    };
+}
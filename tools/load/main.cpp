@@ -0,0 +1,99 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "LoadGenerator.h"
+
+#include <iostream>
+#include <sstream>
+#include <charconv>
+
+// Usage: melound-load [--host=127.0.0.1] [--port=8080] [--token=meloun] [--channels=low,high] [--duration=30000]
+//                     [--heartbeats=16] [--players=2] [--burst-size=4] [--track-duration=500]
+//                     [--pollers=4] [--poll-interval=50] [--preempt-interval=5000]
+// The durations, the intervals and the counts must be positive ( --preempt-interval=0 disables the announcements ),
+// the tracks are at most 10 minutes long.
+// Run against the server configured with audio-backend=null and power-relay=memory.
+
+using namespace ml::tools;
+
+namespace
+{
+    constexpr time_t MaxTrackDuration = 10*60*1000; // the uploaded track is rendered in the memory, the wav sizes are 32-bit
+
+    /** Parses the whole text as the number, the value is left untouched on failure. */
+    template <typename T>
+    auto Parse(const std::string& text, T& value) noexcept -> bool
+    {
+        T parsed {};
+        auto [end, err] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+        if (err != std::errc {} || end != text.data() + text.size())
+        {
+            return false;
+        }
+
+        value = parsed;
+        return true;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    LoadConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (!arg.starts_with("--") || eq == std::string::npos)
+        {
+            std::cerr << "Unknown argument: " << arg << '\n';
+            return 1;
+        }
+
+        auto key = arg.substr(2, eq - 2);
+        auto value = arg.substr(eq + 1);
+        bool parsed = true;
+
+        if (key == "host") config.Host = value;
+        else if (key == "port") parsed = Parse(value, config.Port);
+        else if (key == "token") config.Token = value;
+        else if (key == "duration") parsed = Parse(value, config.Duration) && config.Duration > 0;
+        else if (key == "heartbeats") parsed = Parse(value, config.Heartbeats) && config.Heartbeats > 0;
+        else if (key == "players") parsed = Parse(value, config.Players) && config.Players > 0;
+        else if (key == "burst-size") parsed = Parse(value, config.BurstSize) && config.BurstSize > 0;
+        else if (key == "track-duration") parsed = Parse(value, config.TrackDuration) && config.TrackDuration > 0 && config.TrackDuration <= MaxTrackDuration;
+        else if (key == "pollers") parsed = Parse(value, config.Pollers) && config.Pollers > 0;
+        else if (key == "poll-interval") parsed = Parse(value, config.PollInterval) && config.PollInterval > 0;
+        else if (key == "preempt-interval") parsed = Parse(value, config.PreemptInterval) && config.PreemptInterval >= 0;
+        else if (key == "channels")
+        {
+            config.Channels = {};
+            std::istringstream list { value };
+            for (std::string name; std::getline(list, name, ',');)
+            {
+                config.Channels.push_back(name);
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << '\n';
+            return 1;
+        }
+
+        if (!parsed)
+        {
+            std::cerr << "Invalid value of the argument: " << arg << '\n';
+            return 1;
+        }
+    }
+
+    auto generator = LoadGenerator::Create(config);
+    if (!generator)
+    {
+        std::cerr << "At least one channel is required.\n";
+        return 1;
+    }
+
+    std::cout << "Generating the load on " << config.Host << ':' << config.Port << " for " << config.Duration << "(ms)" << std::endl;
+    generator->Run();
+    std::cout << generator->Report();
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+// Created by Tube Lab. Part of the meloun project.
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cmath>
+
+// Usage: melound-rtp [--host=127.0.0.1] [--port=5004] [--encoding=pcmu] [--rate=8000] [--channels=1]
+//                    [--duration=5000] [--ptime=20] [--frequency=440] [--loss=0] [--reorder=0] [--ssrc=1]
+// Sends the tone as the RTP stream, the lost and the reordered packets test the jitter buffer of the server.
+// Supported encodings: pcmu, pcma and l16.
+
+namespace
+{
+    /** Parses the whole text as the number, the value is left untouched on failure. */
+    template <typename T>
+    auto Parse(const std::string& text, T& value) noexcept -> bool
+    {
+        T parsed {};
+        auto [end, err] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+        if (err != std::errc {} || end != text.data() + text.size())
+        {
+            return false;
+        }
+
+        value = parsed;
+        return true;
+    }
+
+    auto EncodeMuLaw(int16_t sample) -> uint8_t
+    {
+        int sign = sample < 0 ? 0x80 : 0;
+        int magnitude = std::min(std::abs((int)sample), 32635) + 0x84;
+
+        int exponent = 7;
+        for (int mask = 0x4000; !(magnitude & mask) && exponent > 0; mask >>= 1) --exponent;
+
+        int mantissa = (magnitude >> (exponent + 3)) & 0x0F;
+        return (uint8_t)~(sign | exponent << 4 | mantissa);
+    }
+
+    auto EncodeALaw(int16_t sample) -> uint8_t
+    {
+        int sign = sample >= 0 ? 0x80 : 0;
+        int magnitude = std::min(std::abs((int)sample), 32767) >> 3;
+
+        int exponent = 0;
+        while (magnitude >= 32 << exponent && exponent < 7) ++exponent;
+
+        int mantissa = exponent ? (magnitude >> exponent) & 0x0F : magnitude >> 1;
+        return (uint8_t)((sign | exponent << 4 | mantissa) ^ 0x55);
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    std::string host = "127.0.0.1", encoding = "pcmu";
+    int port = 5004, rate = 8000, channels = 1, duration = 5000, ptime = 20;
+    double frequency = 440, loss = 0, reorder = 0;
+    uint32_t ssrc = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (!arg.starts_with("--") || eq == std::string::npos)
+        {
+            std::cerr << "Unknown argument: " << arg << '\n';
+            return 1;
+        }
+
+        auto key = arg.substr(2, eq - 2);
+        auto value = arg.substr(eq + 1);
+        bool parsed = true;
+
+        if (key == "host") host = value;
+        else if (key == "port") parsed = Parse(value, port) && port > 0 && port <= 65535;
+        else if (key == "encoding") encoding = value;
+        else if (key == "rate") parsed = Parse(value, rate) && rate > 0;
+        else if (key == "channels") parsed = Parse(value, channels) && channels > 0;
+        else if (key == "duration") parsed = Parse(value, duration) && duration > 0;
+        else if (key == "ptime") parsed = Parse(value, ptime) && ptime > 0;
+        else if (key == "frequency") parsed = Parse(value, frequency);
+        else if (key == "loss") parsed = Parse(value, loss);
+        else if (key == "reorder") parsed = Parse(value, reorder);
+        else if (key == "ssrc") parsed = Parse(value, ssrc);
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << '\n';
+            return 1;
+        }
+
+        if (!parsed)
+        {
+            std::cerr << "Invalid value of the argument: " << arg << '\n';
+            return 1;
+        }
+    }
+
+    if (encoding != "pcmu" && encoding != "pcma" && encoding != "l16")
+    {
+        std::cerr << "Unsupported encoding, expected pcmu, pcma or l16.\n";
+        return 1;
+    }
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (sock < 0 || inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1)
+    {
+        std::cerr << "Can't open the socket to " << host << '\n';
+        return 1;
+    }
+
+    // Every packet carries ptime of the tone, the header is RFC 3550 with the dynamic payload type for l16
+    int frames = rate * ptime / 1000;
+    uint8_t type = encoding == "pcmu" ? 0 : encoding == "pcma" ? 8 : 96;
+
+    std::mt19937 random { ssrc };
+    std::uniform_real_distribution<double> chance { 0, 1 };
+    std::vector<uint8_t> delayed;
+
+    auto start = std::chrono::steady_clock::now();
+    int sent = 0, lost = 0, reordered = 0;
+
+    for (int p = 0; p < duration / ptime; ++p)
+    {
+        std::vector<uint8_t> packet = {
+            0x80, type, (uint8_t)(p >> 8), (uint8_t)p,
+            (uint8_t)(p*frames >> 24), (uint8_t)(p*frames >> 16), (uint8_t)(p*frames >> 8), (uint8_t)(p*frames),
+            (uint8_t)(ssrc >> 24), (uint8_t)(ssrc >> 16), (uint8_t)(ssrc >> 8), (uint8_t)ssrc
+        };
+
+        for (int f = 0; f < frames; ++f)
+        {
+            auto sample = (int16_t)(std::sin(2 * M_PI * frequency * (p*frames + f) / rate) * 16000);
+            for (int c = 0; c < channels; ++c)
+            {
+                if (encoding == "pcmu") packet.push_back(EncodeMuLaw(sample));
+                else if (encoding == "pcma") packet.push_back(EncodeALaw(sample));
+                else packet.insert(packet.end(), { (uint8_t)(sample >> 8), (uint8_t)sample });
+            }
+        }
+
+        std::this_thread::sleep_until(start + std::chrono::milliseconds(p * ptime));
+
+        // The reordered packet is sent right after the next one
+        if (chance(random) < loss)
+        {
+            ++lost;
+        }
+        else if (delayed.empty() && chance(random) < reorder)
+        {
+            delayed = packet;
+            ++reordered;
+        }
+        else
+        {
+            sendto(sock, packet.data(), packet.size(), 0, (const sockaddr*)&address, sizeof(address));
+            ++sent;
+        }
+
+        if (!delayed.empty() && delayed != packet)
+        {
+            sendto(sock, delayed.data(), delayed.size(), 0, (const sockaddr*)&address, sizeof(address));
+            delayed.clear();
+            ++sent;
+        }
+    }
+
+    std::cout << "Sent " << sent << " packets, lost " << lost << ", reordered " << reordered << '\n';
+    close(sock);
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ctime>
+#include <sys/types.h>
+
+namespace ml::tools
+{
+    struct SimConfig
+    {
+        /** The speaker channels sorted by priority, the last one is activated urgently. */
+        std::vector<std::string> Channels = { "low", "high" };
+
+        /** The simulated period of the traffic. */
+        time_t Duration = 24*60*60*1000;
+
+        /** The virtual timestamp from which the simulation starts, so the results never depend on the wall clock. */
+        time_t Start = 1'700'000'000'000;
+
+        /** The seed of the traffic, the same seed always gives the same results. */
+        uint Seed = 1;
+
+        /** Time that the speaker requires to warm-up. */
+        time_t WarmingDuration = 30000;
+
+        /** Time that the speaker requires to cool down. */
+        time_t CoolingDuration = 60000;
+
+        /** The mean delay between two sessions of a single channel. */
+        time_t ArrivalInterval = 120000;
+
+        /** The largest number of the tracks played within a session. */
+        uint BurstSize = 4;
+
+        /** The duration of the played tracks. */
+        time_t TrackDuration = 2000;
+
+        /** The delay between two prolongations of the opened channel. */
+        time_t ProlongInterval = 500;
+
+        /** The percent of the sessions whose clients vanish after the activation, so their leases expire. */
+        uint AbandonRate = 5;
+    };
+}
@@ -0,0 +1,238 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "Simulator.h"
+
+#include "utils/Metrics.h"
+
+#include <sstream>
+#include <iomanip>
+using namespace ml::tools;
+
+namespace
+{
+    constexpr time_t PollInterval = 10;
+}
+
+auto Simulator::Create(const SimConfig& config) noexcept -> std::shared_ptr<Simulator>
+{
+    if (config.Channels.empty())
+    {
+        return nullptr;
+    }
+
+    // Everything below schedules its routines, so the clock is switched first
+    utils::Time::Simulate(config.Start);
+
+    auto simulator = std::make_shared<Simulator>();
+    simulator->Config_ = config;
+    simulator->Relay_ = relay::MemoryDriver::Create();
+
+    auto pool = audio::PagePool::Create(64*1024, 1024, false);
+    if (!pool)
+    {
+        return nullptr;
+    }
+
+    simulator->Amplifier_ = amplifier::LampDriver::Create(amplifier::LampConfig {
+        .WarmingDuration = config.WarmingDuration,
+        .CoolingDuration = config.CoolingDuration,
+        .PowerRelay = simulator->Relay_,
+        .AudioOutput = audio::NullBackend::Create(),
+        .AudioPool = pool,
+        .Channels = (uint)config.Channels.size()
+    });
+
+    if (!simulator->Amplifier_)
+    {
+        return nullptr;
+    }
+
+    simulator->Speaker_ = speaker::Driver::Create(speaker::Config {
+        .Amplifier = simulator->Amplifier_,
+        .Channels = config.Channels
+    });
+
+    if (!simulator->Speaker_)
+    {
+        return nullptr;
+    }
+
+    // The silence in the output format, so it's played without conversion
+    auto spec = simulator->Amplifier_->Spec();
+    auto size = (size_t)(spec.freq * config.TrackDuration / 1000) * spec.channels * SDL_AUDIO_BITSIZE(spec.format) / 8;
+    simulator->Track_.emplace(std::vector<uint8_t>(size, spec.silence), spec);
+
+    simulator->States_.resize(config.Channels.size(), speaker::CS_Closed);
+    for (uint i = 0; i < config.Channels.size(); ++i)
+    {
+        auto& session = simulator->Sessions_.emplace_back(std::make_unique<Session>());
+        session->Channel = config.Channels[i];
+        session->Urgent = i + 1 == config.Channels.size();
+        session->Random = std::mt19937 { config.Seed * 7919 + i };
+    }
+
+    // The observer goes first, so it sees the states left by the previous tick
+    auto* raw = simulator.get();
+    simulator->Routines_.push_back(utils::Time::Schedule([raw] { return raw->Observe(); }));
+
+    for (auto& session : simulator->Sessions_)
+    {
+        simulator->Routines_.push_back(utils::Time::Schedule([raw, session = session.get()] { return raw->Step(*session); }));
+    }
+
+    return simulator;
+}
+
+void Simulator::Run() noexcept
+{
+    auto startTime = std::chrono::steady_clock::now();
+    utils::Time::Advance(Config_.Duration);
+    Elapsed_ = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+auto Simulator::Report() const noexcept -> std::string
+{
+    std::ostringstream out;
+    double seconds = (double)std::max<time_t>(Elapsed_, 1) / 1000;
+    out << std::fixed << std::setprecision(1);
+    out << "simulated " << (double)Config_.Duration / 1000 << " s in " << seconds << " s ( x" << (double)Config_.Duration / 1000 / seconds << " )\n\n";
+
+    out << "sessions " << Started_ << ", completed " << Completed_ << ", expired " << Expired_ << ", lost " << Lost_
+        << ", rejected " << Rejected_ << '\n';
+    out << "tracks played " << Played_ << ", relay switches " << Relay_->Switches()
+        << ", amplifier ready " << 100.0 * (double)ReadyTime_ / (double)std::max<time_t>(Config_.Duration, 1) << "%\n";
+    out << "activation wait ms: p50 " << ActivationWait_.Percentile(0.5) << ", p99 " << ActivationWait_.Percentile(0.99)
+        << ", max " << ActivationWait_.Max() << '\n';
+    out << "timeline transitions " << Transitions_ << ", digest " << std::hex << std::setw(16) << std::setfill('0') << Digest_ << std::dec << '\n';
+
+    out << "\nmetrics:\n" << utils::Metrics::Render();
+    return out.str();
+}
+
+auto Simulator::Step(Session& session) noexcept -> time_t
+{
+    auto time = utils::Time::Now();
+    auto state = Speaker_->State(session.Channel).value_or(speaker::CS_Closed);
+
+    if (session.Step == SS_Idle)
+    {
+        // The channel may be still opened by the previous session, then it's taken over
+        auto opened = state == speaker::CS_Closed ? Speaker_->Open(session.Channel) : Speaker_->Prolong(session.Channel);
+        auto activation = opened ? Speaker_->Activate(session.Channel, session.Urgent) : std::unexpected { opened.error() };
+
+        if (!activation)
+        {
+            ++Rejected_;
+            return Arrival(session);
+        }
+
+        ++Started_;
+        session.Step = SS_Activating;
+        session.Abandoned = session.Random() % 100 < Config_.AbandonRate;
+        session.Since = time;
+        session.ProlongedAt = time;
+        session.Pending = std::move(*activation);
+        return PollInterval;
+    }
+
+    // The lease has expired or the channel was taken away
+    if (state == speaker::CS_Closed)
+    {
+        return Finish(session, session.Abandoned ? Expired_ : Lost_);
+    }
+
+    if (!session.Abandoned && time - session.ProlongedAt >= Config_.ProlongInterval)
+    {
+        Speaker_->Prolong(session.Channel);
+        session.ProlongedAt = time;
+    }
+
+    if (session.Step == SS_Activating && Ready(session.Pending) && state == speaker::CS_Active)
+    {
+        ActivationWait_.Record(time - session.Since);
+
+        auto tracks = session.Random() % Config_.BurstSize + 1;
+        for (uint i = 0; i < tracks; ++i)
+        {
+            if (auto track = Speaker_->Enqueue(session.Channel, *Track_))
+            {
+                session.Tracks.push_back(std::move(*track));
+            }
+        }
+
+        session.Step = SS_Playing;
+    }
+
+    if (session.Step == SS_Playing)
+    {
+        Played_ += std::erase_if(session.Tracks, [](auto& track) { return Ready(track); });
+
+        // The vanished client never deactivates, the channel is left to expire
+        if (session.Tracks.empty() && !session.Abandoned)
+        {
+            auto deactivation = Speaker_->Deactivate(session.Channel, false);
+            if (!deactivation)
+            {
+                return Finish(session, Lost_);
+            }
+
+            session.Step = SS_Deactivating;
+            session.Pending = std::move(*deactivation);
+        }
+    }
+
+    if (session.Step == SS_Deactivating && Ready(session.Pending))
+    {
+        return Finish(session, Completed_);
+    }
+
+    return PollInterval;
+}
+
+auto Simulator::Observe() noexcept -> time_t
+{
+    auto time = utils::Time::Now();
+    for (uint i = 0; i < Sessions_.size(); ++i)
+    {
+        auto state = Speaker_->State(Sessions_[i]->Channel).value_or(speaker::CS_Closed);
+        if (state == States_[i])
+        {
+            continue;
+        }
+
+        // FNV-1a over the transition
+        for (auto value : { (uint64_t)time, (uint64_t)i, (uint64_t)state })
+        {
+            for (int byte = 0; byte < 8; ++byte)
+            {
+                Digest_ = (Digest_ ^ (value >> byte*8 & 0xFF)) * 1099511628211ull;
+            }
+        }
+
+        States_[i] = state;
+        ++Transitions_;
+    }
+
+    ReadyTime_ += Speaker_->Ready() ? PollInterval : 0;
+    return PollInterval;
+}
+
+auto Simulator::Arrival(Session& session) noexcept -> time_t
+{
+    std::exponential_distribution<double> delay { 1.0 / (double)std::max<time_t>(Config_.ArrivalInterval, 1) };
+    return std::max<time_t>((time_t)delay(session.Random), 1);
+}
+
+auto Simulator::Finish(Session& session, uint64_t& outcome) noexcept -> time_t
+{
+    ++outcome;
+    session.Step = SS_Idle;
+    session.Pending = {};
+    session.Tracks.clear();
+
+    return Arrival(session);
+}
+
+auto Simulator::Ready(std::future<void>& future) noexcept -> bool
+{
+    return future.valid() && future.wait_for(std::chrono::seconds { 0 }) == std::future_status::ready;
+}
@@ -0,0 +1,99 @@
+// Created by Tube Lab. Part of the meloun project.
+#pragma once
+
+#include "SimConfig.h"
+
+#include "hardware/speaker/Driver.h"
+#include "hardware/amplifier/lamp/LampDriver.h"
+#include "hardware/relay/memory/MemoryDriver.h"
+#include "hardware/audio/backend/NullBackend.h"
+
+#include "utils/CustomConstructor.h"
+#include "utils/Histogram.h"
+#include "utils/Time.h"
+
+#include <future>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ml::tools
+{
+    /**
+     * @brief Replays the traffic against the real speaker stack in the virtual time.
+     * @safety Not thread safe, the simulation is driven by a single thread.
+     *
+     * The whole stack is built over the memory relay and the null audio output, all of them run as the routines of utils::Time.
+     * Every channel has a client that opens it, activates it, plays a burst of tracks, deactivates it and then stays idle
+     * for a random delay. Some clients vanish after the activation, so the lease expiry is exercised too.
+     *
+     * The channel states are sampled on every tick, their transitions are folded into the digest of the timeline,
+     * so two runs with the same config are compared by a single number.
+     */
+    class Simulator : public utils::CustomConstructor
+    {
+        enum SessionStep
+        {
+            SS_Idle = 0,
+            SS_Activating = 1,
+            SS_Playing = 2,
+            SS_Deactivating = 3
+        };
+
+        struct Session
+        {
+            std::string Channel;
+            bool Urgent {};
+            std::mt19937 Random;
+
+            SessionStep Step = SS_Idle;
+            bool Abandoned {};
+            time_t Since {};
+            time_t ProlongedAt {};
+            std::future<void> Pending;
+            std::vector<std::future<void>> Tracks;
+        };
+
+        SimConfig Config_;
+        std::shared_ptr<relay::MemoryDriver> Relay_;
+        std::shared_ptr<amplifier::LampDriver> Amplifier_;
+        std::shared_ptr<speaker::Driver> Speaker_;
+        std::optional<audio::Track> Track_;
+
+        std::vector<std::unique_ptr<Session>> Sessions_;
+        std::vector<speaker::ChannelState> States_;
+        uint64_t Digest_ = 14695981039346656037ull;
+        uint64_t Transitions_ {};
+        time_t ReadyTime_ {};
+        time_t Elapsed_ {};
+
+        uint64_t Started_ {};
+        uint64_t Rejected_ {};
+        uint64_t Completed_ {};
+        uint64_t Expired_ {};
+        uint64_t Lost_ {};
+        uint64_t Played_ {};
+        utils::Histogram ActivationWait_;
+
+        std::vector<utils::Routine> Routines_; ///< Declared last, so they stop before anything they use is gone.
+
+    public:
+        /** Switches the process to the virtual time and builds the stack, nullptr when some part couldn't be created. */
+        static auto Create(const SimConfig& config) noexcept -> std::shared_ptr<Simulator>;
+
+        /** Replays the traffic for the configured duration. Blocks. */
+        void Run() noexcept;
+
+        /** Renders the outcome of the sessions, the timeline digest and the metrics. */
+        auto Report() const noexcept -> std::string;
+
+    private:
+        auto Step(Session& session) noexcept -> time_t;
+        auto Observe() noexcept -> time_t;
+        auto Arrival(Session& session) noexcept -> time_t;
+        auto Finish(Session& session, uint64_t& outcome) noexcept -> time_t;
+
+        static auto Ready(std::future<void>& future) noexcept -> bool;
+    };
+}
@@ -0,0 +1,93 @@
+// Created by Tube Lab. Part of the meloun project.
+#include "Simulator.h"
+
+#include <iostream>
+#include <sstream>
+#include <charconv>
+
+// Usage: melound-sim [--channels=low,high] [--duration=86400000] [--seed=1] [--warming=30000] [--cooling=60000]
+//                    [--arrival-interval=120000] [--burst-size=4] [--track-duration=2000] [--prolong-interval=500]
+//                    [--abandon-rate=5]
+// Replays the traffic against the speaker stack in the virtual time, the same arguments always give the same digest.
+
+using namespace ml::tools;
+
+namespace
+{
+    /** Parses the whole text as the number, the value is left untouched on failure. */
+    template <typename T>
+    auto Parse(const std::string& text, T& value) noexcept -> bool
+    {
+        T parsed {};
+        auto [end, err] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+        if (err != std::errc {} || end != text.data() + text.size())
+        {
+            return false;
+        }
+
+        value = parsed;
+        return true;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    SimConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (!arg.starts_with("--") || eq == std::string::npos)
+        {
+            std::cerr << "Unknown argument: " << arg << '\n';
+            return 1;
+        }
+
+        auto key = arg.substr(2, eq - 2);
+        auto value = arg.substr(eq + 1);
+        bool parsed = true;
+
+        if (key == "duration") parsed = Parse(value, config.Duration);
+        else if (key == "seed") parsed = Parse(value, config.Seed);
+        else if (key == "warming") parsed = Parse(value, config.WarmingDuration);
+        else if (key == "cooling") parsed = Parse(value, config.CoolingDuration);
+        else if (key == "arrival-interval") parsed = Parse(value, config.ArrivalInterval);
+        else if (key == "burst-size") parsed = Parse(value, config.BurstSize) && config.BurstSize > 0;
+        else if (key == "track-duration") parsed = Parse(value, config.TrackDuration);
+        else if (key == "prolong-interval") parsed = Parse(value, config.ProlongInterval);
+        else if (key == "abandon-rate") parsed = Parse(value, config.AbandonRate);
+        else if (key == "channels")
+        {
+            config.Channels = {};
+            std::istringstream list { value };
+            for (std::string name; std::getline(list, name, ',');)
+            {
+                config.Channels.push_back(name);
+            }
+        }
+        else
+        {
+            std::cerr << "Unknown argument: " << arg << '\n';
+            return 1;
+        }
+
+        if (!parsed)
+        {
+            std::cerr << "Invalid value of the argument: " << arg << '\n';
+            return 1;
+        }
+    }
+
+    auto simulator = Simulator::Create(config);
+    if (!simulator)
+    {
+        std::cerr << "Can't build the simulated stack. At least one channel is required.\n";
+        return 1;
+    }
+
+    std::cout << "Simulating " << config.Duration << "(ms) of the traffic on " << config.Channels.size() << " channels" << std::endl;
+    simulator->Run();
+    std::cout << simulator->Report();
+
+    return 0;
+}